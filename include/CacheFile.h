@@ -0,0 +1,35 @@
+/**
+  @class CacheFile
+
+  Shared helpers for the files saved to speed up later runs - the event caches and the event number indices
+  Each file is named from a hash of its description, records the state of its source file, and is written in one go
+ */
+
+
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <string>
+#include <fstream>
+
+using namespace std;
+
+class CacheFile
+{
+	public:
+		//Find the size and modification time of a source file
+		static bool SourceStatus( string SourcePath, unsigned long & Size, unsigned long & Modified );
+
+		//A hash of a description for naming a file, written in hex
+		//This is FNV-1a, so the name is the same whichever standard library the program was built with
+		static string KeyHash( string Key );
+
+		//Open a temporary file to write instead of the final one - prints a warning if it can't be opened
+		static bool OpenTemporary( string FinalPath, string FileType, ofstream & Output, string & TemporaryPath );
+
+		//Close the temporary file and move it into place, so the final file is never seen half-written
+		//Prints a warning and removes the temporary file if anything went wrong
+		static bool MoveIntoPlace( ofstream & Output, string TemporaryPath, string FinalPath, string FileType );
+};
+
+#endif
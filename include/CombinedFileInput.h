@@ -14,7 +14,9 @@
 #include "ObservableList.h"
 #include <vector>
 #include <string>
+#include <thread>
 #include "IFileInput.h"
+#include "InputCut.h"
 
 using namespace std;
 
@@ -22,7 +24,9 @@ class CombinedFileInput : public IFileInput
 {
 	public:
 		CombinedFileInput();
-		CombinedFileInput( vector< string > FilePaths, vector< double > FileWeights, string InternalPath, string InputType, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker );
+		//The cut selects the events to read from every file (InputUETree files only)
+		CombinedFileInput( vector< string > FilePaths, vector< double > FileWeights, string InternalPath, string InputType, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker,
+				InputCut Cut = InputCut() );
 		virtual ~CombinedFileInput();
 
 		//Access a particular event, return false if the event is not found
@@ -37,6 +41,24 @@ class CombinedFileInput : public IFileInput
 		virtual double GetValue( string VariableName );
 		virtual vector< double > * GetVector( string VectorName );
 
+		//Get any other column value by handle
+		virtual double GetValue( unsigned int ColumnHandle );
+		virtual vector< double > * GetVector( unsigned int VectorHandle );
+
+		//Get the event number of every row in a file, without loading the rows
+		virtual void GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers );
+
+		//Read all relevant columns of a file into memory at once, rather than one row at a time
+		virtual void PreloadColumns( unsigned int FileIndex );
+
+		//Declare that only ReadRow will be used, so no event number index is ever needed
+		virtual void SetSequentialOnly( bool SequentialOnly );
+
+		//Step through the rows of a file in order
+		virtual void StartScan( unsigned int FileIndex );
+		virtual bool HasNext();
+		virtual bool Next();
+
 		//Get the number of rows
 		virtual unsigned long NumberOfRows();
 		virtual unsigned long CurrentRow();
@@ -47,17 +69,33 @@ class CombinedFileInput : public IFileInput
 		virtual string * Description();
 		virtual unsigned int DescriptionIndex();
 
+		//Set whether the next file is opened in the background while the current one is read
+		static void SetPrefetchNextFile( bool PrefetchNextFile );
+
 	private:
 		//Used to instantiate files when they are needed
 		void ChangeInputFile( unsigned int NewFileIndex );
+		IFileInput * OpenInputFile( unsigned int FileIndex );
+
+		//Open the file after the current one in another thread
+		void StartPrefetch();
+		void FinishPrefetch();
+		void PrefetchWorker( unsigned int FileIndex );
+
+		static bool m_prefetchNextFile;
 
 		string m_sourceDescription, m_inputType, m_internalPath;
 		unsigned int m_currentFile, m_sourceIndex;
+		bool m_sequentialOnly;
 		unsigned long m_rowInCurrentFile;
 		vector< string > m_filePaths;
 		vector< double > m_fileWeights, m_pTcuts;
 		IFileInput * m_currentInput;
+		IFileInput * m_prefetchedInput;
+		int m_prefetchedFile;
+		thread m_prefetchThread;
 		ObservableList * m_relevanceChecker;
+		InputCut m_cut;
 };
 
 #endif
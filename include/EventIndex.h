@@ -0,0 +1,62 @@
+/**
+  @class EventIndex
+
+  Finds the row holding an event number, using a sorted array of event numbers
+  The index can be saved in a file next to the input file, and mapped into memory by later runs
+ */
+
+
+#ifndef EVENT_INDEX_H
+#define EVENT_INDEX_H
+
+#include <vector>
+#include <string>
+#include "Rtypes.h"
+
+using namespace std;
+
+class EventIndex
+{
+	public:
+		EventIndex();
+		~EventIndex();
+
+		//Make the index from the event number of each row
+		void Build( const UInt_t * RowEventNumbers, unsigned long RowNumber );
+
+		//Read the index file for a source, returning false if it doesn't exist or doesn't match the source file
+		bool ReadFile( string SourcePath, string IndexKey );
+
+		//Write the index file for a source - just prints a warning if the file can't be written
+		void WriteFile( string SourcePath, string IndexKey );
+
+		//Set whether index files are read and written
+		static void SetUseIndexFiles( bool UseIndexFiles );
+
+		//Check whether the index has been made or read
+		bool IsReady();
+
+		//Find the row for an event number - the last row, if the number is repeated
+		bool FindRow( UInt_t EventNumber, unsigned long & RowIndex );
+
+	private:
+		//Name the index file from the source path and a hash of the description
+		static string IndexPath( string SourcePath, string IndexKey );
+		void Unmap();
+
+		static bool useIndexFiles;
+
+		bool isReady;
+		unsigned long entryNumber;
+		const UInt_t * sortedEventNumbers;
+		const UInt_t * sortedRows;
+
+		//Storage for an index made in memory
+		vector< UInt_t > builtEventNumbers, builtRows;
+
+		//Storage for an index read from a file
+		char * mappedFile;
+		unsigned long mappedSize;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #define I_FILE_INPUT_H
 
 #include <string>
+#include <vector>
 #include "Rtypes.h"
 
 using namespace std;
@@ -36,6 +37,30 @@ class IFileInput
 		virtual double GetValue( string VariableName ) = 0;
 		virtual vector< double > * GetVector( string VectorName ) = 0;
 
+		//Get a handle for a column name, which is the same for all inputs
+		//Reading by handle avoids looking up the name for every event
+		static unsigned int BindColumn( string ColumnName );
+		static string ColumnName( unsigned int ColumnHandle );
+
+		//Get any other column value by handle
+		virtual double GetValue( unsigned int ColumnHandle ) = 0;
+		virtual vector< double > * GetVector( unsigned int VectorHandle ) = 0;
+
+		//Get the event number of every row in a file, without loading the rows
+		virtual void GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers ) = 0;
+
+		//Read all relevant columns of a file into memory at once, rather than one row at a time
+		virtual void PreloadColumns( unsigned int FileIndex ) = 0;
+
+		//Declare that only ReadRow will be used, so no event number index is ever needed
+		virtual void SetSequentialOnly( bool SequentialOnly ) = 0;
+
+		//Step through the rows of a file in order - Next loads the following row, and returns false after the last one
+		//This is faster than ReadRow when every row is used
+		virtual void StartScan( unsigned int FileIndex ) = 0;
+		virtual bool HasNext() = 0;
+		virtual bool Next() = 0;
+
 		//Get the number of rows and files
 		virtual unsigned long NumberOfRows() = 0;
 		virtual unsigned long CurrentRow() = 0;
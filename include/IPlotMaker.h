@@ -17,6 +17,7 @@
 #include "TH2F.h"
 #include <string>
 #include <vector>
+#include <iostream>
 
 using namespace std;
 
@@ -38,14 +39,17 @@ class IPlotMaker
 		virtual void StoreFake( IFileInput * ReconstructedInput ) = 0;
 		virtual void StoreData( IFileInput * DataInput ) = 0;
 
+		//Add the MC events stored in a copy of this object (from Clone or CloneShareSmearingMatrix, made the same way as this) to this one
+		virtual void MergeEvents( IPlotMaker * Other ) = 0;
+
 		//Do the unfolding
 		virtual void Correct( unsigned int MostIterations, bool SkipUnfolding = false, unsigned int ErrorMode = 0, bool WithSmoothing = false ) = 0;
 
 		//Do a closure test
 	        virtual bool ClosureTest( unsigned int MostIterations, bool WithSmoothing = false ) = 0;
 
-		//Make a cross-check with MC
-		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false ) = 0;
+		//Make a cross-check with MC - safe to run in parallel, once the smearing matrix is finalised
+		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false, ostream & Output = cout ) = 0;
 
 		//Return a distribution for use in the cross-checks
 		virtual Distribution * PriorDistributionForCrossCheck() = 0;
@@ -62,6 +66,14 @@ class IPlotMaker
 		//Copy the object
 		virtual IPlotMaker * Clone( string NewPriorName ) = 0;
 
+		//Copy the object, using the smearing matrix of this one: only this object will fill it, so the copy just needs the MC events for its prior
+		//Returns NULL if the correction cannot share its smearing matrix
+		virtual IPlotMaker * CloneShareSmearingMatrix( string NewPriorName ) = 0;
+
+		//Unfold this plot and its copies from CloneShareSmearingMatrix all together, without the error calculation
+		//Retrieve the results by calling Correct on each plot with SkipUnfolding = true
+		virtual void CorrectClones( vector< IPlotMaker* > Clones, unsigned int MostIterations, bool WithSmoothing = false ) = 0;
+
 		//General info
 		virtual string Description( bool WithSpaces ) = 0;
 		virtual string PriorName() = 0;
@@ -0,0 +1,44 @@
+/**
+  @class InputCut
+
+  A selection applied when an input file is opened: a list of ranges, all of which an event must pass
+  Only the columns in the cut are read to find the selected rows, so rejected events are never loaded
+ */
+
+
+#ifndef INPUT_CUT_H
+#define INPUT_CUT_H
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+class InputCut
+{
+	public:
+		//No cut - every event passes
+		InputCut();
+
+		//A cut with a single range
+		InputCut( string ColumnName, double Minimum, double Maximum );
+
+		~InputCut();
+
+		//Require Minimum <= value <= Maximum for a column, as well as all the other ranges
+		void AddRange( string ColumnName, double Minimum, double Maximum );
+
+		//Access the ranges
+		unsigned int NumberOfRanges();
+		string ColumnName( unsigned int RangeIndex );
+		bool InRange( unsigned int RangeIndex, double Value );
+
+		//Describe the cut, so saved files are only used again for the same selection
+		string Description();
+
+	private:
+		vector< string > columnNames;
+		vector< double > minima, maxima;
+};
+
+#endif
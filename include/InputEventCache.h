@@ -0,0 +1,123 @@
+/**
+  @class InputEventCache
+
+  Reads the relevant columns of one input file from a flat binary cache, mapped into memory
+  The cache is written the first time a file is read, and used again until the file or the list of observables changes
+ */
+
+
+#ifndef INPUT_EVENT_CACHE_H
+#define INPUT_EVENT_CACHE_H
+
+#include "IFileInput.h"
+#include "ObservableList.h"
+#include "EventIndex.h"
+#include "InputCut.h"
+#include <map>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+class InputEventCache : public IFileInput
+{
+	public:
+		InputEventCache();
+		//Set FloatEventNumbers if the source stores its event numbers as floats, so events are looked up the same way
+		InputEventCache( string CachePath, string CacheKey, string SourcePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker,
+				bool FloatEventNumbers = false );
+		virtual ~InputEventCache();
+
+		//Make an input for a file, reading the cache if there is a valid one, or writing a new cache if not
+		static IFileInput * OpenNtuple( string FilePath, string NtuplePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker );
+		static IFileInput * OpenUETree( string FilePath, string NtuplePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker,
+				InputCut Cut = InputCut() );
+
+		//Set the directory for the cache files - no caching if empty
+		static void SetCacheDirectory( string Directory );
+
+		//Check whether the cache file matched the input file
+		bool IsValid();
+
+		//Access a particular event, return false if the event is not found
+		virtual bool ReadRow( unsigned long RowIndex, unsigned int FileIndex );
+		virtual bool ReadEvent( UInt_t EventNumber, unsigned int FileIndex );
+
+		//Get the standard event number and weight information
+		virtual UInt_t EventNumber();
+		virtual double EventWeight();
+
+		//Get any other column value by name
+		virtual double GetValue( string VariableName );
+		virtual vector< double > * GetVector( string VectorName );
+
+		//Get any other column value by handle
+		virtual double GetValue( unsigned int ColumnHandle );
+		virtual vector< double > * GetVector( unsigned int VectorHandle );
+
+		//Get the event number of every row in a file, without loading the rows
+		virtual void GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers );
+
+		//The whole file is already in memory
+		virtual void PreloadColumns( unsigned int FileIndex );
+
+		//Declare that only ReadRow will be used, so no event number index is ever needed
+		virtual void SetSequentialOnly( bool SequentialOnly );
+
+		//Step through the rows of a file in order
+		virtual void StartScan( unsigned int FileIndex );
+		virtual bool HasNext();
+		virtual bool Next();
+
+		//Get the number of rows
+		virtual unsigned long NumberOfRows();
+		virtual unsigned long CurrentRow();
+		virtual unsigned int NumberOfFiles();
+		virtual unsigned int CurrentFile();
+
+		//Get the description of the source
+		virtual string * Description();
+		virtual unsigned int DescriptionIndex();
+
+	private:
+		//Find the cache file for an input
+		static string CachePath( string CacheKey );
+
+		//Write the cache for an input that has just been opened
+		static void WriteCache( string CachePath, string CacheKey, string SourcePath, ObservableList * RelevanceChecker, IFileInput * Source,
+				vector< string > ValueNames, vector< string > VectorNames );
+
+		//Read the cache file
+		bool ReadHeader( string CacheKey, string SourcePath, ObservableList * RelevanceChecker );
+		void CheckFile( unsigned int FileIndex );
+
+		static string cacheDirectory;
+
+		//Mapped file
+		bool isValid;
+		char * mappedFile;
+		unsigned long mappedSize, readPosition;
+
+		//Column data in the mapped file
+		unsigned long totalRows, currentRowNumber, nextScanRow;
+		const UInt_t * eventNumbers;
+		const double * eventWeights;
+		vector< const double* > columnValues, vectorValues;
+		vector< const unsigned long* > vectorStarts;
+
+		//Mapping
+		bool sequentialOnly, floatEventNumbers;
+		EventIndex eventIndex;
+		map< string, unsigned int > columnNameToIndex, vectorNameToIndex;
+		vector< int > handleToColumn, handleToVector;
+
+		//Vectors for the current row
+		unsigned long currentGeneration;
+		vector< unsigned long > vectorGenerations;
+		vector< vector< double > > currentVectors;
+
+		string sourceDescription;
+		unsigned int sourceDescriptionIndex;
+};
+
+#endif
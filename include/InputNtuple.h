@@ -12,6 +12,7 @@
 #define INPUT_NTUPLE_H
 
 #include "ObservableList.h"
+#include "EventIndex.h"
 #include <map>
 #include <vector>
 #include "TFile.h"
@@ -40,6 +41,24 @@ class InputNtuple : public IFileInput
 		virtual double GetValue( string VariableName );
 		virtual vector< double > * GetVector( string VectorName );
 
+		//Get any other column value by handle
+		virtual double GetValue( unsigned int ColumnHandle );
+		virtual vector< double > * GetVector( unsigned int VectorHandle );
+
+		//Get the event number of every row in a file, without loading the rows
+		virtual void GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers );
+
+		//Read all relevant columns of a file into memory at once, rather than one row at a time
+		virtual void PreloadColumns( unsigned int FileIndex );
+
+		//Declare that only ReadRow will be used, so no event number index is ever needed
+		virtual void SetSequentialOnly( bool SequentialOnly );
+
+		//Step through the rows of a file in order
+		virtual void StartScan( unsigned int FileIndex );
+		virtual bool HasNext();
+		virtual bool Next();
+
 		//Get the number of rows
 		virtual unsigned long NumberOfRows();
 		virtual unsigned long CurrentRow();
@@ -50,23 +69,43 @@ class InputNtuple : public IFileInput
 		virtual string * Description();
 		virtual unsigned int DescriptionIndex();
 
+		//Get the names of the relevant columns found in the file
+		void RelevantColumnNames( vector< string > & ValueNames, vector< string > & VectorNames );
+
 	private:
+		//Read the event numbers and make the index only when they are needed
+		void ReadEventNumbers();
+		void MakeEventIndex();
+		bool eventNumbersRead, sequentialOnly;
+
+		//Read columns only when they are needed
+		void LoadRow( unsigned long RowIndex );
+		void LoadColumn( unsigned int ColumnIndex );
+
 		//Caching
-		unsigned long currentRowNumber, numberOfRows;
+		unsigned long currentRowNumber, numberOfRows, currentGeneration, nextScanRow;
+		vector< unsigned long > branchGenerations;
+
+		//Preloaded columns
+		bool isPreloaded;
+		vector< float > preloadedWeights;
+		vector< vector< float > > preloadedValues;
 		float currentEventNumber, currentEventWeight;
 		TBranch *eventNumberBranch, *eventWeightBranch;
 		vector< TBranch* > branches;
 		vector< float > currentValues;
 
 		//Mapping
-		map< float, long > eventNumberToRow;
-		map< float, long >::iterator eventIterator;
+		EventIndex eventIndex;
+		vector< UInt_t > rowEventNumbers;
 		map< string, int > columnNameToIndex;
 		map< string, int >::iterator columnIterator;
+		vector< int > handleToColumn;
 
 		//IO
 		TFile * inputFile;
 		TTree * wrappedNtuple;
+		string sourcePath, indexKey;
 		string sourceDescription;
 		unsigned int sourceDescriptionIndex;
 };
@@ -13,12 +13,14 @@
 
 #include "IFileInput.h"
 #include "ObservableList.h"
-#include <unordered_map>
+#include "EventIndex.h"
+#include "InputCut.h"
 #include <map>
 #include <vector>
 #include "TFile.h"
 #include "TTree.h"
 #include "TBranch.h"
+#include "TLeaf.h"
 #include "MonteCarloInformation.h"
 
 using namespace std;
@@ -27,8 +29,7 @@ class InputUETree : public IFileInput
 {
 	public:
 		InputUETree();
-		InputUETree( string FilePath, string NtuplePath, string Description, unsigned int InputIndex, ObservableList * RelevanceChecker,
-				string CutName = "NoCut", double CutMinimum = 0.0, double CutMaximum = 0.0 );
+		InputUETree( string FilePath, string NtuplePath, string Description, unsigned int InputIndex, ObservableList * RelevanceChecker, InputCut Cut = InputCut() );
 		virtual ~InputUETree();
 
 		//Change the Ntuple row being examined
@@ -43,6 +44,24 @@ class InputUETree : public IFileInput
 		virtual double GetValue( string VariableName );
 		virtual vector< double > * GetVector( string VectorName );
 
+		//Get any other column value by handle
+		virtual double GetValue( unsigned int ColumnHandle );
+		virtual vector< double > * GetVector( unsigned int VectorHandle );
+
+		//Get the event number of every row in a file, without loading the rows
+		virtual void GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers );
+
+		//Read all relevant columns of a file into memory at once, rather than one row at a time
+		virtual void PreloadColumns( unsigned int FileIndex );
+
+		//Declare that only ReadRow will be used, so no event number index is ever needed
+		virtual void SetSequentialOnly( bool SequentialOnly );
+
+		//Step through the rows of a file in order
+		virtual void StartScan( unsigned int FileIndex );
+		virtual bool HasNext();
+		virtual bool Next();
+
 		//Get the number of rows
 		virtual unsigned long NumberOfRows();
 		virtual unsigned long CurrentRow();
@@ -53,9 +72,35 @@ class InputUETree : public IFileInput
 		virtual string * Description();
 		virtual unsigned int DescriptionIndex();
 
+		//Get the names of the relevant columns found in the file
+		void RelevantColumnNames( vector< string > & ValueNames, vector< string > & VectorNames );
+
 	private:
+		//Whether a column holds a single number of a type the cut can read
+		static bool IsNumericLeaf( TLeaf * Leaf );
+
+		//Read the event numbers and make the index only when they are needed
+		void ReadEventNumbers();
+		void MakeEventIndex();
+		bool eventNumbersRead, sequentialOnly;
+
+		//Read columns only when they are needed
+		void LoadRow( unsigned long RowIndex );
+		void LoadColumn( unsigned int ColumnIndex );
+		void LoadVector( unsigned int VectorIndex );
+
+		//Find the row in the file, allowing for any cut
+		unsigned long InternalRow( unsigned long ExternalRow );
+
 		//Caching
-		unsigned long currentRowNumber;
+		unsigned long currentRowNumber, currentInternalRow, currentGeneration, nextScanRow;
+		vector< unsigned long > valueGenerations, vectorGenerations;
+
+		//Preloaded columns, with the vectors stored end to end
+		bool isPreloaded;
+		vector< double > preloadedWeights;
+		vector< vector< double > > preloadedValues, preloadedVectorValues;
+		vector< vector< unsigned long > > preloadedVectorStarts;
 		UInt_t currentEventNumber;
 		double currentEventWeight;
 		TBranch *eventNumberBranch, *eventWeightBranch;
@@ -65,16 +110,19 @@ class InputUETree : public IFileInput
 
 		//Mapping
 		unsigned long totalRows;
-		unordered_map< unsigned int, unsigned long > eventNumberToExternalRow;
-		unordered_map< unsigned int, unsigned long >::iterator eventIterator;
-		unordered_map< unsigned long, unsigned long > externalRowToInternalRow;
+		EventIndex eventIndex;
+		bool hasCut;
+		vector< UInt_t > selectedRows;
+		vector< UInt_t > rowEventNumbers;
 		map< string, unsigned int > columnNameToIndex;
 		map< string, unsigned int > vectorNameToIndex;
 		map< string, unsigned int >::iterator columnIterator;
+		vector< int > handleToColumn, handleToVector;
 
 		//IO
 		TFile * inputFile;
 		TTree * wrappedNtuple;
+		string sourcePath, indexKey;
 		string sourceDescription;
 		unsigned int sourceDescriptionIndex;
 };
@@ -16,6 +16,7 @@
 #include <string>
 #include <vector>
 #include "IFileInput.h"
+#include "InputCut.h"
 
 using namespace std;
 
@@ -32,6 +33,14 @@ class MonteCarloInformation
 		IFileInput * MakeTruthInput( unsigned int Index, ObservableList * RelevanceChecker );
 		IFileInput * MakeReconstructedInput( unsigned int Index, ObservableList * RelevanceChecker );
 
+		//Return the number of truth or reconstructed files for this MC sample, without opening any
+		unsigned int NumberOfTruthFiles( unsigned int Index );
+		unsigned int NumberOfReconstructedFiles( unsigned int Index );
+
+		//Select the events to read from the truth or reconstructed files of this MC sample (InputUETree files only)
+		void SetTruthCut( unsigned int Index, InputCut Cut );
+		void SetReconstructedCut( unsigned int Index, InputCut Cut );
+
 		//Return the colour and style of the line to plot for this MC sample
 		Color_t LineColour( unsigned int Index );
 		Style_t LineStyle( unsigned int Index );
@@ -41,7 +50,7 @@ class MonteCarloInformation
 
 	private:
 		//Make a file reader of the correct type
-		IFileInput * InstantiateSingleInput( string FilePath, string InternalPath, unsigned int Index, ObservableList * RelevanceChecker );
+		IFileInput * InstantiateSingleInput( string FilePath, string InternalPath, unsigned int Index, ObservableList * RelevanceChecker, InputCut Cut );
 
 		//Return the index of the additional files to combine for this MC sample
 		int FindExtraIndex( unsigned int RegularIndex );
@@ -52,6 +61,7 @@ class MonteCarloInformation
 		vector<string> descriptions, truthPaths, recoPaths, inputTypes, internalTruth, internalReco;
 		vector< Color_t > colours;
 		vector< Style_t > styles;
+		vector< InputCut > truthCuts, recoCuts;
 };
 
 #endif
@@ -37,13 +37,18 @@ class MonteCarloSummaryPlotMaker
 		void StoreFake( IFileInput * ReconstructedInput );
 		void StoreData( IFileInput * DataInput );
 
+		//Make an empty copy of this object, so MC events can be stored in parallel, then add them back to this one
+		MonteCarloSummaryPlotMaker * CloneForMerging();
+		void MergeEvents( MonteCarloSummaryPlotMaker * Other );
+
 		//Some plot formatting
 		void SetYRange( double Minimum, double Maximum );
 		void SetAxisLabels( string XAxis, string YAxis );
 		void UseLogScale();
 
 		//Do the calculation
-		void Process( int ErrorMode = 0, bool WithSmoothing = false );
+		//The MC cross-checks are shared between ThreadNumber threads (0 = one for each processor core)
+		void Process( int ErrorMode = 0, bool WithSmoothing = false, unsigned int ThreadNumber = 1 );
 
 		//Save result to given file
 		void SaveResult( TFile * OutputFile );
@@ -60,6 +65,7 @@ class MonteCarloSummaryPlotMaker
 		TCanvas * plotCanvas;
 		bool finalised, combineMode, manualRange, manualLabels, logScale;
 		vector< IPlotMaker* > allPlots;
+		int sharedSmearingIndex;
 		vector< TH1F* > truthHistograms, reconstructedHistograms;
 		TH1F *uncorrectedData, *correctedData, *statisticalErrors, *systematicErrors;
 		double yRangeMinimum, yRangeMaximum;
@@ -20,6 +20,9 @@ class ObservableList
 
 		bool IsInList( string TestName );
 
+		//Return all the names, in order
+		vector< string > AllNames();
+
 	private:
 		set< string > allNames;
 };
@@ -39,6 +39,24 @@ class TriggerChoosingInput : public IFileInput
 		virtual double GetValue( string VariableName );
 		virtual vector< double > * GetVector( string VectorName );
 
+		//Get any other column value by handle
+		virtual double GetValue( unsigned int ColumnHandle );
+		virtual vector< double > * GetVector( unsigned int VectorHandle );
+
+		//Get the event number of every row in a file, without loading the rows
+		virtual void GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers );
+
+		//Read all relevant columns of a file into memory at once, rather than one row at a time
+		virtual void PreloadColumns( unsigned int FileIndex );
+
+		//Declare that only ReadRow will be used, so no event number index is ever needed
+		virtual void SetSequentialOnly( bool SequentialOnly );
+
+		//Step through the rows of a file in order
+		virtual void StartScan( unsigned int FileIndex );
+		virtual bool HasNext();
+		virtual bool Next();
+
 		//Get the number of rows
 		virtual unsigned long NumberOfRows();
 		virtual unsigned long CurrentRow();
@@ -53,8 +71,8 @@ class TriggerChoosingInput : public IFileInput
 		string ReplaceString( string Input, string FindString, string ReplaceString );
 
 		//Caching
-		unsigned int currentFileNumber;
-		unsigned long totalRows, currentRowNumber;
+		unsigned int currentFileNumber, scanFileNumber;
+		unsigned long totalRows, currentRowNumber, nextScanRow;
 
 		//IO
 		vector< IFileInput* > triggerInputs;
@@ -13,6 +13,7 @@
 #include "IPlotMaker.h"
 #include "ICorrection.h"
 #include "IIndexCalculator.h"
+#include "FixedIndices.h"
 #include "TRandom3.h"
 #include <string>
 
@@ -37,6 +38,9 @@ class XPlotMaker : public IPlotMaker
 		virtual void StoreFake( IFileInput * ReconstructedInput );
 		virtual void StoreData( IFileInput * DataInput );
 
+		//Add the MC events stored in a copy of this object to this one
+		virtual void MergeEvents( IPlotMaker * Other );
+
 		//Do the unfolding
 		virtual void Correct( unsigned int MostIterations, bool SkipUnfolding = false, unsigned int ErrorMode = 0, bool WithSmoothing = false );
 
@@ -44,7 +48,7 @@ class XPlotMaker : public IPlotMaker
 		virtual bool ClosureTest( unsigned int MostIterations, bool WithSmoothing = false );
 
 		//Make a cross-check with MC
-		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false );
+		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false, ostream & Output = cout );
 
 		//Return a distribution for use in the cross-checks
 		virtual Distribution * PriorDistributionForCrossCheck();
@@ -61,6 +65,12 @@ class XPlotMaker : public IPlotMaker
 		//Copy the object
 		virtual XPlotMaker * Clone( string NewPriorName );
 
+		//Copy the object, using the smearing matrix of this one
+		virtual XPlotMaker * CloneShareSmearingMatrix( string NewPriorName );
+
+		//Unfold this plot and its copies from CloneShareSmearingMatrix all together
+		virtual void CorrectClones( vector< IPlotMaker* > Clones, unsigned int MostIterations, bool WithSmoothing = false );
+
 		//General info
 		virtual string Description( bool WithSpaces );
 		virtual string PriorName();
@@ -78,19 +88,27 @@ class XPlotMaker : public IPlotMaker
 	private:
 		//To be used with Clone
 		XPlotMaker( string XVariableName, string PriorName, IIndexCalculator * DistributionIndices,
-				unsigned int OriginalID, int CorrectionMode, double ScaleFactor, bool Normalise, vector<double> InputOffsets, vector<double> InputWidths );
+				unsigned int OriginalID, int CorrectionMode, double ScaleFactor, bool Normalise, vector<double> InputOffsets, vector<double> InputWidths,
+				ICorrection * SmearingMatrixSource = 0 );
 
 		//Instantiate the corrector
 		ICorrection * MakeCorrector( int CorrectionMode );
 
+		//Find the 1D version of the index calculator, so events can be binned without virtual calls
+		void FindFixedIndices();
+		unsigned int BinIndex( const double * Values );
+
 		int correctionType;
 		unsigned int thisPlotID;
 		ICorrection * XUnfolder;
 		vector< ICorrection* > systematicUnfolders;
 		vector< double > systematicOffsets, systematicWidths;
 		IIndexCalculator * distributionIndices;
+		FixedIndices< 1, UniformEdges > * uniformIndices;
+		FixedIndices< 1, CustomEdges > * customIndices;
 		TRandom3 * systematicRandom;
 		string xName, priorName;
+		unsigned int xHandle;
 		bool finalised, normalise;
 		double scaleFactor;
 		vector< double > correctedDataErrors;
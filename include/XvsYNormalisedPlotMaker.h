@@ -16,6 +16,7 @@
 #include "StatisticsSummary.h"
 #include "ICorrection.h"
 #include "IIndexCalculator.h"
+#include "FixedIndices.h"
 #include "TProfile.h"
 #include "TRandom3.h"
 
@@ -43,6 +44,9 @@ class XvsYNormalisedPlotMaker : public IPlotMaker
 		virtual void StoreFake( IFileInput * ReconstructedInput );
 		virtual void StoreData( IFileInput * DataInput );
 
+		//Add the MC events stored in a copy of this object to this one
+		virtual void MergeEvents( IPlotMaker * Other );
+
 		//Do the unfolding
 		virtual void Correct( unsigned int MostIterations, bool SkipUnfolding = false, unsigned int ErrorMode = 0, bool WithSmoothing = false );
 
@@ -50,7 +54,7 @@ class XvsYNormalisedPlotMaker : public IPlotMaker
                 virtual bool ClosureTest( unsigned int MostIterations, bool WithSmoothing = false );
 
 		//Make a cross-check with MC
-		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false );
+		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false, ostream & Output = cout );
 
 		//Return a distribution for use in the cross-checks
 		virtual Distribution * PriorDistributionForCrossCheck();
@@ -67,6 +71,12 @@ class XvsYNormalisedPlotMaker : public IPlotMaker
 		//Copy the object
 		virtual XvsYNormalisedPlotMaker * Clone( string NewPriorName );
 
+		//Copy the object, using the smearing matrix of this one
+		virtual XvsYNormalisedPlotMaker * CloneShareSmearingMatrix( string NewPriorName );
+
+		//Unfold this plot and its copies from CloneShareSmearingMatrix all together
+		virtual void CorrectClones( vector< IPlotMaker* > Clones, unsigned int MostIterations, bool WithSmoothing = false );
+
 		//General info
 		virtual string Description( bool WithSpaces );
 		virtual string PriorName();
@@ -84,11 +94,17 @@ class XvsYNormalisedPlotMaker : public IPlotMaker
 	private:
 		//To be used only with Clone
 		XvsYNormalisedPlotMaker( string XVariableName, string YVariableName, string PriorName,
-				IIndexCalculator * DistributionIndices, int CorrectionMode, unsigned int OriginalID, double ScaleFactor, vector< vector < double > > InputOffsets, vector< vector< double > > InputWidths );
+				IIndexCalculator * DistributionIndices, int CorrectionMode, unsigned int OriginalID, double ScaleFactor, vector< vector < double > > InputOffsets, vector< vector< double > > InputWidths,
+				ICorrection * SmearingMatrixSource = 0 );
 
 		//Instantiate an object to correct the data
 		ICorrection * MakeCorrector( int CorrectionMode, IIndexCalculator * CorrectionIndices, string CorrectionName, unsigned int CorrectionID );
 
+		//Find the 2D version of the index calculator, so events can be binned without virtual calls
+		void FindFixedIndices();
+		unsigned int BinIndex( const double * Values );
+		void StoreCentralValue( const double * Values, double Weight );
+
 		//WARNING: this method deletes the argument object
 		TH1F * MakeProfile( TH1F * LinearisedDistribution );
 		vector< double > DelineariseErrors( vector< double > InputSumWeightSquares );
@@ -99,7 +115,10 @@ class XvsYNormalisedPlotMaker : public IPlotMaker
 		ICorrection *XvsYUnfolder;
 		vector< ICorrection* > systematicUnfolders;
 		IIndexCalculator *distributionIndices;
+		FixedIndices< 2, UniformEdges > *uniformIndices;
+		FixedIndices< 2, CustomEdges > *customIndices;
 		string xName, yName, priorName;
+		unsigned int xHandle, yHandle;
 		bool finalised, doPlotSmearing;
 		double scaleFactor, xMinimum, yMinimum, xMaximum, yMaximum;
 		vector< double > correctedDataErrors;
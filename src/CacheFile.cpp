@@ -0,0 +1,77 @@
+/**
+  @class CacheFile
+
+  Shared helpers for the files saved to speed up later runs - the event caches and the event number indices
+  Each file is named from a hash of its description, records the state of its source file, and is written in one go
+ */
+
+#include "CacheFile.h"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <thread>
+#include <functional>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const unsigned long long FNV_PRIME = 1099511628211ULL;
+
+//Find the size and modification time of a source file
+bool CacheFile::SourceStatus( string SourcePath, unsigned long & Size, unsigned long & Modified )
+{
+	struct stat sourceStatus;
+	if ( stat( SourcePath.c_str(), &sourceStatus ) != 0 )
+	{
+		return false;
+	}
+
+	Size = sourceStatus.st_size;
+	Modified = sourceStatus.st_mtime;
+	return true;
+}
+
+//A hash of a description for naming a file, written in hex
+string CacheFile::KeyHash( string Key )
+{
+	unsigned long long hash = FNV_OFFSET_BASIS;
+	for ( unsigned int characterIndex = 0; characterIndex < Key.size(); characterIndex++ )
+	{
+		hash ^= ( unsigned char )Key[ characterIndex ];
+		hash *= FNV_PRIME;
+	}
+
+	stringstream hashStream;
+	hashStream << hex << hash;
+	return hashStream.str();
+}
+
+//Open a temporary file to write instead of the final one
+bool CacheFile::OpenTemporary( string FinalPath, string FileType, ofstream & Output, string & TemporaryPath )
+{
+	//The name is different for each process and thread, so files written at the same time don't mix
+	stringstream temporaryStream;
+	temporaryStream << FinalPath << ".tmp" << getpid() << "." << hash< thread::id >()( this_thread::get_id() );
+	TemporaryPath = temporaryStream.str();
+
+	Output.open( TemporaryPath.c_str(), ios::out | ios::binary | ios::trunc );
+	if ( !Output.is_open() )
+	{
+		cout << "WARNING: Could not write " << FileType << " " << TemporaryPath << endl;
+		return false;
+	}
+	return true;
+}
+
+//Close the temporary file and move it into place
+bool CacheFile::MoveIntoPlace( ofstream & Output, string TemporaryPath, string FinalPath, string FileType )
+{
+	Output.close();
+	if ( Output.fail() || rename( TemporaryPath.c_str(), FinalPath.c_str() ) != 0 )
+	{
+		cout << "WARNING: Could not write " << FileType << " " << FinalPath << endl;
+		remove( TemporaryPath.c_str() );
+		return false;
+	}
+	return true;
+}
@@ -8,8 +8,7 @@
  */
 
 #include "CombinedFileInput.h"
-#include "InputNtuple.h"
-#include "InputUETree.h"
+#include "InputEventCache.h"
 #include "TriggerChoosingInput.h"
 #include <iostream>
 #include <cstdlib>
@@ -20,12 +19,14 @@ const string TRIGGER_CHOOSING_TYPE_STRING = "TriggerChoosingInput";
 
 const double JET_PT_CUTS[] = { 30000.0, 50000.0, 100000.0, 170000.0, 320000.0, 600000.0, 1180000.0 };
 
+bool CombinedFileInput::m_prefetchNextFile = false;
+
 CombinedFileInput::CombinedFileInput()
 {
 }
 
 CombinedFileInput::CombinedFileInput( vector< string > FilePaths, vector< double > FileWeights, string InternalPath, string InputType, string Description,
-		unsigned int DescriptionIndex, ObservableList * RelevanceChecker )
+		unsigned int DescriptionIndex, ObservableList * RelevanceChecker, InputCut Cut )
 {
 	m_sourceDescription = Description;
 	m_sourceIndex = DescriptionIndex;
@@ -33,11 +34,15 @@ CombinedFileInput::CombinedFileInput( vector< string > FilePaths, vector< double
 	m_filePaths = FilePaths;
 	m_internalPath = InternalPath;
 	m_inputType = InputType;
-	m_currentFile = 0;
+	m_currentFile = FilePaths.size();
 	m_rowInCurrentFile = 0;
 	m_currentInput = 0;
+	m_prefetchedInput = 0;
+	m_prefetchedFile = -1;
 	m_pTcuts = vector<double>( JET_PT_CUTS, JET_PT_CUTS + sizeof( JET_PT_CUTS ) / sizeof( double ) );
 	m_relevanceChecker = RelevanceChecker;
+	m_sequentialOnly = false;
+	m_cut = Cut;
 
 	//Check the input
 	if ( FilePaths.size() < 1 )
@@ -50,13 +55,19 @@ CombinedFileInput::CombinedFileInput( vector< string > FilePaths, vector< double
 		cerr << "Mismatch in number of input files and number of file weights" << endl;
 		exit(1);
 	}
+	else if ( Cut.NumberOfRanges() > 0 && InputType != UE_TREE_TYPE_STRING )
+	{
+		cerr << "Input cuts can only be applied to " << UE_TREE_TYPE_STRING << " files, not " << InputType << endl;
+		exit(1);
+	}
 
-	//Load the first file
-	ChangeInputFile( 0 );
+	//No file is opened until one is asked for (m_currentFile starts out of range), so making the input reads nothing
 }
 
 CombinedFileInput::~CombinedFileInput()
 {
+	FinishPrefetch();
+	delete m_prefetchedInput;
 	m_filePaths.clear();
 	m_fileWeights.clear();
 	delete m_currentInput;
@@ -130,6 +141,100 @@ vector< double > * CombinedFileInput::GetVector( string VectorName )
 	return m_currentInput->GetVector( VectorName );
 }
 
+//Get any other column value by handle - the handles are the same for every file
+double CombinedFileInput::GetValue( unsigned int ColumnHandle )
+{
+	return m_currentInput->GetValue( ColumnHandle );
+}
+vector< double > * CombinedFileInput::GetVector( unsigned int VectorHandle )
+{
+	return m_currentInput->GetVector( VectorHandle );
+}
+
+//Get the event number of every row in a file, without loading the rows
+void CombinedFileInput::GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers )
+{
+	//Check we're asking for a valid file
+	if ( FileIndex < m_filePaths.size() )
+	{
+		//See if we've already got the file loaded
+		if ( FileIndex != m_currentFile )
+		{
+			//Load the new file
+			ChangeInputFile( FileIndex );
+		}
+
+		m_currentInput->GetEventNumbers( 0, EventNumbers );
+	}
+	else
+	{
+		cerr << "Requested invalid file " << FileIndex << " of " << m_filePaths.size() << endl;
+		exit(1);
+	}
+}
+
+//Read all relevant columns of a file into memory at once
+void CombinedFileInput::PreloadColumns( unsigned int FileIndex )
+{
+	//Check we're asking for a valid file
+	if ( FileIndex < m_filePaths.size() )
+	{
+		//See if we've already got the file loaded
+		if ( FileIndex != m_currentFile )
+		{
+			//Load the new file
+			ChangeInputFile( FileIndex );
+		}
+
+		m_currentInput->PreloadColumns( 0 );
+	}
+	else
+	{
+		cerr << "Requested invalid file " << FileIndex << " of " << m_filePaths.size() << endl;
+		exit(1);
+	}
+}
+
+//Declare that only ReadRow will be used - also applies to files opened later
+void CombinedFileInput::SetSequentialOnly( bool SequentialOnly )
+{
+	m_sequentialOnly = SequentialOnly;
+	if ( m_currentInput )
+	{
+		m_currentInput->SetSequentialOnly( SequentialOnly );
+	}
+}
+
+//Step through the rows of a file in order
+void CombinedFileInput::StartScan( unsigned int FileIndex )
+{
+	//Check we're asking for a valid file
+	if ( FileIndex < m_filePaths.size() )
+	{
+		//See if we've already got the file loaded
+		if ( FileIndex != m_currentFile )
+		{
+			//Load the new file
+			ChangeInputFile( FileIndex );
+		}
+
+		m_currentInput->StartScan( 0 );
+	}
+	else
+	{
+		cerr << "Requested invalid file " << FileIndex << " of " << m_filePaths.size() << endl;
+		exit(1);
+	}
+}
+bool CombinedFileInput::HasNext()
+{
+	return m_currentInput->HasNext();
+}
+bool CombinedFileInput::Next()
+{
+	return m_currentInput->Next();
+}
+
 //Get the number of rows
 unsigned long CombinedFileInput::NumberOfRows()
 {
@@ -160,34 +265,67 @@ unsigned int CombinedFileInput::DescriptionIndex()
 	return m_sourceIndex;
 }
 
+//Set whether the next file is opened in the background while the current one is read
+void CombinedFileInput::SetPrefetchNextFile( bool PrefetchNextFile )
+{
+	m_prefetchNextFile = PrefetchNextFile;
+}
+
 void CombinedFileInput::ChangeInputFile( unsigned int NewFileIndex )
 {
 	m_currentFile = NewFileIndex;
+
+	//Wait for any file being opened in the background before closing one here, since both change ROOT's global state
+	FinishPrefetch();
 	if ( m_currentInput )
 	{
-        	delete m_currentInput;
+		delete m_currentInput;
+	}
+
+	//Use the file opened in the background if it's the right one
+	if ( m_prefetchedFile == ( int )NewFileIndex )
+	{
+		m_currentInput = m_prefetchedInput;
+	}
+	else
+	{
+		delete m_prefetchedInput;
+		m_currentInput = OpenInputFile( NewFileIndex );
 	}
+	m_prefetchedInput = 0;
+	m_prefetchedFile = -1;
+
+	m_currentInput->SetSequentialOnly( m_sequentialOnly );
+
+	//Start opening the next file
+	StartPrefetch();
+}
+
+//Make the input for one of the files
+IFileInput * CombinedFileInput::OpenInputFile( unsigned int FileIndex )
+{
+	IFileInput * newInput;
 
 	//Choose the type of file to open
 	if ( m_inputType == NTUPLE_TYPE_STRING )
 	{
-		m_currentInput = new InputNtuple( m_filePaths[ m_currentFile ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker );
+		newInput = InputEventCache::OpenNtuple( m_filePaths[ FileIndex ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker );
 	}
 	else if ( m_inputType == UE_TREE_TYPE_STRING )
 	{
-		m_currentInput = new InputUETree( m_filePaths[ m_currentFile ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker );
+		newInput = InputEventCache::OpenUETree( m_filePaths[ FileIndex ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker, m_cut );
 	}
 	else if ( m_inputType == TRIGGER_CHOOSING_TYPE_STRING )
 	{
 		//if ( m_pTcuts.size() == m_filePaths.size() )
-		if ( m_fileWeights[ m_currentFile ] != 1.0 )
+		if ( m_fileWeights[ FileIndex ] != 1.0 )
 		{
 			cout << "WARNING: CombinedFileInput + TriggerChoosingInput means using a hard-coded pT cut from the underlying event analysis. If you're unsure what that means then don't use it!" << endl;
-			m_currentInput = new TriggerChoosingInput( m_filePaths[ m_currentFile ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker, m_pTcuts[ m_currentFile ] );
+			newInput = new TriggerChoosingInput( m_filePaths[ FileIndex ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker, m_pTcuts[ FileIndex ] );
 		}
 		else
 		{
-			m_currentInput = new TriggerChoosingInput( m_filePaths[ m_currentFile ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker );
+			newInput = new TriggerChoosingInput( m_filePaths[ FileIndex ], m_internalPath, m_sourceDescription, m_sourceIndex, m_relevanceChecker );
 		}
 	}
 	else
@@ -195,4 +333,32 @@ void CombinedFileInput::ChangeInputFile( unsigned int NewFileIndex )
 		cerr << "Unrecognised input type: " << m_inputType << endl;
 		exit(1);
 	}
+
+	return newInput;
+}
+
+//Open the file after the current one in another thread
+void CombinedFileInput::StartPrefetch()
+{
+	unsigned int nextFile = m_currentFile + 1;
+	if ( m_prefetchNextFile && nextFile < m_filePaths.size() )
+	{
+		m_prefetchedFile = nextFile;
+		m_prefetchThread = thread( &CombinedFileInput::PrefetchWorker, this, nextFile );
+	}
+}
+
+//Wait for the background thread to finish opening a file
+void CombinedFileInput::FinishPrefetch()
+{
+	if ( m_prefetchThread.joinable() )
+	{
+		m_prefetchThread.join();
+	}
+}
+
+//Open a file - the event number index is still only made if it's needed
+void CombinedFileInput::PrefetchWorker( unsigned int FileIndex )
+{
+	m_prefetchedInput = OpenInputFile( FileIndex );
 }
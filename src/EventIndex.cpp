@@ -0,0 +1,264 @@
+/**
+  @class EventIndex
+
+  Finds the row holding an event number, using a sorted array of event numbers
+  The index can be saved in a file next to the input file, and mapped into memory by later runs
+ */
+
+#include "EventIndex.h"
+#include "CacheFile.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//File format: magic, format version, source file size and modification time, length of the description then the description,
+//number of entries, then the sorted event numbers and their rows - all 64-bit numbers in machine byte order
+const char INDEX_MAGIC[ 8 ] = { 'I', 'M', 'G', 'I', 'N', 'D', 'E', 'X' };
+const unsigned long INDEX_VERSION = 1;
+const string INDEX_EXTENSION = ".eventindex";
+
+bool EventIndex::useIndexFiles = true;
+
+//Set whether index files are read and written
+void EventIndex::SetUseIndexFiles( bool UseIndexFiles )
+{
+	useIndexFiles = UseIndexFiles;
+}
+
+//Name the index file from the source path and a hash of the description - the full description is checked when the file is read
+string EventIndex::IndexPath( string SourcePath, string IndexKey )
+{
+	stringstream pathStream;
+	pathStream << SourcePath << "." << CacheFile::KeyHash( IndexKey ) << INDEX_EXTENSION;
+	return pathStream.str();
+}
+
+//Constructor - the index is empty until it's made or read
+EventIndex::EventIndex()
+{
+	isReady = false;
+	entryNumber = 0;
+	sortedEventNumbers = 0;
+	sortedRows = 0;
+	mappedFile = 0;
+	mappedSize = 0;
+}
+
+//Destructor
+EventIndex::~EventIndex()
+{
+	Unmap();
+}
+
+void EventIndex::Unmap()
+{
+	if ( mappedFile )
+	{
+		munmap( mappedFile, mappedSize );
+		mappedFile = 0;
+		mappedSize = 0;
+	}
+}
+
+//Make the index from the event number of each row
+void EventIndex::Build( const UInt_t * RowEventNumbers, unsigned long RowNumber )
+{
+	Unmap();
+
+	//Sort (event number, row) pairs
+	vector< pair< UInt_t, UInt_t > > allPairs( RowNumber );
+	for ( unsigned long rowIndex = 0; rowIndex < RowNumber; rowIndex++ )
+	{
+		allPairs[ rowIndex ] = make_pair( RowEventNumbers[ rowIndex ], ( UInt_t )rowIndex );
+	}
+	sort( allPairs.begin(), allPairs.end() );
+
+	//Store each event number once, with the last row that has it
+	builtEventNumbers.clear();
+	builtRows.clear();
+	for ( unsigned long pairIndex = 0; pairIndex < allPairs.size(); pairIndex++ )
+	{
+		if ( pairIndex + 1 < allPairs.size() && allPairs[ pairIndex + 1 ].first == allPairs[ pairIndex ].first )
+		{
+			continue;
+		}
+
+		builtEventNumbers.push_back( allPairs[ pairIndex ].first );
+		builtRows.push_back( allPairs[ pairIndex ].second );
+	}
+
+	entryNumber = builtEventNumbers.size();
+	sortedEventNumbers = builtEventNumbers.data();
+	sortedRows = builtRows.data();
+	isReady = true;
+}
+
+//Read the index file for a source, returning false if it doesn't exist or doesn't match the source file
+bool EventIndex::ReadFile( string SourcePath, string IndexKey )
+{
+	//Find out about the source file
+	unsigned long sourceSize, sourceModified;
+	if ( !useIndexFiles || sizeof( unsigned long ) != 8 || !CacheFile::SourceStatus( SourcePath, sourceSize, sourceModified ) )
+	{
+		return false;
+	}
+
+	//Open the index file
+	int fileDescriptor = open( IndexPath( SourcePath, IndexKey ).c_str(), O_RDONLY );
+	if ( fileDescriptor < 0 )
+	{
+		return false;
+	}
+	struct stat indexStatus;
+	if ( fstat( fileDescriptor, &indexStatus ) != 0 || indexStatus.st_size < 48 )
+	{
+		close( fileDescriptor );
+		return false;
+	}
+
+	//Map it into memory
+	unsigned long fileSize = indexStatus.st_size;
+	void * mapping = mmap( 0, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+	close( fileDescriptor );
+	if ( mapping == MAP_FAILED )
+	{
+		return false;
+	}
+	char * file = ( char* )mapping;
+
+	//Check the header
+	unsigned long header[ 5 ];
+	memcpy( header, file + 8, 5 * sizeof( unsigned long ) );
+	unsigned long keyLength = header[ 4 ];
+	unsigned long keyEnd = 48 + keyLength + ( 8 - keyLength % 8 ) % 8;
+	bool isValid = ( memcmp( file, INDEX_MAGIC, 8 ) == 0 && header[ 0 ] == INDEX_VERSION && header[ 1 ] == sourceSize && header[ 2 ] == sourceModified
+			&& keyEnd + 8 <= fileSize && string( file + 48, keyLength ) == IndexKey );
+
+	//Find the entries
+	unsigned long entries = 0;
+	if ( isValid )
+	{
+		memcpy( &entries, file + keyEnd, sizeof( unsigned long ) );
+		unsigned long entryLength = entries * sizeof( UInt_t );
+		isValid = ( keyEnd + 8 + entryLength + ( 8 - entryLength % 8 ) % 8 + entryLength <= fileSize );
+	}
+	if ( !isValid )
+	{
+		munmap( file, fileSize );
+		return false;
+	}
+
+	//Use the mapped file
+	Unmap();
+	builtEventNumbers.clear();
+	builtRows.clear();
+	mappedFile = file;
+	mappedSize = fileSize;
+	entryNumber = entries;
+	unsigned long entryLength = entries * sizeof( UInt_t );
+	entryLength += ( 8 - entryLength % 8 ) % 8;
+	sortedEventNumbers = ( const UInt_t* )( file + keyEnd + 8 );
+	sortedRows = ( const UInt_t* )( file + keyEnd + 8 + entryLength );
+	isReady = true;
+	return true;
+}
+
+//Write the index file for a source - just prints a warning if the file can't be written
+void EventIndex::WriteFile( string SourcePath, string IndexKey )
+{
+	unsigned long sourceSize, sourceModified;
+	if ( !useIndexFiles || !isReady || sizeof( unsigned long ) != 8 || !CacheFile::SourceStatus( SourcePath, sourceSize, sourceModified ) )
+	{
+		return;
+	}
+
+	//Write to a temporary file, then move it into place so the index is never seen half-written
+	string indexPath = IndexPath( SourcePath, IndexKey );
+	ofstream output;
+	string temporaryPath;
+	if ( !CacheFile::OpenTemporary( indexPath, "event index", output, temporaryPath ) )
+	{
+		return;
+	}
+
+	//Header
+	unsigned long header[ 5 ] = { INDEX_VERSION, sourceSize, sourceModified, 0, IndexKey.size() };
+	output.write( INDEX_MAGIC, 8 );
+	output.write( ( const char* )header, 5 * sizeof( unsigned long ) );
+	output.write( IndexKey.c_str(), IndexKey.size() );
+	for ( unsigned long padding = IndexKey.size(); padding % 8 != 0; padding++ )
+	{
+		output.put( '\0' );
+	}
+
+	//Entries
+	unsigned long entryLength = entryNumber * sizeof( UInt_t );
+	output.write( ( const char* )&entryNumber, sizeof( unsigned long ) );
+	output.write( ( const char* )sortedEventNumbers, entryLength );
+	for ( unsigned long padding = entryLength; padding % 8 != 0; padding++ )
+	{
+		output.put( '\0' );
+	}
+	output.write( ( const char* )sortedRows, entryLength );
+
+	CacheFile::MoveIntoPlace( output, temporaryPath, indexPath, "event index" );
+}
+
+//Check whether the index has been made or read
+bool EventIndex::IsReady()
+{
+	return isReady;
+}
+
+//Find the row for an event number - the last row, if the number is repeated
+bool EventIndex::FindRow( UInt_t EventNumber, unsigned long & RowIndex )
+{
+	if ( entryNumber == 0 || EventNumber < sortedEventNumbers[ 0 ] || EventNumber > sortedEventNumbers[ entryNumber - 1 ] )
+	{
+		return false;
+	}
+
+	//Interpolation search - event numbers are usually spread evenly, so this takes a few steps
+	unsigned long low = 0;
+	unsigned long high = entryNumber - 1;
+	for ( unsigned int step = 0; step < 8 && high - low > 16; step++ )
+	{
+		double fraction = ( double )( EventNumber - sortedEventNumbers[ low ] ) / ( double )( sortedEventNumbers[ high ] - sortedEventNumbers[ low ] );
+		unsigned long guess = low + ( unsigned long )( fraction * ( double )( high - low ) );
+		if ( sortedEventNumbers[ guess ] < EventNumber )
+		{
+			low = guess + 1;
+		}
+		else if ( sortedEventNumbers[ guess ] > EventNumber )
+		{
+			high = guess - 1;
+		}
+		else
+		{
+			RowIndex = sortedRows[ guess ];
+			return true;
+		}
+
+		if ( low > high || EventNumber < sortedEventNumbers[ low ] || EventNumber > sortedEventNumbers[ high ] )
+		{
+			return false;
+		}
+	}
+
+	//Binary search for whatever is left
+	const UInt_t * found = lower_bound( sortedEventNumbers + low, sortedEventNumbers + high + 1, EventNumber );
+	if ( found != sortedEventNumbers + high + 1 && *found == EventNumber )
+	{
+		RowIndex = sortedRows[ found - sortedEventNumbers ];
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
@@ -0,0 +1,56 @@
+/**
+  @interface IFileInput
+
+  A general interface for any class that loads data from Root files
+
+  @author Benjamin M Wynne bwynne@cern.ch
+  @date 06-04-2011
+ */
+
+#include "IFileInput.h"
+#include <map>
+#include <mutex>
+#include <iostream>
+#include <cstdlib>
+
+//Column handles shared by all inputs
+map< string, unsigned int > columnNameToHandle;
+vector< string > handleToColumnName;
+mutex columnHandleMutex;
+
+//Get a handle for a column name, which is the same for all inputs
+unsigned int IFileInput::BindColumn( string ColumnName )
+{
+	lock_guard< mutex > handleLock( columnHandleMutex );
+
+	//Check if the name already has a handle
+	map< string, unsigned int >::iterator handleIterator = columnNameToHandle.find( ColumnName );
+	if ( handleIterator == columnNameToHandle.end() )
+	{
+		//Make a new handle
+		unsigned int newHandle = handleToColumnName.size();
+		columnNameToHandle[ ColumnName ] = newHandle;
+		handleToColumnName.push_back( ColumnName );
+		return newHandle;
+	}
+	else
+	{
+		return handleIterator->second;
+	}
+}
+
+//Get the column name for a handle
+string IFileInput::ColumnName( unsigned int ColumnHandle )
+{
+	lock_guard< mutex > handleLock( columnHandleMutex );
+
+	if ( ColumnHandle < handleToColumnName.size() )
+	{
+		return handleToColumnName[ ColumnHandle ];
+	}
+	else
+	{
+		cerr << "Unrecognised column handle: " << ColumnHandle << endl;
+		exit(1);
+	}
+}
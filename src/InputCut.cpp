@@ -0,0 +1,76 @@
+/**
+  @class InputCut
+
+  A selection applied when an input file is opened: a list of ranges, all of which an event must pass
+  Only the columns in the cut are read to find the selected rows, so rejected events are never loaded
+ */
+
+#include "InputCut.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+
+//No cut - every event passes
+InputCut::InputCut()
+{
+}
+
+//A cut with a single range
+InputCut::InputCut( string ColumnName, double Minimum, double Maximum )
+{
+	AddRange( ColumnName, Minimum, Maximum );
+}
+
+//Destructor
+InputCut::~InputCut()
+{
+}
+
+//Require Minimum <= value <= Maximum for a column, as well as all the other ranges
+void InputCut::AddRange( string ColumnName, double Minimum, double Maximum )
+{
+	if ( Minimum > Maximum )
+	{
+		cerr << "Cut on " << ColumnName << " has minimum " << Minimum << " above maximum " << Maximum << endl;
+		exit(1);
+	}
+
+	columnNames.push_back( ColumnName );
+	minima.push_back( Minimum );
+	maxima.push_back( Maximum );
+}
+
+//Access the ranges
+unsigned int InputCut::NumberOfRanges()
+{
+	return columnNames.size();
+}
+string InputCut::ColumnName( unsigned int RangeIndex )
+{
+	return columnNames[ RangeIndex ];
+}
+bool InputCut::InRange( unsigned int RangeIndex, double Value )
+{
+	return ( Value >= minima[ RangeIndex ] && Value <= maxima[ RangeIndex ] );
+}
+
+//Describe the cut, so saved files are only used again for the same selection
+string InputCut::Description()
+{
+	if ( columnNames.size() == 0 )
+	{
+		return "NoCut";
+	}
+
+	stringstream descriptionStream;
+	descriptionStream.precision( 17 );
+	for ( unsigned int rangeIndex = 0; rangeIndex < columnNames.size(); rangeIndex++ )
+	{
+		if ( rangeIndex > 0 )
+		{
+			descriptionStream << " && ";
+		}
+		descriptionStream << minima[ rangeIndex ] << " <= " << columnNames[ rangeIndex ] << " <= " << maxima[ rangeIndex ];
+	}
+	return descriptionStream.str();
+}
@@ -0,0 +1,676 @@
+/**
+  @class InputEventCache
+
+  Reads the relevant columns of one input file from a flat binary cache, mapped into memory
+  The cache is written the first time a file is read, and used again until the file or the list of observables changes
+ */
+
+#include "InputEventCache.h"
+#include "InputNtuple.h"
+#include "InputUETree.h"
+#include "CacheFile.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//File format: all numbers little-endian, everything aligned to 8 bytes
+//
+//Header:  "IMAGIRO" magic, format version, source file size and modification time, number of rows,
+//         description of the input, observable names, value column names, vector column names
+//Columns: event numbers, event weights, then each value column for all rows,
+//         then for each vector column the number of values, the start of each row, and the values end to end
+const char CACHE_MAGIC[ 8 ] = { 'I', 'M', 'A', 'G', 'I', 'R', 'O', '\0' };
+const unsigned long CACHE_VERSION = 1;
+const string CACHE_EXTENSION = ".imagirocache";
+
+string InputEventCache::cacheDirectory = "";
+
+//Helpers for writing the cache
+void WritePadding( ofstream & Output, unsigned long Length )
+{
+	while ( Length % 8 != 0 )
+	{
+		Output.put( '\0' );
+		Length++;
+	}
+}
+void WriteNumber( ofstream & Output, unsigned long Number )
+{
+	Output.write( ( const char* )&Number, sizeof( unsigned long ) );
+}
+void WriteString( ofstream & Output, string Value )
+{
+	WriteNumber( Output, Value.size() );
+	Output.write( Value.c_str(), Value.size() );
+	WritePadding( Output, Value.size() );
+}
+void WriteStrings( ofstream & Output, vector< string > Values )
+{
+	WriteNumber( Output, Values.size() );
+	for ( unsigned int valueIndex = 0; valueIndex < Values.size(); valueIndex++ )
+	{
+		WriteString( Output, Values[ valueIndex ] );
+	}
+}
+
+//Helpers for reading the cache - return false if the file is too short
+bool ReadNumber( const char * File, unsigned long FileSize, unsigned long & Position, unsigned long & Number )
+{
+	if ( Position + sizeof( unsigned long ) > FileSize )
+	{
+		return false;
+	}
+
+	memcpy( &Number, File + Position, sizeof( unsigned long ) );
+	Position += sizeof( unsigned long );
+	return true;
+}
+bool ReadString( const char * File, unsigned long FileSize, unsigned long & Position, string & Value )
+{
+	unsigned long length;
+	if ( !ReadNumber( File, FileSize, Position, length ) || Position + length > FileSize )
+	{
+		return false;
+	}
+
+	Value = string( File + Position, length );
+	Position += length + ( 8 - length % 8 ) % 8;
+	return true;
+}
+bool ReadStrings( const char * File, unsigned long FileSize, unsigned long & Position, vector< string > & Values )
+{
+	unsigned long valueNumber;
+	if ( !ReadNumber( File, FileSize, Position, valueNumber ) )
+	{
+		return false;
+	}
+
+	Values.clear();
+	for ( unsigned long valueIndex = 0; valueIndex < valueNumber; valueIndex++ )
+	{
+		string value;
+		if ( !ReadString( File, FileSize, Position, value ) )
+		{
+			return false;
+		}
+		Values.push_back( value );
+	}
+
+	return true;
+}
+
+//The cache holds numbers as they are in memory, so it can only be used on little-endian machines with 64-bit longs
+bool CacheFormatSupported()
+{
+	unsigned int endianTest = 1;
+	return ( *( ( char* )&endianTest ) == 1 && sizeof( unsigned long ) == 8 );
+}
+
+//Default constructor - useless
+InputEventCache::InputEventCache()
+{
+}
+
+//Constructor mapping a cache file into memory - check IsValid before using it
+InputEventCache::InputEventCache( string CachePath, string CacheKey, string SourcePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker,
+		bool FloatEventNumbers )
+{
+	sourceDescription = Description;
+	sourceDescriptionIndex = DescriptionIndex;
+	isValid = false;
+	mappedFile = 0;
+	mappedSize = 0;
+	readPosition = 0;
+	totalRows = 0;
+	currentRowNumber = 0;
+	currentGeneration = 1;
+	sequentialOnly = false;
+	floatEventNumbers = FloatEventNumbers;
+	nextScanRow = 0;
+
+	//Open the file
+	int fileDescriptor = open( CachePath.c_str(), O_RDONLY );
+	if ( fileDescriptor < 0 )
+	{
+		return;
+	}
+	struct stat cacheStatus;
+	if ( fstat( fileDescriptor, &cacheStatus ) != 0 || cacheStatus.st_size == 0 )
+	{
+		close( fileDescriptor );
+		return;
+	}
+
+	//Map it into memory
+	mappedSize = cacheStatus.st_size;
+	void * mapping = mmap( 0, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+	close( fileDescriptor );
+	if ( mapping == MAP_FAILED )
+	{
+		mappedSize = 0;
+		return;
+	}
+	mappedFile = ( char* )mapping;
+
+	//Check the contents
+	isValid = ReadHeader( CacheKey, SourcePath, RelevanceChecker );
+}
+
+//Destructor
+InputEventCache::~InputEventCache()
+{
+	if ( mappedFile )
+	{
+		munmap( mappedFile, mappedSize );
+	}
+}
+
+//Make an input for an Ntuple file, using the cache if possible
+IFileInput * InputEventCache::OpenNtuple( string FilePath, string NtuplePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker )
+{
+	//Try the cache
+	string cacheKey = "InputNtuple " + FilePath + " " + NtuplePath;
+	string cachePath = CachePath( cacheKey );
+	if ( cachePath != "" )
+	{
+		InputEventCache * cachedInput = new InputEventCache( cachePath, cacheKey, FilePath, Description, DescriptionIndex, RelevanceChecker, true );
+		if ( cachedInput->IsValid() )
+		{
+			return cachedInput;
+		}
+		delete cachedInput;
+	}
+
+	//Read the file itself, and write a cache for next time
+	InputNtuple * fileInput = new InputNtuple( FilePath, NtuplePath, Description, DescriptionIndex, RelevanceChecker );
+	if ( cachePath != "" )
+	{
+		vector< string > valueNames, vectorNames;
+		fileInput->RelevantColumnNames( valueNames, vectorNames );
+		WriteCache( cachePath, cacheKey, FilePath, RelevanceChecker, fileInput, valueNames, vectorNames );
+	}
+	return fileInput;
+}
+
+//Make an input for a UE tree file, using the cache if possible
+IFileInput * InputEventCache::OpenUETree( string FilePath, string NtuplePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker,
+		InputCut Cut )
+{
+	//Try the cache
+	string cacheKey = "InputUETree " + FilePath + " " + NtuplePath + " " + Cut.Description();
+	string cachePath = CachePath( cacheKey );
+	if ( cachePath != "" )
+	{
+		InputEventCache * cachedInput = new InputEventCache( cachePath, cacheKey, FilePath, Description, DescriptionIndex, RelevanceChecker );
+		if ( cachedInput->IsValid() )
+		{
+			return cachedInput;
+		}
+		delete cachedInput;
+	}
+
+	//Read the file itself, and write a cache for next time
+	InputUETree * fileInput = new InputUETree( FilePath, NtuplePath, Description, DescriptionIndex, RelevanceChecker, Cut );
+	if ( cachePath != "" )
+	{
+		vector< string > valueNames, vectorNames;
+		fileInput->RelevantColumnNames( valueNames, vectorNames );
+		WriteCache( cachePath, cacheKey, FilePath, RelevanceChecker, fileInput, valueNames, vectorNames );
+	}
+	return fileInput;
+}
+
+//Set the directory for the cache files - no caching if empty
+void InputEventCache::SetCacheDirectory( string Directory )
+{
+	if ( Directory != "" && !CacheFormatSupported() )
+	{
+		cout << "WARNING: Event cache not supported on this machine - reading input files directly" << endl;
+		Directory = "";
+	}
+
+	cacheDirectory = Directory;
+}
+
+//Find the cache file for an input
+string InputEventCache::CachePath( string CacheKey )
+{
+	if ( cacheDirectory == "" )
+	{
+		return "";
+	}
+
+	//Name the file from a hash of the description - the full description is checked when the file is read
+	stringstream pathStream;
+	pathStream << cacheDirectory << "/" << CacheFile::KeyHash( CacheKey ) << CACHE_EXTENSION;
+	return pathStream.str();
+}
+
+//Write the cache for an input that has just been opened
+void InputEventCache::WriteCache( string CachePath, string CacheKey, string SourcePath, ObservableList * RelevanceChecker, IFileInput * Source,
+		vector< string > ValueNames, vector< string > VectorNames )
+{
+	unsigned long sourceSize, sourceModified;
+	if ( !CacheFile::SourceStatus( SourcePath, sourceSize, sourceModified ) )
+	{
+		return;
+	}
+
+	//Read all the events
+	unsigned long rowNumber = Source->NumberOfRows();
+	vector< UInt_t > allEventNumbers( rowNumber );
+	vector< double > allWeights( rowNumber );
+	vector< unsigned int > valueHandles, vectorHandles;
+	for ( unsigned int columnIndex = 0; columnIndex < ValueNames.size(); columnIndex++ )
+	{
+		valueHandles.push_back( IFileInput::BindColumn( ValueNames[ columnIndex ] ) );
+	}
+	for ( unsigned int columnIndex = 0; columnIndex < VectorNames.size(); columnIndex++ )
+	{
+		vectorHandles.push_back( IFileInput::BindColumn( VectorNames[ columnIndex ] ) );
+	}
+	vector< vector< double > > allValues( ValueNames.size(), vector< double >( rowNumber ) );
+	vector< vector< double > > allVectorValues( VectorNames.size() );
+	vector< vector< unsigned long > > allVectorStarts( VectorNames.size(), vector< unsigned long >( rowNumber + 1, 0 ) );
+	Source->StartScan( 0 );
+	for ( unsigned long rowIndex = 0; rowIndex < rowNumber; rowIndex++ )
+	{
+		if ( !Source->Next() )
+		{
+			cerr << "Failed to read row " << rowIndex << " of " << SourcePath << " for the event cache" << endl;
+			exit(1);
+		}
+
+		allEventNumbers[ rowIndex ] = Source->EventNumber();
+		allWeights[ rowIndex ] = Source->EventWeight();
+		for ( unsigned int columnIndex = 0; columnIndex < valueHandles.size(); columnIndex++ )
+		{
+			allValues[ columnIndex ][ rowIndex ] = Source->GetValue( valueHandles[ columnIndex ] );
+		}
+		for ( unsigned int columnIndex = 0; columnIndex < vectorHandles.size(); columnIndex++ )
+		{
+			vector< double > * rowVector = Source->GetVector( vectorHandles[ columnIndex ] );
+			allVectorValues[ columnIndex ].insert( allVectorValues[ columnIndex ].end(), rowVector->begin(), rowVector->end() );
+			allVectorStarts[ columnIndex ][ rowIndex + 1 ] = allVectorValues[ columnIndex ].size();
+		}
+	}
+
+	//Write to a temporary file, then move it into place so a cache is never seen half-written
+	ofstream output;
+	string temporaryPath;
+	if ( !CacheFile::OpenTemporary( CachePath, "event cache", output, temporaryPath ) )
+	{
+		return;
+	}
+
+	//Header
+	output.write( CACHE_MAGIC, 8 );
+	WriteNumber( output, CACHE_VERSION );
+	WriteNumber( output, sourceSize );
+	WriteNumber( output, sourceModified );
+	WriteNumber( output, rowNumber );
+	WriteString( output, CacheKey );
+	WriteStrings( output, RelevanceChecker->AllNames() );
+	WriteStrings( output, ValueNames );
+	WriteStrings( output, VectorNames );
+
+	//Columns
+	output.write( ( const char* )allEventNumbers.data(), rowNumber * sizeof( UInt_t ) );
+	WritePadding( output, rowNumber * sizeof( UInt_t ) );
+	output.write( ( const char* )allWeights.data(), rowNumber * sizeof( double ) );
+	for ( unsigned int columnIndex = 0; columnIndex < allValues.size(); columnIndex++ )
+	{
+		output.write( ( const char* )allValues[ columnIndex ].data(), rowNumber * sizeof( double ) );
+	}
+	for ( unsigned int columnIndex = 0; columnIndex < allVectorValues.size(); columnIndex++ )
+	{
+		WriteNumber( output, allVectorValues[ columnIndex ].size() );
+		output.write( ( const char* )allVectorStarts[ columnIndex ].data(), ( rowNumber + 1 ) * sizeof( unsigned long ) );
+		output.write( ( const char* )allVectorValues[ columnIndex ].data(), allVectorValues[ columnIndex ].size() * sizeof( double ) );
+	}
+
+	CacheFile::MoveIntoPlace( output, temporaryPath, CachePath, "event cache" );
+}
+
+//Check the cache matches the input, and find the columns
+bool InputEventCache::ReadHeader( string CacheKey, string SourcePath, ObservableList * RelevanceChecker )
+{
+	//Check the format
+	if ( mappedSize < 8 || memcmp( mappedFile, CACHE_MAGIC, 8 ) != 0 )
+	{
+		return false;
+	}
+	readPosition = 8;
+	unsigned long version, sourceSize, sourceModified;
+	if ( !ReadNumber( mappedFile, mappedSize, readPosition, version ) || version != CACHE_VERSION )
+	{
+		return false;
+	}
+
+	//Check the source file hasn't changed
+	unsigned long currentSize, currentModified;
+	if ( !CacheFile::SourceStatus( SourcePath, currentSize, currentModified ) )
+	{
+		return false;
+	}
+	if ( !ReadNumber( mappedFile, mappedSize, readPosition, sourceSize ) || sourceSize != currentSize )
+	{
+		return false;
+	}
+	if ( !ReadNumber( mappedFile, mappedSize, readPosition, sourceModified ) || sourceModified != currentModified )
+	{
+		return false;
+	}
+	if ( !ReadNumber( mappedFile, mappedSize, readPosition, totalRows ) )
+	{
+		return false;
+	}
+
+	//Check it's the same input, with the same observables
+	string cacheKey;
+	vector< string > observableNames, valueNames, vectorNames;
+	if ( !ReadString( mappedFile, mappedSize, readPosition, cacheKey ) || cacheKey != CacheKey )
+	{
+		return false;
+	}
+	if ( !ReadStrings( mappedFile, mappedSize, readPosition, observableNames ) || observableNames != RelevanceChecker->AllNames() )
+	{
+		return false;
+	}
+	if ( !ReadStrings( mappedFile, mappedSize, readPosition, valueNames ) || !ReadStrings( mappedFile, mappedSize, readPosition, vectorNames ) )
+	{
+		return false;
+	}
+
+	//Find the event numbers and weights
+	unsigned long eventNumberLength = totalRows * sizeof( UInt_t );
+	eventNumberLength += ( 8 - eventNumberLength % 8 ) % 8;
+	if ( readPosition + eventNumberLength + ( totalRows * sizeof( double ) ) > mappedSize )
+	{
+		return false;
+	}
+	eventNumbers = ( const UInt_t* )( mappedFile + readPosition );
+	readPosition += eventNumberLength;
+	eventWeights = ( const double* )( mappedFile + readPosition );
+	readPosition += totalRows * sizeof( double );
+
+	//Find the value columns
+	for ( unsigned int columnIndex = 0; columnIndex < valueNames.size(); columnIndex++ )
+	{
+		if ( readPosition + ( totalRows * sizeof( double ) ) > mappedSize )
+		{
+			return false;
+		}
+		columnNameToIndex[ valueNames[ columnIndex ] ] = columnIndex;
+		columnValues.push_back( ( const double* )( mappedFile + readPosition ) );
+		readPosition += totalRows * sizeof( double );
+	}
+
+	//Find the vector columns
+	for ( unsigned int columnIndex = 0; columnIndex < vectorNames.size(); columnIndex++ )
+	{
+		unsigned long valueNumber;
+		if ( !ReadNumber( mappedFile, mappedSize, readPosition, valueNumber ) ||
+				readPosition + ( ( totalRows + 1 ) * sizeof( unsigned long ) ) + ( valueNumber * sizeof( double ) ) > mappedSize )
+		{
+			return false;
+		}
+		vectorNameToIndex[ vectorNames[ columnIndex ] ] = columnIndex;
+		vectorStarts.push_back( ( const unsigned long* )( mappedFile + readPosition ) );
+		readPosition += ( totalRows + 1 ) * sizeof( unsigned long );
+		vectorValues.push_back( ( const double* )( mappedFile + readPosition ) );
+		readPosition += valueNumber * sizeof( double );
+	}
+	currentVectors = vector< vector< double > >( vectorNames.size() );
+	vectorGenerations = vector< unsigned long >( vectorNames.size(), 0 );
+
+	return true;
+}
+
+//Check whether the cache file matched the input file
+bool InputEventCache::IsValid()
+{
+	return isValid;
+}
+
+//Stupidity check
+void InputEventCache::CheckFile( unsigned int FileIndex )
+{
+	if ( FileIndex != 0 )
+	{
+		cerr << "Requesting file " << FileIndex << " in InputEventCache which only reads file 0" << endl;
+		exit(1);
+	}
+}
+
+//Change the row being examined
+bool InputEventCache::ReadRow( unsigned long RowIndex, unsigned int FileIndex )
+{
+	CheckFile( FileIndex );
+
+	//Check if the row index is in range
+	if ( RowIndex >= totalRows )
+	{
+		return false;
+	}
+
+	//Just move to the row - the values are all in memory
+	if ( RowIndex != currentRowNumber )
+	{
+		currentRowNumber = RowIndex;
+		currentGeneration++;
+	}
+
+	return true;
+}
+
+bool InputEventCache::ReadEvent( UInt_t EventNumber, unsigned int FileIndex )
+{
+	CheckFile( FileIndex );
+
+	//Index the event numbers the first time they are needed
+	if ( !eventIndex.IsReady() )
+	{
+		if ( sequentialOnly )
+		{
+			cerr << "Searching for an event in an InputEventCache declared sequential only" << endl;
+			exit(1);
+		}
+
+		eventIndex.Build( eventNumbers, totalRows );
+	}
+
+	//Look for an event with this number
+	//The event numbers from an ntuple were stored as floats, so match them the same way as InputNtuple
+	if ( floatEventNumbers )
+	{
+		EventNumber = ( UInt_t )( float )EventNumber;
+	}
+	unsigned long rowIndex;
+	if ( eventIndex.FindRow( EventNumber, rowIndex ) )
+	{
+		return ReadRow( rowIndex, 0 );
+	}
+	else
+	{
+		return false;
+	}
+}
+
+//Get the standard event number and weight information
+UInt_t InputEventCache::EventNumber()
+{
+	return eventNumbers[ currentRowNumber ];
+}
+double InputEventCache::EventWeight()
+{
+	return eventWeights[ currentRowNumber ];
+}
+
+//Get any other column value by name
+double InputEventCache::GetValue( string VariableName )
+{
+	map< string, unsigned int >::iterator columnIterator = columnNameToIndex.find( VariableName );
+	if ( columnIterator == columnNameToIndex.end() )
+	{
+		//Not found
+		cerr << "Column named \"" << VariableName << "\" not found in event cache" << endl;
+		exit(1);
+	}
+	else
+	{
+		return columnValues[ columnIterator->second ][ currentRowNumber ];
+	}
+}
+vector< double > * InputEventCache::GetVector( string VectorName )
+{
+	map< string, unsigned int >::iterator vectorIterator = vectorNameToIndex.find( VectorName );
+	if ( vectorIterator == vectorNameToIndex.end() )
+	{
+		//Not found
+		cerr << "Vector named \"" << VectorName << "\" not found in event cache" << endl;
+		exit(1);
+	}
+	else
+	{
+		return GetVector( IFileInput::BindColumn( VectorName ) );
+	}
+}
+
+//Get any other column value by handle
+double InputEventCache::GetValue( unsigned int ColumnHandle )
+{
+	//Find the column the first time the handle is used
+	if ( ColumnHandle >= handleToColumn.size() )
+	{
+		handleToColumn.resize( ColumnHandle + 1, -1 );
+	}
+	if ( handleToColumn[ ColumnHandle ] < 0 )
+	{
+		string columnName = IFileInput::ColumnName( ColumnHandle );
+		map< string, unsigned int >::iterator columnIterator = columnNameToIndex.find( columnName );
+		if ( columnIterator == columnNameToIndex.end() )
+		{
+			//Not found
+			cerr << "Column named \"" << columnName << "\" not found in event cache" << endl;
+			exit(1);
+		}
+		handleToColumn[ ColumnHandle ] = columnIterator->second;
+	}
+
+	return columnValues[ handleToColumn[ ColumnHandle ] ][ currentRowNumber ];
+}
+vector< double > * InputEventCache::GetVector( unsigned int VectorHandle )
+{
+	//Find the vector the first time the handle is used
+	if ( VectorHandle >= handleToVector.size() )
+	{
+		handleToVector.resize( VectorHandle + 1, -1 );
+	}
+	if ( handleToVector[ VectorHandle ] < 0 )
+	{
+		string vectorName = IFileInput::ColumnName( VectorHandle );
+		map< string, unsigned int >::iterator vectorIterator = vectorNameToIndex.find( vectorName );
+		if ( vectorIterator == vectorNameToIndex.end() )
+		{
+			//Not found
+			cerr << "Vector named \"" << vectorName << "\" not found in event cache" << endl;
+			exit(1);
+		}
+		handleToVector[ VectorHandle ] = vectorIterator->second;
+	}
+
+	//Copy the values for this row, if it hasn't been done already
+	unsigned int vectorIndex = handleToVector[ VectorHandle ];
+	if ( vectorGenerations[ vectorIndex ] != currentGeneration )
+	{
+		const double * vectorStart = vectorValues[ vectorIndex ];
+		currentVectors[ vectorIndex ].assign( vectorStart + vectorStarts[ vectorIndex ][ currentRowNumber ], vectorStart + vectorStarts[ vectorIndex ][ currentRowNumber + 1 ] );
+		vectorGenerations[ vectorIndex ] = currentGeneration;
+	}
+
+	return &( currentVectors[ vectorIndex ] );
+}
+
+//Get the event number of every row, without loading the rows
+void InputEventCache::GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers )
+{
+	CheckFile( FileIndex );
+	EventNumbers.assign( eventNumbers, eventNumbers + totalRows );
+}
+
+//The whole file is already in memory
+void InputEventCache::PreloadColumns( unsigned int FileIndex )
+{
+	CheckFile( FileIndex );
+}
+
+//Declare that only ReadRow will be used
+void InputEventCache::SetSequentialOnly( bool SequentialOnly )
+{
+	sequentialOnly = SequentialOnly;
+}
+
+//Step through the rows of a file in order
+void InputEventCache::StartScan( unsigned int FileIndex )
+{
+	CheckFile( FileIndex );
+	nextScanRow = 0;
+}
+bool InputEventCache::HasNext()
+{
+	return ( nextScanRow < totalRows );
+}
+bool InputEventCache::Next()
+{
+	if ( nextScanRow >= totalRows )
+	{
+		return false;
+	}
+
+	//Just move to the row - the values are all in memory
+	if ( nextScanRow != currentRowNumber )
+	{
+		currentRowNumber = nextScanRow;
+		currentGeneration++;
+	}
+	nextScanRow++;
+
+	return true;
+}
+
+//Get the number of rows
+unsigned long InputEventCache::NumberOfRows()
+{
+	return totalRows;
+}
+unsigned long InputEventCache::CurrentRow()
+{
+	return currentRowNumber;
+}
+unsigned int InputEventCache::NumberOfFiles()
+{
+	return 1;
+}
+unsigned int InputEventCache::CurrentFile()
+{
+	return 0;
+}
+
+//Get the description of the source
+string * InputEventCache::Description()
+{
+	return &sourceDescription;
+}
+
+//Get the index of the source
+unsigned int InputEventCache::DescriptionIndex()
+{
+	return sourceDescriptionIndex;
+}
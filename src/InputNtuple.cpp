@@ -26,6 +26,8 @@ InputNtuple::InputNtuple( string FilePath, string NtuplePath, string Description
 {
 	sourceDescription = Description;
 	sourceDescriptionIndex = DescriptionIndex;
+	sourcePath = FilePath;
+	indexKey = "InputNtuple " + NtuplePath;
 
 	//Get the Ntuple from the file
 	inputFile = new TFile( FilePath.c_str(), "READ" );
@@ -92,21 +94,17 @@ InputNtuple::InputNtuple( string FilePath, string NtuplePath, string Description
 		wrappedNtuple->SetBranchAddress( leafName.c_str(), &( currentValues[ columnIndex ] ), &( branches[ columnIndex ] ) );
 	}
 
-	//Loop over all rows to map event number to row index
-	for ( unsigned long rowIndex = 0; rowIndex < numberOfRows; rowIndex++ )
-	{
-		//Load the row
-		currentRowNumber = rowIndex;
-		//wrappedNtuple->GetEvent( rowIndex );
-		eventNumberBranch->GetEvent( rowIndex );
-
-		//Map the event number
-		eventNumberToRow[ currentEventNumber ] = rowIndex;
-	}
+	//The event number index is made when it's first needed
+	eventNumbersRead = false;
+	sequentialOnly = false;
+	nextScanRow = 0;
 
 	//Load a valid row
 	currentRowNumber = 0;
 	wrappedNtuple->GetEvent( 0 );
+	currentGeneration = 0;
+	branchGenerations = vector< unsigned long >( branches.size(), currentGeneration );
+	isPreloaded = false;
 }
 
 //Destructor
@@ -142,18 +140,7 @@ bool InputNtuple::ReadRow( unsigned long RowIndex, unsigned int FileIndex )
 		else
 		{
 			//Load the corresponding row from the file
-			currentRowNumber = RowIndex;
-
-			//Slow
-			//wrappedNtuple->GetEvent( RowIndex );
-
-			//Fast
-			eventNumberBranch->GetEvent( RowIndex );
-			eventWeightBranch->GetEvent( RowIndex );
-			for ( unsigned int branchIndex = 0; branchIndex < branches.size(); branchIndex++ )
-			{
-				branches[ branchIndex ]->GetEvent( RowIndex );
-			}
+			LoadRow( RowIndex );
 
 			return true;
 		}
@@ -177,31 +164,104 @@ bool InputNtuple::ReadEvent( UInt_t EventNumber, unsigned int FileIndex )
 	else
 	{
 		//Look for an event with this number
-		eventIterator = eventNumberToRow.find( ( float )EventNumber );
-
-		//Check if the event exists
-		if ( eventIterator == eventNumberToRow.end() )
+		//The event numbers are stored as floats, so match them the same way
+		MakeEventIndex();
+		unsigned long rowIndex;
+		if ( eventIndex.FindRow( ( UInt_t )( float )EventNumber, rowIndex ) )
 		{
-			return false;
+			//Load the corresponding row from the file
+			LoadRow( rowIndex );
+
+			return true;
 		}
 		else
 		{
-			//Load the corresponding row from the file
-			currentRowNumber = eventIterator->second;
+			return false;
+		}
+	}
+}
 
-			//Slow
-			//wrappedNtuple->GetEvent( eventIterator->second );
+//Read the event number of every row
+void InputNtuple::ReadEventNumbers()
+{
+	if ( eventNumbersRead )
+	{
+		return;
+	}
 
-			//Fast
-			eventNumberBranch->GetEvent( currentRowNumber );
-			eventWeightBranch->GetEvent( currentRowNumber );
-			for ( unsigned int branchIndex = 0; branchIndex < branches.size(); branchIndex++ )
-			{
-				branches[ branchIndex ]->GetEvent( currentRowNumber );
-			}
+	//Loop over all rows, reading only the event number
+	rowEventNumbers.reserve( numberOfRows );
+	for ( unsigned long rowIndex = 0; rowIndex < numberOfRows; rowIndex++ )
+	{
+		eventNumberBranch->GetEvent( rowIndex );
+		rowEventNumbers.push_back( ( UInt_t )currentEventNumber );
+	}
+	eventNumbersRead = true;
 
-			return true;
+	//Put back the event number of the current row
+	if ( currentRowNumber < numberOfRows )
+	{
+		eventNumberBranch->GetEvent( currentRowNumber );
+	}
+}
+
+//Map event number to row index, the first time it's needed
+void InputNtuple::MakeEventIndex()
+{
+	//Check if it's been done already
+	if ( eventIndex.IsReady() )
+	{
+		return;
+	}
+	else if ( sequentialOnly )
+	{
+		cerr << "Searching for an event in an InputNtuple declared sequential only" << endl;
+		exit(1);
+	}
+
+	//Use the index file from an earlier run if there is one
+	if ( !eventIndex.ReadFile( sourcePath, indexKey ) )
+	{
+		ReadEventNumbers();
+		eventIndex.Build( rowEventNumbers.data(), numberOfRows );
+		eventIndex.WriteFile( sourcePath, indexKey );
+	}
+}
+
+//Read the event number and weight for a row
+//The other columns are only read when they are first asked for
+void InputNtuple::LoadRow( unsigned long RowIndex )
+{
+	currentRowNumber = RowIndex;
+	if ( isPreloaded )
+	{
+		currentEventNumber = ( float )rowEventNumbers[ RowIndex ];
+		currentEventWeight = preloadedWeights[ RowIndex ];
+	}
+	else
+	{
+		eventNumberBranch->GetEvent( RowIndex );
+		eventWeightBranch->GetEvent( RowIndex );
+	}
+
+	//Mark all the other columns as out of date
+	currentGeneration++;
+}
+
+//Read a column for the current row, if it hasn't been read already
+void InputNtuple::LoadColumn( unsigned int ColumnIndex )
+{
+	if ( branchGenerations[ ColumnIndex ] != currentGeneration )
+	{
+		if ( isPreloaded )
+		{
+			currentValues[ ColumnIndex ] = preloadedValues[ ColumnIndex ][ currentRowNumber ];
+		}
+		else
+		{
+			branches[ ColumnIndex ]->GetEvent( currentRowNumber );
 		}
+		branchGenerations[ ColumnIndex ] = currentGeneration;
 	}
 }
 
@@ -231,6 +291,7 @@ double InputNtuple::GetValue( string VariableName )
 	else
 	{
 		//Found - return corresponding value
+		LoadColumn( columnIterator->second );
 		return ( double )currentValues[ columnIterator->second ];
 	}
 }
@@ -240,6 +301,131 @@ vector< double > * InputNtuple::GetVector( string VectorName )
 	exit(1);
 }
 
+//Get any other column value by handle
+double InputNtuple::GetValue( unsigned int ColumnHandle )
+{
+	//Find the column the first time the handle is used
+	if ( ColumnHandle >= handleToColumn.size() )
+	{
+		handleToColumn.resize( ColumnHandle + 1, -1 );
+	}
+	if ( handleToColumn[ ColumnHandle ] < 0 )
+	{
+		string columnName = IFileInput::ColumnName( ColumnHandle );
+		columnIterator = columnNameToIndex.find( columnName );
+		if ( columnIterator == columnNameToIndex.end() )
+		{
+			//Not found
+			cerr << "Column named \"" << columnName << "\" not found in Ntuple" << endl;
+			exit(1);
+		}
+		handleToColumn[ ColumnHandle ] = columnIterator->second;
+	}
+
+	LoadColumn( handleToColumn[ ColumnHandle ] );
+	return ( double )currentValues[ handleToColumn[ ColumnHandle ] ];
+}
+vector< double > * InputNtuple::GetVector( unsigned int VectorHandle )
+{
+	return GetVector( IFileInput::ColumnName( VectorHandle ) );
+}
+
+//Get the event number of every row, without loading the rows
+void InputNtuple::GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Requesting file " << FileIndex << " in InputNtuple which only reads file 0" << endl;
+		exit(1);
+	}
+
+	ReadEventNumbers();
+	EventNumbers = rowEventNumbers;
+}
+
+//Read all relevant columns into memory at once, rather than one row at a time
+void InputNtuple::PreloadColumns( unsigned int FileIndex )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Requesting file " << FileIndex << " in InputNtuple which only reads file 0" << endl;
+		exit(1);
+	}
+
+	//Check if it's already been done
+	if ( isPreloaded )
+	{
+		return;
+	}
+
+	//Read each branch from start to end, so each basket is only decompressed once
+	ReadEventNumbers();
+	preloadedWeights = vector< float >( numberOfRows );
+	for ( unsigned long rowIndex = 0; rowIndex < numberOfRows; rowIndex++ )
+	{
+		eventWeightBranch->GetEvent( rowIndex );
+		preloadedWeights[ rowIndex ] = currentEventWeight;
+	}
+	preloadedValues = vector< vector< float > >( branches.size(), vector< float >( numberOfRows ) );
+	for ( unsigned int branchIndex = 0; branchIndex < branches.size(); branchIndex++ )
+	{
+		vector< float > & branchValues = preloadedValues[ branchIndex ];
+		for ( unsigned long rowIndex = 0; rowIndex < numberOfRows; rowIndex++ )
+		{
+			branches[ branchIndex ]->GetEvent( rowIndex );
+			branchValues[ rowIndex ] = currentValues[ branchIndex ];
+		}
+	}
+	isPreloaded = true;
+
+	//Reload the current row from memory
+	if ( currentRowNumber < numberOfRows )
+	{
+		LoadRow( currentRowNumber );
+	}
+}
+
+//Declare that only ReadRow will be used
+void InputNtuple::SetSequentialOnly( bool SequentialOnly )
+{
+	sequentialOnly = SequentialOnly;
+}
+
+//Step through the rows of a file in order
+void InputNtuple::StartScan( unsigned int FileIndex )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Requesting file " << FileIndex << " in InputNtuple which only reads file 0" << endl;
+		exit(1);
+	}
+
+	nextScanRow = 0;
+}
+bool InputNtuple::HasNext()
+{
+	return ( nextScanRow < numberOfRows );
+}
+bool InputNtuple::Next()
+{
+	if ( nextScanRow >= numberOfRows )
+	{
+		return false;
+	}
+
+	//Load the row, unless it's already there
+	if ( nextScanRow != currentRowNumber )
+	{
+		LoadRow( nextScanRow );
+	}
+	nextScanRow++;
+
+	return true;
+}
+
 //Get the number of rows
 unsigned long InputNtuple::NumberOfRows()
 {
@@ -269,3 +455,16 @@ unsigned int InputNtuple::DescriptionIndex()
 {
 	return sourceDescriptionIndex;
 }
+
+//Get the names of the relevant columns found in the file
+void InputNtuple::RelevantColumnNames( vector< string > & ValueNames, vector< string > & VectorNames )
+{
+	ValueNames.clear();
+	for ( columnIterator = columnNameToIndex.begin(); columnIterator != columnNameToIndex.end(); columnIterator++ )
+	{
+		ValueNames.push_back( columnIterator->first );
+	}
+
+	//Ntuples can't contain vectors
+	VectorNames.clear();
+}
@@ -22,15 +22,18 @@ InputUETree::InputUETree()
 }
 
 //Constructor taking arguments pointing to a particular Ntuple in a root file
-InputUETree::InputUETree( string FilePath, string NtuplePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker,
-		string CutName, double CutMinimum, double CutMaximum )
+InputUETree::InputUETree( string FilePath, string NtuplePath, string Description, unsigned int DescriptionIndex, ObservableList * RelevanceChecker, InputCut Cut )
 {
 	sourceDescription = Description;
 	sourceDescriptionIndex = DescriptionIndex;
 	totalRows = 0;
 	currentRowNumber = 0;
 	currentEventNumber = 0;
-	bool calculateCut = !( CutMaximum == 0.0 && CutMinimum == 0.0 && CutName == "NoCut" );
+	hasCut = ( Cut.NumberOfRanges() > 0 );
+
+	//Describe the rows selected, so an index file is only used for the same selection
+	sourcePath = FilePath;
+	indexKey = "InputUETree " + NtuplePath + " " + Cut.Description();
 
 	//Get the Ntuple from the file
 	inputFile = new TFile( FilePath.c_str(), "READ" );
@@ -51,14 +54,35 @@ InputUETree::InputUETree( string FilePath, string NtuplePath, string Description
 	TLeaf * nextLeaf;
 	bool eventNumberFound = false;
 	bool eventWeightFound = false;
-	bool cutColumnFound = false;
 	vector< string > otherColumnNames, vectorNames;
-	unsigned int cutColumnIndex = 0;
+	vector< TLeaf* > cutLeaves;
+	vector< int > cutLeafIndices( Cut.NumberOfRanges(), -1 );
 	while ( ( nextLeaf = ( TLeaf* )branchIterator() ) )
 	{
 		string leafName = nextLeaf->GetName();
 		string leafType = nextLeaf->GetTypeName();
 
+		//Columns with cut variables can be any single number, and are read through the leaf
+		for ( unsigned int rangeIndex = 0; rangeIndex < Cut.NumberOfRanges(); rangeIndex++ )
+		{
+			if ( leafName == Cut.ColumnName( rangeIndex ) )
+			{
+				if ( !IsNumericLeaf( nextLeaf ) )
+				{
+					cerr << "Cannot cut on column \"" << leafName << "\" of type " << leafType << " - only single numeric values are supported" << endl;
+					exit(1);
+				}
+				if ( cutLeafIndices[ rangeIndex ] < 0 )
+				{
+					if ( cutLeaves.empty() || cutLeaves.back() != nextLeaf )
+					{
+						cutLeaves.push_back( nextLeaf );
+					}
+					cutLeafIndices[ rangeIndex ] = cutLeaves.size() - 1;
+				}
+			}
+		}
+
 		//Find the special columns for EventNumber and EventWeight
 		if ( leafType == "UInt_t" && leafName == EVENT_NUMBER_COLUMN_NAME )
 		{
@@ -74,13 +98,6 @@ InputUETree::InputUETree( string FilePath, string NtuplePath, string Description
 				wrappedNtuple->SetBranchAddress( EVENT_WEIGHT_COLUMN_NAME.c_str(), &currentEventWeight, &eventWeightBranch );
 				eventWeightFound = true;
 			}
-			else if ( calculateCut && leafName == CutName )
-			{
-				//The column with the cut variable
-				cutColumnFound = true;
-				cutColumnIndex = otherColumnNames.size();
-				otherColumnNames.push_back( leafName );
-			}
 			else if ( RelevanceChecker->IsInList( leafName ) )
 			{
 				//All other relevant columns
@@ -110,63 +127,65 @@ InputUETree::InputUETree( string FilePath, string NtuplePath, string Description
 		exit(1);
 	}
 
-	//Set up the column with the cut variable (if there is one)
-	//You mustn't edit the lengths of these two vectors once you start using SetBranchAddress with them
-	currentValues = vector< double >( otherColumnNames.size(), 0 );
-	valueBranches = vector< TBranch* >( otherColumnNames.size(), 0 );
-	if ( calculateCut )
+	//Check we found the cut columns
+	for ( unsigned int rangeIndex = 0; rangeIndex < Cut.NumberOfRanges(); rangeIndex++ )
 	{
-		if ( cutColumnFound )
+		if ( cutLeafIndices[ rangeIndex ] < 0 )
 		{
-			columnNameToIndex[ CutName ] = cutColumnIndex;
-			wrappedNtuple->SetBranchAddress( CutName.c_str(), &( currentValues[ cutColumnIndex ] ), &( valueBranches[ cutColumnIndex ] ) );
-		}
-		else
-		{
-			cerr << "Ntuple contains no column called \"" << CutName << "\"" << endl;
+			cerr << "Ntuple contains no column called \"" << Cut.ColumnName( rangeIndex ) << "\"" << endl;
 			exit(1);
 		}
 	}
 
-	//Loop over all rows to map event number to row index
-	for ( unsigned long rowIndex = 0; rowIndex < wrappedNtuple->GetEntries(); rowIndex++ )
+	//Loop over all rows to find the ones passing the cut (if there is one)
+	//Each cut column is only read until the event fails a range
+	//Without a cut every row is used, so nothing needs to be stored
+	//The event numbers are only read when they're needed
+	if ( hasCut )
 	{
-		//Load the row
-		//wrappedNtuple->GetEvent( rowIndex );
-		eventNumberBranch->GetEvent( rowIndex );
-
-		//Perform a cut if required
-		bool storeEvent = true;
-		if ( calculateCut )
+		vector< long > cutLeafRows( cutLeaves.size(), -1 );
+		for ( long rowIndex = 0; rowIndex < wrappedNtuple->GetEntries(); rowIndex++ )
 		{
-			valueBranches[ cutColumnIndex ]->GetEvent( rowIndex );
-			double cutValue = currentValues[ cutColumnIndex ];//GetValue( CutName );
-			storeEvent = ( cutValue >= CutMinimum && cutValue <= CutMaximum );
-		}
+			bool passesCut = true;
+			for ( unsigned int rangeIndex = 0; passesCut && rangeIndex < Cut.NumberOfRanges(); rangeIndex++ )
+			{
+				int leafIndex = cutLeafIndices[ rangeIndex ];
+				if ( cutLeafRows[ leafIndex ] != rowIndex )
+				{
+					cutLeaves[ leafIndex ]->GetBranch()->GetEntry( rowIndex );
+					cutLeafRows[ leafIndex ] = rowIndex;
+				}
+				passesCut = Cut.InRange( rangeIndex, cutLeaves[ leafIndex ]->GetValue() );
+			}
 
-		//Make maps to the event
-		if ( storeEvent )
-		{
-			currentRowNumber = totalRows;
-			eventNumberToExternalRow[ currentEventNumber ] = totalRows;
-			externalRowToInternalRow[ totalRows ] = rowIndex;
-			totalRows++;
+			if ( passesCut )
+			{
+				selectedRows.push_back( rowIndex );
+			}
 		}
+		totalRows = selectedRows.size();
+	}
+	else
+	{
+		totalRows = wrappedNtuple->GetEntries();
 	}
+	eventNumbersRead = false;
+	sequentialOnly = false;
+	nextScanRow = 0;
 
 	//Set up access to the other columns
+	//You mustn't edit the lengths of these two vectors once you start using SetBranchAddress with them
+	currentValues = vector< double >( otherColumnNames.size(), 0 );
+	valueBranches = vector< TBranch* >( otherColumnNames.size(), 0 );
 	for ( unsigned int columnIndex = 0; columnIndex < otherColumnNames.size(); columnIndex++ )
 	{
-		if ( !calculateCut || columnIndex != cutColumnIndex )
-		{
-			string leafName = otherColumnNames[columnIndex];
+		string leafName = otherColumnNames[columnIndex];
 
-			//Map the column name
-			columnNameToIndex[ leafName ] = columnIndex;
+		//Map the column name
+		columnNameToIndex[ leafName ] = columnIndex;
 
-			//Do the nasty root Ntuple access thing
-			wrappedNtuple->SetBranchAddress( leafName.c_str(), &( currentValues[ columnIndex ] ), &( valueBranches[ columnIndex ] ) );
-		}
+		//Do the nasty root Ntuple access thing
+		wrappedNtuple->SetBranchAddress( leafName.c_str(), &( currentValues[ columnIndex ] ), &( valueBranches[ columnIndex ] ) );
 	}
 	currentVectors = vector< vector< double >* >( vectorNames.size(), 0 );
 	vectorBranches = vector< TBranch* >( vectorNames.size(), 0 );
@@ -182,19 +201,24 @@ InputUETree::InputUETree( string FilePath, string NtuplePath, string Description
 	}
 
 	//Load a valid row
+	currentInternalRow = 0;
 	if ( totalRows > 0 )
 	{
-		wrappedNtuple->GetEvent( externalRowToInternalRow[ 0 ] );
+		currentInternalRow = InternalRow( 0 );
+		wrappedNtuple->GetEvent( currentInternalRow );
 		currentRowNumber = 0;
 	}
+	currentGeneration = 0;
+	valueGenerations = vector< unsigned long >( valueBranches.size(), currentGeneration );
+	vectorGenerations = vector< unsigned long >( vectorBranches.size(), currentGeneration );
+	isPreloaded = false;
 }
 
 //Destructor
 InputUETree::~InputUETree()
 {
 	//STL
-	eventNumberToExternalRow.clear();
-	externalRowToInternalRow.clear();
+	selectedRows.clear();
 	columnNameToIndex.clear();
 	valueBranches.clear();
 	currentValues.clear();
@@ -233,23 +257,7 @@ bool InputUETree::ReadRow( unsigned long RowIndex, unsigned int FileIndex )
 		else
 		{
 			//Load the corresponding row from the file
-			currentRowNumber = RowIndex;
-			unsigned long loadRow = externalRowToInternalRow[ currentRowNumber ];
-
-			//Slow
-			//wrappedNtuple->GetEvent( loadRow );
-
-			//Fast
-			eventNumberBranch->GetEvent( loadRow );
-			eventWeightBranch->GetEvent( loadRow );
-			for ( unsigned int branchIndex = 0; branchIndex < valueBranches.size(); branchIndex++ )
-			{
-				valueBranches[ branchIndex ]->GetEvent( loadRow );
-			}
-			for ( unsigned int branchIndex = 0; branchIndex < vectorBranches.size(); branchIndex++ )
-			{
-				vectorBranches[ branchIndex ]->GetEvent( loadRow );
-			}
+			LoadRow( RowIndex );
 
 			return true;
 		}
@@ -273,36 +281,134 @@ bool InputUETree::ReadEvent( UInt_t EventNumber, unsigned int FileIndex )
 	else
 	{
 		//Look for an event with this number
-		eventIterator = eventNumberToExternalRow.find( EventNumber );
-
-		//Check if the event exists
-		if ( eventIterator == eventNumberToExternalRow.end() )
+		MakeEventIndex();
+		unsigned long rowIndex;
+		if ( eventIndex.FindRow( EventNumber, rowIndex ) )
 		{
-			return false;
+			//Load the corresponding row from the file
+			LoadRow( rowIndex );
+
+			return true;
 		}
 		else
 		{
-			//Load the corresponding row from the file
-			currentRowNumber = eventIterator->second;
-			unsigned long loadRow = externalRowToInternalRow[ currentRowNumber ];
+			return false;
+		}
+	}
+}
+
+//Read the event number of every row
+void InputUETree::ReadEventNumbers()
+{
+	if ( eventNumbersRead )
+	{
+		return;
+	}
 
-			//Slow
-			//wrappedNtuple->GetEvent( loadRow );
+	//Loop over all rows, reading only the event number
+	rowEventNumbers.reserve( totalRows );
+	for ( unsigned long rowIndex = 0; rowIndex < totalRows; rowIndex++ )
+	{
+		eventNumberBranch->GetEvent( InternalRow( rowIndex ) );
+		rowEventNumbers.push_back( currentEventNumber );
+	}
+	eventNumbersRead = true;
 
-			//Fast
-			eventNumberBranch->GetEvent( loadRow );
-			eventWeightBranch->GetEvent( loadRow );
-			for ( unsigned int branchIndex = 0; branchIndex < valueBranches.size(); branchIndex++ )
-			{
-				valueBranches[ branchIndex ]->GetEvent( loadRow );
-			}
-			for ( unsigned int branchIndex = 0; branchIndex < vectorBranches.size(); branchIndex++ )
-			{
-				vectorBranches[ branchIndex ]->GetEvent( loadRow );
-			}
+	//Put back the event number of the current row
+	if ( currentRowNumber < totalRows )
+	{
+		eventNumberBranch->GetEvent( InternalRow( currentRowNumber ) );
+	}
+}
 
-			return true;
+//Map event number to row index, the first time it's needed
+void InputUETree::MakeEventIndex()
+{
+	//Check if it's been done already
+	if ( eventIndex.IsReady() || totalRows == 0 )
+	{
+		return;
+	}
+	else if ( sequentialOnly )
+	{
+		cerr << "Searching for an event in an InputUETree declared sequential only" << endl;
+		exit(1);
+	}
+
+	//Use the index file from an earlier run if there is one
+	if ( !eventIndex.ReadFile( sourcePath, indexKey ) )
+	{
+		ReadEventNumbers();
+		eventIndex.Build( rowEventNumbers.data(), totalRows );
+		eventIndex.WriteFile( sourcePath, indexKey );
+	}
+}
+
+//Find the row in the file, allowing for any cut
+unsigned long InputUETree::InternalRow( unsigned long ExternalRow )
+{
+	if ( hasCut )
+	{
+		return selectedRows[ ExternalRow ];
+	}
+	else
+	{
+		return ExternalRow;
+	}
+}
+
+//Read the event number and weight for a row
+//The other columns are only read when they are first asked for
+void InputUETree::LoadRow( unsigned long RowIndex )
+{
+	currentRowNumber = RowIndex;
+	if ( isPreloaded )
+	{
+		currentEventNumber = rowEventNumbers[ RowIndex ];
+		currentEventWeight = preloadedWeights[ RowIndex ];
+	}
+	else
+	{
+		currentInternalRow = InternalRow( RowIndex );
+		eventNumberBranch->GetEvent( currentInternalRow );
+		eventWeightBranch->GetEvent( currentInternalRow );
+	}
+
+	//Mark all the other columns as out of date
+	currentGeneration++;
+}
+
+//Read a column for the current row, if it hasn't been read already
+void InputUETree::LoadColumn( unsigned int ColumnIndex )
+{
+	if ( valueGenerations[ ColumnIndex ] != currentGeneration )
+	{
+		if ( isPreloaded )
+		{
+			currentValues[ ColumnIndex ] = preloadedValues[ ColumnIndex ][ currentRowNumber ];
+		}
+		else
+		{
+			valueBranches[ ColumnIndex ]->GetEvent( currentInternalRow );
+		}
+		valueGenerations[ ColumnIndex ] = currentGeneration;
+	}
+}
+void InputUETree::LoadVector( unsigned int VectorIndex )
+{
+	if ( vectorGenerations[ VectorIndex ] != currentGeneration )
+	{
+		if ( isPreloaded )
+		{
+			vector< double >::iterator vectorStart = preloadedVectorValues[ VectorIndex ].begin();
+			currentVectors[ VectorIndex ]->assign( vectorStart + preloadedVectorStarts[ VectorIndex ][ currentRowNumber ],
+					vectorStart + preloadedVectorStarts[ VectorIndex ][ currentRowNumber + 1 ] );
 		}
+		else
+		{
+			vectorBranches[ VectorIndex ]->GetEvent( currentInternalRow );
+		}
+		vectorGenerations[ VectorIndex ] = currentGeneration;
 	}
 }
 
@@ -332,6 +438,7 @@ double InputUETree::GetValue( string VariableName )
 	else
 	{
 		//Found - return corresponding value
+		LoadColumn( columnIterator->second );
 		double storedValue = currentValues[ columnIterator->second ];
 
 		if ( isnan( storedValue ) )
@@ -358,10 +465,181 @@ vector< double > * InputUETree::GetVector( string VectorName )
 	else
 	{
 		//Found - return pointer to vector
+		LoadVector( columnIterator->second );
 		return currentVectors[ columnIterator->second ];
 	}
 }
 
+//Get any other column value by handle
+double InputUETree::GetValue( unsigned int ColumnHandle )
+{
+	//Find the column the first time the handle is used
+	if ( ColumnHandle >= handleToColumn.size() )
+	{
+		handleToColumn.resize( ColumnHandle + 1, -1 );
+	}
+	if ( handleToColumn[ ColumnHandle ] < 0 )
+	{
+		string columnName = IFileInput::ColumnName( ColumnHandle );
+		columnIterator = columnNameToIndex.find( columnName );
+		if ( columnIterator == columnNameToIndex.end() )
+		{
+			//Not found
+			cerr << "Column named \"" << columnName << "\" not found in Ntuple" << endl;
+			exit(1);
+		}
+		handleToColumn[ ColumnHandle ] = columnIterator->second;
+	}
+
+	LoadColumn( handleToColumn[ ColumnHandle ] );
+	double storedValue = currentValues[ handleToColumn[ ColumnHandle ] ];
+	if ( isnan( storedValue ) )
+	{
+		storedValue = 0.0;
+	}
+
+	return storedValue;
+}
+vector< double > * InputUETree::GetVector( unsigned int VectorHandle )
+{
+	//Find the vector the first time the handle is used
+	if ( VectorHandle >= handleToVector.size() )
+	{
+		handleToVector.resize( VectorHandle + 1, -1 );
+	}
+	if ( handleToVector[ VectorHandle ] < 0 )
+	{
+		string vectorName = IFileInput::ColumnName( VectorHandle );
+		columnIterator = vectorNameToIndex.find( vectorName );
+		if ( columnIterator == vectorNameToIndex.end() )
+		{
+			//Not found
+			cerr << "Vector named \"" << vectorName << "\" not found in Ntuple" << endl;
+			exit(1);
+		}
+		handleToVector[ VectorHandle ] = columnIterator->second;
+	}
+
+	LoadVector( handleToVector[ VectorHandle ] );
+	return currentVectors[ handleToVector[ VectorHandle ] ];
+}
+
+//Get the event number of every row, without loading the rows
+void InputUETree::GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Asking for file " << FileIndex << " in InputUETree which only holds file 0" << endl;
+		exit(1);
+	}
+
+	ReadEventNumbers();
+	EventNumbers = rowEventNumbers;
+}
+
+//Read all relevant columns into memory at once, rather than one row at a time
+void InputUETree::PreloadColumns( unsigned int FileIndex )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Asking for file " << FileIndex << " in InputUETree which only holds file 0" << endl;
+		exit(1);
+	}
+
+	//Check if it's already been done
+	if ( isPreloaded || totalRows == 0 )
+	{
+		return;
+	}
+
+	//Find the rows passing any cut, in order
+	vector< unsigned long > internalRows( totalRows );
+	for ( unsigned long rowIndex = 0; rowIndex < totalRows; rowIndex++ )
+	{
+		internalRows[ rowIndex ] = InternalRow( rowIndex );
+	}
+
+	//Read each branch from start to end, so each basket is only decompressed once
+	ReadEventNumbers();
+	preloadedWeights = vector< double >( totalRows );
+	for ( unsigned long rowIndex = 0; rowIndex < totalRows; rowIndex++ )
+	{
+		eventWeightBranch->GetEvent( internalRows[ rowIndex ] );
+		preloadedWeights[ rowIndex ] = currentEventWeight;
+	}
+	preloadedValues = vector< vector< double > >( valueBranches.size(), vector< double >( totalRows ) );
+	for ( unsigned int branchIndex = 0; branchIndex < valueBranches.size(); branchIndex++ )
+	{
+		vector< double > & branchValues = preloadedValues[ branchIndex ];
+		for ( unsigned long rowIndex = 0; rowIndex < totalRows; rowIndex++ )
+		{
+			valueBranches[ branchIndex ]->GetEvent( internalRows[ rowIndex ] );
+			branchValues[ rowIndex ] = currentValues[ branchIndex ];
+		}
+	}
+
+	//Vectors are stored end to end, with the start of each row's entries
+	preloadedVectorValues = vector< vector< double > >( vectorBranches.size() );
+	preloadedVectorStarts = vector< vector< unsigned long > >( vectorBranches.size(), vector< unsigned long >( totalRows + 1, 0 ) );
+	for ( unsigned int branchIndex = 0; branchIndex < vectorBranches.size(); branchIndex++ )
+	{
+		vector< double > & branchValues = preloadedVectorValues[ branchIndex ];
+		vector< unsigned long > & branchStarts = preloadedVectorStarts[ branchIndex ];
+		for ( unsigned long rowIndex = 0; rowIndex < totalRows; rowIndex++ )
+		{
+			vectorBranches[ branchIndex ]->GetEvent( internalRows[ rowIndex ] );
+			vector< double > * rowVector = currentVectors[ branchIndex ];
+			branchValues.insert( branchValues.end(), rowVector->begin(), rowVector->end() );
+			branchStarts[ rowIndex + 1 ] = branchValues.size();
+		}
+	}
+	isPreloaded = true;
+
+	//Reload the current row from memory
+	LoadRow( currentRowNumber );
+}
+
+//Declare that only ReadRow will be used
+void InputUETree::SetSequentialOnly( bool SequentialOnly )
+{
+	sequentialOnly = SequentialOnly;
+}
+
+//Step through the rows of a file in order
+void InputUETree::StartScan( unsigned int FileIndex )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Asking for file " << FileIndex << " in InputUETree which only holds file 0" << endl;
+		exit(1);
+	}
+
+	nextScanRow = 0;
+}
+bool InputUETree::HasNext()
+{
+	return ( nextScanRow < totalRows );
+}
+bool InputUETree::Next()
+{
+	if ( nextScanRow >= totalRows )
+	{
+		return false;
+	}
+
+	//Load the row, unless it's already there
+	if ( nextScanRow != currentRowNumber )
+	{
+		LoadRow( nextScanRow );
+	}
+	nextScanRow++;
+
+	return true;
+}
+
 //Get the number of rows and files
 unsigned long InputUETree::NumberOfRows()
 {
@@ -391,3 +669,28 @@ unsigned int InputUETree::DescriptionIndex()
 {
 	return sourceDescriptionIndex;
 }
+
+//Get the names of the relevant columns found in the file
+void InputUETree::RelevantColumnNames( vector< string > & ValueNames, vector< string > & VectorNames )
+{
+	ValueNames.clear();
+	for ( columnIterator = columnNameToIndex.begin(); columnIterator != columnNameToIndex.end(); columnIterator++ )
+	{
+		ValueNames.push_back( columnIterator->first );
+	}
+	VectorNames.clear();
+	for ( columnIterator = vectorNameToIndex.begin(); columnIterator != vectorNameToIndex.end(); columnIterator++ )
+	{
+		VectorNames.push_back( columnIterator->first );
+	}
+}
+
+//Whether a column holds a single number of a type the cut can read through TLeaf::GetValue
+bool InputUETree::IsNumericLeaf( TLeaf * Leaf )
+{
+	string leafType = Leaf->GetTypeName();
+	bool numericType = ( leafType == "Double_t" || leafType == "Float_t" || leafType == "Int_t" || leafType == "UInt_t"
+			|| leafType == "Long64_t" || leafType == "ULong64_t" || leafType == "Short_t" || leafType == "UShort_t"
+			|| leafType == "Char_t" || leafType == "UChar_t" || leafType == "Bool_t" );
+	return numericType && Leaf->GetLen() == 1;
+}
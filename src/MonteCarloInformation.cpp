@@ -11,8 +11,7 @@
 
 #include "MonteCarloInformation.h"
 #include "CombinedFileInput.h"
-#include "InputNtuple.h"
-#include "InputUETree.h"
+#include "InputEventCache.h"
 #include "TriggerChoosingInput.h"
 #include <cstdlib>
 #include <iostream>
@@ -194,6 +193,10 @@ MonteCarloInformation::MonteCarloInformation()
 	inputTypes.push_back( "TriggerChoosingInput" );
 	internalTruth.push_back( "benTuple" );
 	internalReco.push_back( "benTuple" );*/
+
+	//No selection on any of the inputs unless one is set
+	truthCuts = vector< InputCut >( descriptions.size() );
+	recoCuts = vector< InputCut >( descriptions.size() );
 }
 
 MonteCarloInformation::~MonteCarloInformation()
@@ -244,6 +247,33 @@ Style_t MonteCarloInformation::LineStyle( unsigned int Index )
 	}
 }
 
+//Select the events to read from the truth or reconstructed files of this MC sample, when they are opened
+//Only works for InputUETree files - bear in mind that cutting truth and reco differently changes which events are matched
+void MonteCarloInformation::SetTruthCut( unsigned int Index, InputCut Cut )
+{
+	if ( Index >= truthCuts.size() )
+	{
+		cerr << "Index out of range" << endl;
+		exit(1);
+	}
+	else
+	{
+		truthCuts[ Index ] = Cut;
+	}
+}
+void MonteCarloInformation::SetReconstructedCut( unsigned int Index, InputCut Cut )
+{
+	if ( Index >= recoCuts.size() )
+	{
+		cerr << "Index out of range" << endl;
+		exit(1);
+	}
+	else
+	{
+		recoCuts[ Index ] = Cut;
+	}
+}
+
 //For a given regular index, find out the corresponding index in the "extra" vectors
 int MonteCarloInformation::FindExtraIndex( unsigned int RegularIndex )
 {
@@ -292,12 +322,12 @@ IFileInput * MonteCarloInformation::MakeTruthInput( unsigned int Index, Observab
 				exit(1);
 			}
 
-			return new CombinedFileInput( allTruthPaths, inputWeights[ extraIndex ], internalTruth[ Index ], inputTypes[ Index ], descriptions[ Index ], Index, RelevanceChecker );
+			return new CombinedFileInput( allTruthPaths, inputWeights[ extraIndex ], internalTruth[ Index ], inputTypes[ Index ], descriptions[ Index ], Index, RelevanceChecker, truthCuts[ Index ] );
 		}
 		else
 		{
 			//Just a single file input
-			return InstantiateSingleInput( truthPaths[ Index ], internalTruth[ Index ], Index, RelevanceChecker );
+			return InstantiateSingleInput( truthPaths[ Index ], internalTruth[ Index ], Index, RelevanceChecker, truthCuts[ Index ] );
 		}
 	}
 }
@@ -326,25 +356,73 @@ IFileInput * MonteCarloInformation::MakeReconstructedInput( unsigned int Index,
 				exit(1);
 			}
 
-			return new CombinedFileInput( allRecoPaths, inputWeights[ extraIndex ], internalReco[ Index ], inputTypes[ Index ], descriptions[ Index ], Index, RelevanceChecker );
+			return new CombinedFileInput( allRecoPaths, inputWeights[ extraIndex ], internalReco[ Index ], inputTypes[ Index ], descriptions[ Index ], Index, RelevanceChecker, recoCuts[ Index ] );
 		}
 		else
 		{
 			//Just a single file input
-			return InstantiateSingleInput( recoPaths[ Index ], internalReco[ Index ], Index, RelevanceChecker );
+			return InstantiateSingleInput( recoPaths[ Index ], internalReco[ Index ], Index, RelevanceChecker, recoCuts[ Index ] );
 		}
 	}
 }
 
-IFileInput * MonteCarloInformation::InstantiateSingleInput( string FilePath, string InternalPath, unsigned int Index, ObservableList * RelevanceChecker )
+//Return the number of files for this MC sample, without opening any
+unsigned int MonteCarloInformation::NumberOfTruthFiles( unsigned int Index )
 {
+	if ( Index >= styles.size() )
+	{
+		cerr << "Index out of range" << endl;
+		exit(1);
+	}
+	else
+	{
+		int extraIndex = FindExtraIndex( Index );
+		if ( extraIndex >= 0 )
+		{
+			return extraTruthPaths[ extraIndex ].size() + 1;
+		}
+		else
+		{
+			return 1;
+		}
+	}
+}
+unsigned int MonteCarloInformation::NumberOfReconstructedFiles( unsigned int Index )
+{
+	if ( Index >= styles.size() )
+	{
+		cerr << "Index out of range" << endl;
+		exit(1);
+	}
+	else
+	{
+		int extraIndex = FindExtraIndex( Index );
+		if ( extraIndex >= 0 )
+		{
+			return extraRecoPaths[ extraIndex ].size() + 1;
+		}
+		else
+		{
+			return 1;
+		}
+	}
+}
+
+IFileInput * MonteCarloInformation::InstantiateSingleInput( string FilePath, string InternalPath, unsigned int Index, ObservableList * RelevanceChecker, InputCut Cut )
+{
+	if ( Cut.NumberOfRanges() > 0 && inputTypes[ Index ] != UE_TREE_TYPE_STRING )
+	{
+		cerr << "Input cuts can only be applied to " << UE_TREE_TYPE_STRING << " files, not " << inputTypes[ Index ] << endl;
+		exit(1);
+	}
+
 	if ( inputTypes[ Index ] == NTUPLE_TYPE_STRING )
 	{
-		return new InputNtuple( FilePath, InternalPath, descriptions[ Index ], Index, RelevanceChecker );
+		return InputEventCache::OpenNtuple( FilePath, InternalPath, descriptions[ Index ], Index, RelevanceChecker );
 	}
 	else if ( inputTypes[ Index ] == UE_TREE_TYPE_STRING )
 	{
-		return new InputUETree( FilePath, InternalPath, descriptions[ Index ], Index, RelevanceChecker );
+		return InputEventCache::OpenUETree( FilePath, InternalPath, descriptions[ Index ], Index, RelevanceChecker, Cut );
 	}
 	else if ( inputTypes[ Index ] == TRIGGER_CHOOSING_TYPE_STRING )
 	{
@@ -19,6 +19,9 @@
 #include <cstdlib>
 #include <cmath>
 #include <algorithm>
+#include <sstream>
+#include <thread>
+#include <mutex>
 
 using namespace std;
 
@@ -28,6 +31,50 @@ const int BIN_BY_BIN_MODE = 1;
 const int BAYESIAN_MODE = 2;
 const double OUTSIDE_ONE_SIGMA = 0.159;
 
+//Shared by the threads running the MC cross-checks
+struct CrossCheckState
+{
+	vector< IPlotMaker* > * allPlots;
+	vector< Distribution* > priorDistributions;
+	vector< SmearingMatrix* > crossCheckSmearings;
+	bool withSmoothing;
+
+	//The (reco MC, prior MC) pairs to cross-check, and the next one to start
+	vector< pair< unsigned int, unsigned int > > tasks;
+	unsigned int nextTask;
+
+	//The results of each task, kept in order so they don't depend on the number of threads
+	vector< unsigned int > iterations;
+	vector< string > outputs;
+
+	mutex stateMutex;
+};
+
+//Run cross-checks until there are none left
+//They only read the plots and the (finalised) smearing matrices, so just taking the next task needs the lock
+void CrossCheckWorker( CrossCheckState * State )
+{
+	unique_lock< mutex > stateLock( State->stateMutex );
+	while ( State->nextTask < State->tasks.size() )
+	{
+		//Take the next task
+		unsigned int taskIndex = State->nextTask;
+		State->nextTask++;
+		unsigned int recoIndex = State->tasks[ taskIndex ].first;
+		unsigned int priorIndex = State->tasks[ taskIndex ].second;
+
+		//Run the cross-check without holding the lock
+		stateLock.unlock();
+		stringstream taskOutput;
+		unsigned int iterations = ( *State->allPlots )[ recoIndex ]->MonteCarloCrossCheck( State->priorDistributions[ priorIndex ],
+				State->crossCheckSmearings[ priorIndex ], State->withSmoothing, taskOutput );
+		stateLock.lock();
+
+		State->iterations[ taskIndex ] = iterations;
+		State->outputs[ taskIndex ] = taskOutput.str();
+	}
+}
+
 //Default constructor - useless
 MonteCarloSummaryPlotMaker::MonteCarloSummaryPlotMaker()
 {
@@ -46,24 +93,69 @@ MonteCarloSummaryPlotMaker::MonteCarloSummaryPlotMaker( IPlotMaker * TemplatePlo
 	variableNames = TemplatePlotMaker->VariableNames();
 	correctionType = TemplatePlotMaker->CorrectionMode();
 
-	//Make a separate plot for each MC source
-	bool usedTheTemplate = false;
-	for ( unsigned int mcIndex = 0; mcIndex < mcInfo->NumberOfSources(); mcIndex++ )
+	//Find out if the template is one of the MC sources
+	unsigned int sourceNumber = mcInfo->NumberOfSources();
+	int templateIndex = -1;
+	for ( unsigned int mcIndex = 0; mcIndex < sourceNumber; mcIndex++ )
 	{
-		string mcDescription = mcInfo->Description( mcIndex );
-
 		//Don't make a redundant copy of the template
-		if ( TemplatePlotMaker->PriorName() == mcDescription )
+		if ( TemplatePlotMaker->PriorName() == mcInfo->Description( mcIndex ) )
+		{
+			templateIndex = mcIndex;
+			break;
+		}
+	}
+
+	//If MC inputs are combined, every plot would fill an identical smearing matrix
+	//So make one plot that fills the matrix, and let the others share it if possible
+	sharedSmearingIndex = -1;
+	allPlots = vector< IPlotMaker* >( sourceNumber, NULL );
+	if ( combineMode && sourceNumber > 0 )
+	{
+		if ( templateIndex >= 0 )
 		{
-			allPlots.push_back( TemplatePlotMaker );
-			usedTheTemplate = true;
+			sharedSmearingIndex = templateIndex;
+			allPlots[ templateIndex ] = TemplatePlotMaker;
 		}
 		else
 		{
-			allPlots.push_back( TemplatePlotMaker->Clone( mcDescription ) );
+			sharedSmearingIndex = 0;
+			allPlots[ 0 ] = TemplatePlotMaker->Clone( mcInfo->Description( 0 ) );
 		}
 	}
-	if ( !usedTheTemplate )
+
+	//Make a separate plot for each MC source
+	for ( unsigned int mcIndex = 0; mcIndex < sourceNumber; mcIndex++ )
+	{
+		if ( allPlots[ mcIndex ] )
+		{
+			continue;
+		}
+
+		string mcDescription = mcInfo->Description( mcIndex );
+		if ( sharedSmearingIndex >= 0 )
+		{
+			allPlots[ mcIndex ] = allPlots[ sharedSmearingIndex ]->CloneShareSmearingMatrix( mcDescription );
+
+			//Fall back to separate smearing matrices if the correction can't share them
+			if ( !allPlots[ mcIndex ] )
+			{
+				sharedSmearingIndex = -1;
+			}
+		}
+		if ( !allPlots[ mcIndex ] )
+		{
+			if ( (int)mcIndex == templateIndex )
+			{
+				allPlots[ mcIndex ] = TemplatePlotMaker;
+			}
+			else
+			{
+				allPlots[ mcIndex ] = TemplatePlotMaker->Clone( mcDescription );
+			}
+		}
+	}
+	if ( templateIndex < 0 )
 	{
 		delete TemplatePlotMaker;
 	}
@@ -103,7 +195,16 @@ void MonteCarloSummaryPlotMaker::StoreMatch( IFileInput * TruthInput, IFileInput
 		int inputIndex = TruthInput->DescriptionIndex();
 
 		//Add the event to the smearing matrix if it's the correct MC input, or if MC inputs are combined
-		if ( combineMode )
+		if ( sharedSmearingIndex >= 0 )
+		{
+			//Only one plot fills the shared smearing matrix, the others just need the events for their priors
+			allPlots[ sharedSmearingIndex ]->StoreMatch( TruthInput, ReconstructedInput );
+			if ( inputIndex != sharedSmearingIndex )
+			{
+				allPlots[ inputIndex ]->StoreMatch( TruthInput, ReconstructedInput );
+			}
+		}
+		else if ( combineMode )
 		{
 			for ( unsigned int mcIndex = 0; mcIndex < allPlots.size(); mcIndex++ )
 			{
@@ -128,7 +229,16 @@ void MonteCarloSummaryPlotMaker::StoreMiss( IFileInput * TruthInput )
 		int inputIndex = TruthInput->DescriptionIndex();
 
 		//Add the event to the smearing matrix if it's the correct MC input, or if MC inputs are combined
-		if ( combineMode )
+		if ( sharedSmearingIndex >= 0 )
+		{
+			//Only one plot fills the shared smearing matrix, the others just need the events for their priors
+			allPlots[ sharedSmearingIndex ]->StoreMiss( TruthInput );
+			if ( inputIndex != sharedSmearingIndex )
+			{
+				allPlots[ inputIndex ]->StoreMiss( TruthInput );
+			}
+		}
+		else if ( combineMode )
 		{
 			for ( unsigned int mcIndex = 0; mcIndex < allPlots.size(); mcIndex++ )
 			{
@@ -153,7 +263,16 @@ void MonteCarloSummaryPlotMaker::StoreFake( IFileInput * ReconstructedInput )
 		int inputIndex = ReconstructedInput->DescriptionIndex();
 
 		//Add the event to the smearing matrix if it's the correct MC input, or if MC inputs are combined
-		if ( combineMode )
+		if ( sharedSmearingIndex >= 0 )
+		{
+			//Only one plot fills the shared smearing matrix, the others just need the events for their priors
+			allPlots[ sharedSmearingIndex ]->StoreFake( ReconstructedInput );
+			if ( inputIndex != sharedSmearingIndex )
+			{
+				allPlots[ inputIndex ]->StoreFake( ReconstructedInput );
+			}
+		}
+		else if ( combineMode )
 		{
 			for ( unsigned int mcIndex = 0; mcIndex < allPlots.size(); mcIndex++ )
 			{
@@ -188,6 +307,68 @@ void MonteCarloSummaryPlotMaker::StoreData( IFileInput * DataInput )
 	}
 }
 
+//Make an empty copy of this object, so MC events can be stored in parallel
+MonteCarloSummaryPlotMaker * MonteCarloSummaryPlotMaker::CloneForMerging()
+{
+	if ( finalised )
+	{
+		cerr << "Trying to copy finalised MonteCarloSummaryPlotMaker" << endl;
+		exit(1);
+	}
+
+	MonteCarloSummaryPlotMaker * clone = new MonteCarloSummaryPlotMaker();
+	clone->finalised = false;
+	clone->manualRange = false;
+	clone->manualLabels = false;
+	clone->logScale = false;
+	clone->combineMode = combineMode;
+	clone->mcInfo = mcInfo;
+	clone->dataDescription = "";
+	clone->variableNames = variableNames;
+	clone->correctionType = correctionType;
+	clone->sharedSmearingIndex = sharedSmearingIndex;
+
+	//Copy the plots with the same smearing matrix sharing as the originals
+	clone->allPlots = vector< IPlotMaker* >( allPlots.size(), NULL );
+	if ( sharedSmearingIndex >= 0 )
+	{
+		clone->allPlots[ sharedSmearingIndex ] = allPlots[ sharedSmearingIndex ]->Clone( allPlots[ sharedSmearingIndex ]->PriorName() );
+	}
+	for ( unsigned int mcIndex = 0; mcIndex < allPlots.size(); mcIndex++ )
+	{
+		if ( sharedSmearingIndex < 0 )
+		{
+			clone->allPlots[ mcIndex ] = allPlots[ mcIndex ]->Clone( allPlots[ mcIndex ]->PriorName() );
+		}
+		else if ( (int)mcIndex != sharedSmearingIndex )
+		{
+			clone->allPlots[ mcIndex ] = clone->allPlots[ sharedSmearingIndex ]->CloneShareSmearingMatrix( allPlots[ mcIndex ]->PriorName() );
+		}
+	}
+
+	return clone;
+}
+
+//Add the MC events stored in a copy from CloneForMerging to this object
+void MonteCarloSummaryPlotMaker::MergeEvents( MonteCarloSummaryPlotMaker * Other )
+{
+	if ( finalised || Other->finalised )
+	{
+		cerr << "Trying to merge MC events with finalised MonteCarloSummaryPlotMaker" << endl;
+		exit(1);
+	}
+	else if ( Other->allPlots.size() != allPlots.size() || Other->sharedSmearingIndex != sharedSmearingIndex )
+	{
+		cerr << "Can only merge MC events from a MonteCarloSummaryPlotMaker made with CloneForMerging" << endl;
+		exit(1);
+	}
+
+	for ( unsigned int mcIndex = 0; mcIndex < allPlots.size(); mcIndex++ )
+	{
+		allPlots[ mcIndex ]->MergeEvents( Other->allPlots[ mcIndex ] );
+	}
+}
+
 //Some plot formatting
 void MonteCarloSummaryPlotMaker::SetYRange( double Minimum, double Maximum )
 {
@@ -232,7 +413,7 @@ void MonteCarloSummaryPlotMaker::UseLogScale()
 }
 
 //Do the calculation
-void MonteCarloSummaryPlotMaker::Process( int ErrorMode, bool WithSmoothing )
+void MonteCarloSummaryPlotMaker::Process( int ErrorMode, bool WithSmoothing, unsigned int ThreadNumber )
 {
 	if ( finalised )
 	{
@@ -248,21 +429,64 @@ void MonteCarloSummaryPlotMaker::Process( int ErrorMode, bool WithSmoothing )
 		cout << endl << "--------------- Started correcting " << plotDescription << " ----------------" << endl;
 		if ( correctionType == BAYESIAN_MODE )
 		{
-			//Loop over all possible combinations of MC truth as prior and MC reco as experiment
+			//Each combination of MC truth as prior and MC reco as experiment is a separate task
+			CrossCheckState crossCheckState;
+			crossCheckState.allPlots = &allPlots;
+			crossCheckState.withSmoothing = WithSmoothing;
+			crossCheckState.nextTask = 0;
 			for ( unsigned int mcIndex = 0; mcIndex < allPlots.size(); mcIndex++ )
 			{
 				//Get a distribution to use as a prior
-				Distribution * priorDistribution = allPlots[ mcIndex ]->PriorDistributionForCrossCheck();
-				SmearingMatrix * crossCheckSmearing = allPlots[ mcIndex ]->SmearingMatrixForCrossCheck();
+				crossCheckState.priorDistributions.push_back( allPlots[ mcIndex ]->PriorDistributionForCrossCheck() );
+				crossCheckState.crossCheckSmearings.push_back( allPlots[ mcIndex ]->SmearingMatrixForCrossCheck() );
+
+				//Finalise the smearing matrix now, so the tasks only read it
+				crossCheckState.crossCheckSmearings.back()->Finalise();
 
 				//Unfold each other distribution with that as a prior
 				for ( unsigned int checkOffset = 1; checkOffset < allPlots.size(); checkOffset++ )
 				{
 					int nextIndex = ( mcIndex + checkOffset ) % allPlots.size();
-					cout << endl << "Cross check - MC " << nextIndex << " reco with MC " << mcIndex << " prior" << endl;
-					mostIterations += allPlots[ nextIndex ]->MonteCarloCrossCheck( priorDistribution, crossCheckSmearing, WithSmoothing );
+					crossCheckState.tasks.push_back( make_pair( nextIndex, mcIndex ) );
 				}
 			}
+			crossCheckState.iterations = vector< unsigned int >( crossCheckState.tasks.size(), 0 );
+			crossCheckState.outputs = vector< string >( crossCheckState.tasks.size(), "" );
+
+			//Find out how many threads to use
+			unsigned int threadNumber = ThreadNumber;
+			if ( threadNumber == 0 )
+			{
+				threadNumber = thread::hardware_concurrency();
+			}
+			if ( threadNumber > crossCheckState.tasks.size() )
+			{
+				threadNumber = crossCheckState.tasks.size();
+			}
+			if ( threadNumber == 0 )
+			{
+				threadNumber = 1;
+			}
+
+			//Start the workers, and use this thread as well
+			vector< thread > workers;
+			for ( unsigned int threadIndex = 1; threadIndex < threadNumber; threadIndex++ )
+			{
+				workers.push_back( thread( CrossCheckWorker, &crossCheckState ) );
+			}
+			CrossCheckWorker( &crossCheckState );
+			for ( unsigned int threadIndex = 0; threadIndex < workers.size(); threadIndex++ )
+			{
+				workers[ threadIndex ].join();
+			}
+
+			//Print the results in the original order, and add up the iterations
+			for ( unsigned int taskIndex = 0; taskIndex < crossCheckState.tasks.size(); taskIndex++ )
+			{
+				cout << endl << "Cross check - MC " << crossCheckState.tasks[ taskIndex ].first << " reco with MC " << crossCheckState.tasks[ taskIndex ].second << " prior" << endl;
+				cout << crossCheckState.outputs[ taskIndex ];
+				mostIterations += crossCheckState.iterations[ taskIndex ];
+			}
 
 			//Find the average values for the convergence criteria
 			mostIterations = ceil( (double)mostIterations / (double)( allPlots.size() * ( allPlots.size() - 1 ) ) );
@@ -358,10 +582,27 @@ void MonteCarloSummaryPlotMaker::Process( int ErrorMode, bool WithSmoothing )
 		allTruthPlots = vector< TH1F* >( allPlots.size(), NULL );
 		bool firstPlot = true;
 		double meanDenominator = 0.0;
+
+		//Plots sharing a smearing matrix can all be unfolded together, if the error calculation is not needed
+		bool unfoldedTogether = false;
+		if ( sharedSmearingIndex >= 0 && ErrorMode == 0 )
+		{
+			vector< IPlotMaker* > otherPlots;
+			for ( unsigned int plotIndex = 0; plotIndex < allPlots.size(); plotIndex++ )
+			{
+				if ( (int)plotIndex != sharedSmearingIndex )
+				{
+					otherPlots.push_back( allPlots[ plotIndex ] );
+				}
+			}
+			allPlots[ sharedSmearingIndex ]->CorrectClones( otherPlots, mostIterations, WithSmoothing );
+			unfoldedTogether = true;
+		}
+
 		for ( unsigned int plotIndex = 0; plotIndex < allPlots.size(); plotIndex++ )
 		{
 			//Still need to run this to get the truth output
-			allPlots[ plotIndex ]->Correct( mostIterations, !usePrior[ plotIndex ], ErrorMode, WithSmoothing );
+			allPlots[ plotIndex ]->Correct( mostIterations, !usePrior[ plotIndex ] || unfoldedTogether, ErrorMode, WithSmoothing );
 
 			//Make a local copy of the truth plot
 			string truthPlotName = "mcTruth" + allPlots[ plotIndex ]->PriorName();
@@ -466,8 +707,15 @@ void MonteCarloSummaryPlotMaker::Process( int ErrorMode, bool WithSmoothing )
 				}
 			}
 
-			//Free some memory
-			delete allPlots[ plotIndex ];
+			//Free some memory - the other plots use the shared smearing matrix, so keep it until the end
+			if ( (int)plotIndex != sharedSmearingIndex )
+			{
+				delete allPlots[ plotIndex ];
+			}
+		}
+		if ( sharedSmearingIndex >= 0 )
+		{
+			delete allPlots[ sharedSmearingIndex ];
 		}
 
 		//Make a TGraph for the asymmetric errors
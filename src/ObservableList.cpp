@@ -24,3 +24,9 @@ bool ObservableList::IsInList( string TestName )
 {
 	return ( allNames.find( TestName ) != allNames.end() );
 }
+
+//Return all the names, in order
+vector< string > ObservableList::AllNames()
+{
+	return vector< string >( allNames.begin(), allNames.end() );
+}
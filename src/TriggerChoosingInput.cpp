@@ -9,7 +9,7 @@
  */
 
 #include "TriggerChoosingInput.h"
-#include "InputUETree.h"
+#include "InputEventCache.h"
 #include "TLeaf.h"
 #include <iostream>
 #include <cstdlib>
@@ -37,12 +37,14 @@ TriggerChoosingInput::TriggerChoosingInput( string FilePath, string NtuplePath,
 	sourceDescription = Description;
 	sourceDescriptionIndex = DescriptionIndex;
 	totalRows = 0;
+	scanFileNumber = 0;
+	nextScanRow = 0;
 
 	//Check we can actually do the find-and-replace on the input path name
 	if ( FilePath.find( REPLACE_FOR_TRIGGER_IN_PATH ) == string::npos )
 	{
 		//Can't find and replace - only one input file
-		IFileInput * inputFile = new InputUETree( FilePath, NtuplePath, Description, DescriptionIndex, RelevanceChecker );
+		IFileInput * inputFile = InputEventCache::OpenUETree( FilePath, NtuplePath, Description, DescriptionIndex, RelevanceChecker );
 		triggerInputs.push_back( inputFile );
 
 		//Book-keeping
@@ -72,8 +74,8 @@ TriggerChoosingInput::TriggerChoosingInput( string FilePath, string NtuplePath,
 				}
 
 				//Load the file for this trigger
-				IFileInput * inputTriggerFile = new InputUETree( inputTriggerFilePath, NtuplePath, Description, DescriptionIndex, RelevanceChecker,
-						LEAD_JET_PT_COLUMN_NAME, triggerLowerBounds[ triggerIndex ], upperBound );
+				InputCut triggerCut( LEAD_JET_PT_COLUMN_NAME, triggerLowerBounds[ triggerIndex ], upperBound );
+				IFileInput * inputTriggerFile = InputEventCache::OpenUETree( inputTriggerFilePath, NtuplePath, Description, DescriptionIndex, RelevanceChecker, triggerCut );
 				triggerInputs.push_back( inputTriggerFile );
 
 				//Book-keeping
@@ -195,6 +197,107 @@ vector< double > * TriggerChoosingInput::GetVector( string VectorName )
 	return triggerInputs[ currentFileNumber ]->GetVector( VectorName );
 }
 
+//Get any other column value by handle
+double TriggerChoosingInput::GetValue( unsigned int ColumnHandle )
+{
+	return triggerInputs[ currentFileNumber ]->GetValue( ColumnHandle );
+}
+vector< double > * TriggerChoosingInput::GetVector( unsigned int VectorHandle )
+{
+	return triggerInputs[ currentFileNumber ]->GetVector( VectorHandle );
+}
+
+//Get the event number of every row, without loading the rows
+void TriggerChoosingInput::GetEventNumbers( unsigned int FileIndex, vector< UInt_t > & EventNumbers )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Requesting file " << FileIndex << " in TriggerChoosingInput" << endl;
+		cerr << "It does technically contain multiple files, but you really shouldn't access them this way" << endl;
+		exit(1);
+	}
+
+	//Rows are numbered through each input in turn
+	EventNumbers.clear();
+	EventNumbers.reserve( totalRows );
+	for ( unsigned int triggerIndex = 0; triggerIndex < triggerInputs.size(); triggerIndex++ )
+	{
+		vector< UInt_t > triggerEventNumbers;
+		triggerInputs[ triggerIndex ]->GetEventNumbers( 0, triggerEventNumbers );
+		EventNumbers.insert( EventNumbers.end(), triggerEventNumbers.begin(), triggerEventNumbers.end() );
+	}
+}
+
+//Read all relevant columns into memory at once
+void TriggerChoosingInput::PreloadColumns( unsigned int FileIndex )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Requesting file " << FileIndex << " in TriggerChoosingInput" << endl;
+		cerr << "It does technically contain multiple files, but you really shouldn't access them this way" << endl;
+		exit(1);
+	}
+
+	for ( unsigned int triggerIndex = 0; triggerIndex < triggerInputs.size(); triggerIndex++ )
+	{
+		triggerInputs[ triggerIndex ]->PreloadColumns( 0 );
+	}
+}
+
+//Declare that only ReadRow will be used
+void TriggerChoosingInput::SetSequentialOnly( bool SequentialOnly )
+{
+	for ( unsigned int triggerIndex = 0; triggerIndex < triggerInputs.size(); triggerIndex++ )
+	{
+		triggerInputs[ triggerIndex ]->SetSequentialOnly( SequentialOnly );
+	}
+}
+
+//Step through the rows of each trigger file in turn
+void TriggerChoosingInput::StartScan( unsigned int FileIndex )
+{
+	//Stupidity check
+	if ( FileIndex != 0 )
+	{
+		cerr << "Requesting file " << FileIndex << " in TriggerChoosingInput" << endl;
+		cerr << "It does technically contain multiple files, but you really shouldn't access them this way" << endl;
+		exit(1);
+	}
+
+	for ( unsigned int triggerIndex = 0; triggerIndex < triggerInputs.size(); triggerIndex++ )
+	{
+		triggerInputs[ triggerIndex ]->StartScan( 0 );
+	}
+	scanFileNumber = 0;
+	nextScanRow = 0;
+}
+bool TriggerChoosingInput::HasNext()
+{
+	return ( nextScanRow < totalRows );
+}
+bool TriggerChoosingInput::Next()
+{
+	//Move on to the next trigger file when one runs out
+	while ( scanFileNumber < triggerInputs.size() )
+	{
+		if ( triggerInputs[ scanFileNumber ]->Next() )
+		{
+			currentFileNumber = scanFileNumber;
+			currentRowNumber = nextScanRow;
+			nextScanRow++;
+			return true;
+		}
+		else
+		{
+			scanFileNumber++;
+		}
+	}
+
+	return false;
+}
+
 //Get the number of rows
 unsigned long TriggerChoosingInput::NumberOfRows()
 {
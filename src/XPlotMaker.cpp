@@ -12,8 +12,6 @@
 #include "Folding.h"
 #include "NoCorrection.h"
 #include "BinByBinUnfolding.h"
-#include "UniformIndices.h"
-#include "CustomIndices.h"
 #include "TFile.h"
 #include <iostream>
 #include <cstdlib>
@@ -34,12 +32,11 @@ XPlotMaker::XPlotMaker( string XVariableName, string PriorName, unsigned int XBi
 {
 	correctionType = CorrectionMode;
 	xName = XVariableName;
+	xHandle = IFileInput::BindColumn( xName );
 	priorName = PriorName;
 	finalised = false;
 	scaleFactor = ScaleFactor;
 	normalise = Normalise;
-	vector< double > minima, maxima;
-	vector< unsigned int > binNumbers;
 	systematicRandom = 0;
 
 	//Set up a variable to keep track of the number of plots - used to prevent Root from complaining about making objects with the same names
@@ -48,12 +45,11 @@ XPlotMaker::XPlotMaker( string XVariableName, string PriorName, unsigned int XBi
 	thisPlotID = uniqueID;
 
 	//Store the x range
-	minima.push_back( XMinimum );
-	maxima.push_back( XMaximum );
-	binNumbers.push_back( XBinNumber );
+	array< UniformEdges, 1 > axes = {{ UniformEdges( XBinNumber, XMinimum, XMaximum ) }};
 
 	//Make the x unfolder
-	distributionIndices = new UniformIndices( binNumbers, minima, maxima );
+	distributionIndices = new FixedIndices< 1, UniformEdges >( axes );
+	FindFixedIndices();
 	XUnfolder = MakeCorrector( correctionType );
 }
 
@@ -62,11 +58,11 @@ XPlotMaker::XPlotMaker( string XVariableName, string PriorName, vector< double >
 {
 	correctionType = CorrectionMode;
 	xName = XVariableName;
+	xHandle = IFileInput::BindColumn( xName );
 	priorName = PriorName;
 	finalised = false;
 	scaleFactor = ScaleFactor;
 	normalise = Normalise;
-	vector< vector< double > > binEdges;
 	systematicRandom = 0;
 
 	//Set up a variable to keep track of the number of plots - used to prevent Root from complaining about making objects with the same names
@@ -75,19 +71,22 @@ XPlotMaker::XPlotMaker( string XVariableName, string PriorName, vector< double >
 	thisPlotID = uniqueID;
 
 	//Store the x range
-	binEdges.push_back( BinLowEdges );
+	array< CustomEdges, 1 > axes = {{ CustomEdges( BinLowEdges ) }};
 
 	//Make the x unfolder
-	distributionIndices = new CustomIndices( binEdges );
+	distributionIndices = new FixedIndices< 1, CustomEdges >( axes );
+	FindFixedIndices();
 	XUnfolder = MakeCorrector( correctionType );
 }
 
 //For use with Clone
 XPlotMaker::XPlotMaker( string XVariableName, string PriorName, IIndexCalculator * DistributionIndices,
-		unsigned int OriginalID, int CorrectionMode, double ScaleFactor, bool Normalise, vector< double > InputOffsets, vector< double > InputWidths )
+		unsigned int OriginalID, int CorrectionMode, double ScaleFactor, bool Normalise, vector< double > InputOffsets, vector< double > InputWidths,
+		ICorrection * SmearingMatrixSource )
 {
 	correctionType = CorrectionMode;
 	xName = XVariableName;
+	xHandle = IFileInput::BindColumn( xName );
 	priorName = PriorName;
 	finalised = false;
 	scaleFactor = ScaleFactor;
@@ -110,9 +109,17 @@ XPlotMaker::XPlotMaker( string XVariableName, string PriorName, IIndexCalculator
 	uniqueID++;
 	thisPlotID = uniqueID + OriginalID;
 
-	//Make the x unfolder
+	//Make the x unfolder, using the smearing matrix of another if given
 	distributionIndices = DistributionIndices;
-	XUnfolder = MakeCorrector( correctionType );
+	FindFixedIndices();
+	if ( SmearingMatrixSource )
+	{
+		XUnfolder = SmearingMatrixSource->ClonePriorShareSmearingMatrix( xName + priorName, thisPlotID );
+	}
+	else
+	{
+		XUnfolder = MakeCorrector( correctionType );
+	}
 
 	//Make the systematic unfolders too
 	for ( unsigned int experimentIndex = 0; experimentIndex < systematicWidths.size(); experimentIndex++ )
@@ -197,6 +204,18 @@ XPlotMaker * XPlotMaker::Clone( string NewPriorName )
 	return new XPlotMaker( xName, NewPriorName, distributionIndices->Clone(), thisPlotID, correctionType, scaleFactor, normalise, systematicOffsets, systematicWidths );
 }
 
+//Copy the object, using the smearing matrix of this one
+XPlotMaker * XPlotMaker::CloneShareSmearingMatrix( string NewPriorName )
+{
+	//Only the Bayesian unfolding can share its smearing matrix
+	if ( correctionType != BAYESIAN_MODE )
+	{
+		return 0;
+	}
+
+	return new XPlotMaker( xName, NewPriorName, distributionIndices->Clone(), thisPlotID, correctionType, scaleFactor, normalise, systematicOffsets, systematicWidths, XUnfolder );
+}
+
 //Take input values from ntuples
 //To reduce file access, the appropriate row must already be in memory, the method does not change row
 void XPlotMaker::StoreMatch( IFileInput * TruthInput, IFileInput * ReconstructedInput )
@@ -208,21 +227,17 @@ void XPlotMaker::StoreMatch( IFileInput * TruthInput, IFileInput * Reconstructed
 	}
 	else
 	{
-		vector< double > truthValues, reconstructedValues;
-
 		//Find out if this is the correct prior
 		bool useInPrior = ( priorName == *( TruthInput->Description() ) );
 
 		//Retrieve the values from the Ntuple
-		double xTruthValue = TruthInput->GetValue( xName );
-		double xReconstructedValue = ReconstructedInput->GetValue( xName );
+		double xTruthValue = TruthInput->GetValue( xHandle );
+		double xReconstructedValue = ReconstructedInput->GetValue( xHandle );
 		double truthWeight = TruthInput->EventWeight();
 		double reconstructedWeight = ReconstructedInput->EventWeight();
 
 		//Store the x values
-		truthValues.push_back( xTruthValue );
-		reconstructedValues.push_back( xReconstructedValue );
-		XUnfolder->StoreTruthRecoPair( truthValues, reconstructedValues, truthWeight, reconstructedWeight, useInPrior );
+		XUnfolder->StoreTruthRecoPairBins( BinIndex( &xTruthValue ), BinIndex( &xReconstructedValue ), truthWeight, reconstructedWeight, useInPrior );
 	}
 }
 void XPlotMaker::StoreMiss( IFileInput * TruthInput )
@@ -234,18 +249,15 @@ void XPlotMaker::StoreMiss( IFileInput * TruthInput )
 	}
 	else
 	{
-		vector< double > truthValues;
-
 		//Find out if this is the correct prior
 		bool useInPrior = ( priorName == *( TruthInput->Description() ) );
 
 		//Retrieve the values from the Ntuple
-		double xTruthValue = TruthInput->GetValue( xName );
+		double xTruthValue = TruthInput->GetValue( xHandle );
 		double truthWeight = TruthInput->EventWeight();
 
 		//Store the x value
-		truthValues.push_back( xTruthValue );
-		XUnfolder->StoreUnreconstructedTruth( truthValues, truthWeight, useInPrior );
+		XUnfolder->StoreUnreconstructedTruthBin( BinIndex( &xTruthValue ), truthWeight, useInPrior );
 	}
 }
 void XPlotMaker::StoreFake( IFileInput * ReconstructedInput )
@@ -257,18 +269,15 @@ void XPlotMaker::StoreFake( IFileInput * ReconstructedInput )
 	}       
 	else
 	{
-		vector< double > reconstructedValues;
-
 		//Find out if this is the correct prior
 		bool useInPrior = ( priorName == *( ReconstructedInput->Description() ) );
 
 		//Retrieve the values from the Ntuple
-		double xReconstructedValue = ReconstructedInput->GetValue( xName );
+		double xReconstructedValue = ReconstructedInput->GetValue( xHandle );
 		double reconstructedWeight = ReconstructedInput->EventWeight();
 
 		//Store the x value
-		reconstructedValues.push_back( xReconstructedValue );
-		XUnfolder->StoreReconstructedFake( reconstructedValues, reconstructedWeight, useInPrior );
+		XUnfolder->StoreReconstructedFakeBin( BinIndex( &xReconstructedValue ), reconstructedWeight, useInPrior );
 	}
 }
 void XPlotMaker::StoreData( IFileInput * DataInput )
@@ -280,33 +289,77 @@ void XPlotMaker::StoreData( IFileInput * DataInput )
 	}       
 	else
 	{
-		vector< double > dataValues;
 		double randomOne, randomTwo;
 
 		//Retrieve the values from the Ntuple
-		double xDataValue = DataInput->GetValue( xName );
+		double xDataValue = DataInput->GetValue( xHandle );
 		double dataWeight = DataInput->EventWeight();
 
 		//Store the x value
-		dataValues.push_back( xDataValue );
-		XUnfolder->StoreDataValue( dataValues, dataWeight );
+		XUnfolder->StoreDataBin( BinIndex( &xDataValue ), dataWeight );
 
 		//Do all the systematic error experiments
 		for ( unsigned int experimentIndex = 0; experimentIndex < systematicOffsets.size(); experimentIndex++ )
 		{
-			dataValues[0] = xDataValue + systematicOffsets[ experimentIndex ];
+			double shiftedValue = xDataValue + systematicOffsets[ experimentIndex ];
 
 			if ( systematicWidths[ experimentIndex ] != 0.0 )
 			{
 				systematicRandom->Rannor( randomOne, randomTwo );
-				dataValues[0] += ( randomOne * systematicWidths[ experimentIndex ] );
+				shiftedValue += ( randomOne * systematicWidths[ experimentIndex ] );
 			}
 
-			systematicUnfolders[ experimentIndex ]->StoreDataValue( dataValues, dataWeight );
+			systematicUnfolders[ experimentIndex ]->StoreDataBin( BinIndex( &shiftedValue ), dataWeight );
 		}
 	} 
 }
 
+//Add the MC events stored in a copy of this object to this one
+void XPlotMaker::MergeEvents( IPlotMaker * Other )
+{
+	XPlotMaker * other = dynamic_cast< XPlotMaker* >( Other );
+	if ( !other )
+	{
+		cerr << "XPlotMaker can only merge events from copies of itself" << endl;
+		exit(1);
+	}
+	else if ( finalised || other->finalised )
+	{
+		cerr << "Trying to merge MC events with finalised XPlotMaker" << endl;
+		exit(1);
+	}
+
+	XUnfolder->MergeEvents( other->XUnfolder );
+}
+
+//Unfold this plot and its copies from CloneShareSmearingMatrix all together
+void XPlotMaker::CorrectClones( vector< IPlotMaker* > Clones, unsigned int MostIterations, bool WithSmoothing )
+{
+	if ( finalised )
+	{
+		cerr << "XPlotMaker is already finalised" << endl;
+		exit(1);
+	}
+
+	//Collect the unfolders for this plot and all the copies, including the systematics
+	vector< ICorrection* > allUnfolders( 1, XUnfolder );
+	allUnfolders.insert( allUnfolders.end(), systematicUnfolders.begin(), systematicUnfolders.end() );
+	for ( unsigned int cloneIndex = 0; cloneIndex < Clones.size(); cloneIndex++ )
+	{
+		XPlotMaker * clone = dynamic_cast< XPlotMaker* >( Clones[ cloneIndex ] );
+		if ( !clone )
+		{
+			cerr << "XPlotMaker can only correct copies of itself" << endl;
+			exit(1);
+		}
+		allUnfolders.push_back( clone->XUnfolder );
+		allUnfolders.insert( allUnfolders.end(), clone->systematicUnfolders.begin(), clone->systematicUnfolders.end() );
+	}
+
+	//Unfold them all together
+	XUnfolder->CorrectClones( allUnfolders, MostIterations, WithSmoothing );
+}
+
 //Do the unfolding
 void XPlotMaker::Correct( unsigned int MostIterations, bool SkipUnfolding, unsigned int ErrorMode, bool WithSmoothing )
 {
@@ -322,11 +375,8 @@ void XPlotMaker::Correct( unsigned int MostIterations, bool SkipUnfolding, unsig
 		{
 			XUnfolder->Correct( MostIterations, ErrorMode, WithSmoothing );
 
-			//Systematics
-			for ( unsigned int experimentIndex = 0; experimentIndex < systematicUnfolders.size(); experimentIndex++ )
-			{
-				systematicUnfolders[ experimentIndex ]->Correct( MostIterations, ErrorMode, WithSmoothing );
-			}
+			//Systematics - only the corrected distributions are needed, so skip the error calculation
+			XUnfolder->CorrectClones( systematicUnfolders, MostIterations, WithSmoothing );
 		}
 
 		//Make some plot titles
@@ -467,9 +517,9 @@ bool XPlotMaker::ClosureTest( unsigned int MostIterations, bool WithSmoothing )
 }
 
 //Make a cross-check with MC
-unsigned int XPlotMaker::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing )
+unsigned int XPlotMaker::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing, ostream & Output )
 {
-	return XUnfolder->MonteCarloCrossCheck( InputPriorDistribution, InputSmearing, WithSmoothing );
+	return XUnfolder->MonteCarloCrossCheck( InputPriorDistribution, InputSmearing, WithSmoothing, Output );
 }
 
 //Return some plots
@@ -623,3 +673,27 @@ ICorrection * XPlotMaker::MakeCorrector( int CorrectionMode )
 		exit(1);
 	}
 }
+
+//Find the 1D version of the index calculator, so events can be binned without virtual calls
+void XPlotMaker::FindFixedIndices()
+{
+	uniformIndices = dynamic_cast< FixedIndices< 1, UniformEdges >* >( distributionIndices );
+	customIndices = dynamic_cast< FixedIndices< 1, CustomEdges >* >( distributionIndices );
+}
+
+//Return the bin index for an event
+unsigned int XPlotMaker::BinIndex( const double * Values )
+{
+	if ( uniformIndices )
+	{
+		return uniformIndices->Index( Values );
+	}
+	else if ( customIndices )
+	{
+		return customIndices->Index( Values );
+	}
+	else
+	{
+		return distributionIndices->GetIndex( Values, 1 );
+	}
+}
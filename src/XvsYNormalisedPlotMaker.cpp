@@ -13,8 +13,6 @@
 #include "Folding.h"
 #include "NoCorrection.h"
 #include "BinByBinUnfolding.h"
-#include "UniformIndices.h"
-#include "CustomIndices.h"
 #include "TFile.h"
 #include <iostream>
 #include <cstdlib>
@@ -38,11 +36,11 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	correctionType = CorrectionMode;
 	xName = XVariableName;
 	yName = YVariableName;
+	xHandle = IFileInput::BindColumn( xName );
+	yHandle = IFileInput::BindColumn( yName );
 	priorName = PriorName;
 	finalised = false;
 	scaleFactor = ScaleFactor;
-	vector< double > minima, maxima;
-	vector< unsigned int > binNumbers;
 	systematicRandom = 0;
 
 	//Set up a variable to keep track of the number of plots - used to prevent Root from complaining about making objects with the same names
@@ -50,18 +48,12 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	uniqueID++;
 	thisPlotID = uniqueID;
 
-	//Store the x range
-	minima.push_back( XMinimum );
-	maxima.push_back( XMaximum );
-	binNumbers.push_back( XBinNumber );
-
-	//Store the y range
-	minima.push_back( YMinimum );
-	maxima.push_back( YMaximum );
-	binNumbers.push_back( YBinNumber );
+	//Store the x and y ranges
+	array< UniformEdges, 2 > axes = {{ UniformEdges( XBinNumber, XMinimum, XMaximum ), UniformEdges( YBinNumber, YMinimum, YMaximum ) }};
 
 	//Make the x vs y unfolder
-	distributionIndices = new UniformIndices( binNumbers, minima, maxima );
+	distributionIndices = new FixedIndices< 2, UniformEdges >( axes );
+	FindFixedIndices();
 	XvsYUnfolder = MakeCorrector( correctionType, distributionIndices, xName + "vs" + yName + priorName, thisPlotID );
 
 	//Set up the cross-check for data loss in delinearisation
@@ -69,6 +61,7 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	idString << thisPlotID;
 	string xvsyTruthName = xName + yName + priorName + "TruthCheck" + idString.str();
 	xvsyTruthCheck = new TProfile( xvsyTruthName.c_str(), xvsyTruthName.c_str(), distributionIndices->GetBinNumber(0) - 2, distributionIndices->GetBinLowEdgesForRoot(0) );
+	xvsyTruthCheck->SetDirectory( 0 );
 
 	//Make a summary for the y data values
 	yValueSummary = new StatisticsSummary();
@@ -79,6 +72,7 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	//Error calculation
 	xvsyTruthName += "SimpleProfile";
 	simpleDataProfile = new TProfile( xvsyTruthName.c_str(), xvsyTruthName.c_str(), distributionIndices->GetBinNumber(0) - 2, distributionIndices->GetBinLowEdgesForRoot(0) );
+	simpleDataProfile->SetDirectory( 0 );
 	simpleDataProfile->Sumw2();
 }
 
@@ -89,10 +83,11 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	correctionType = CorrectionMode;
 	xName = XVariableName;
 	yName = YVariableName;
+	xHandle = IFileInput::BindColumn( xName );
+	yHandle = IFileInput::BindColumn( yName );
 	priorName = PriorName;
 	finalised = false;
 	scaleFactor = ScaleFactor;
-	vector< vector< double > > binEdges;
 	systematicRandom = 0;
 
 	//Set up a variable to keep track of the number of plots - used to prevent Root from complaining about making objects with the same names
@@ -100,14 +95,12 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	uniqueID++;
 	thisPlotID = uniqueID;
 
-	//Store the x range
-	binEdges.push_back( XBinLowEdges );
-
-	//Store the y range
-	binEdges.push_back( YBinLowEdges );
+	//Store the x and y ranges
+	array< CustomEdges, 2 > axes = {{ CustomEdges( XBinLowEdges ), CustomEdges( YBinLowEdges ) }};
 
 	//Make the x vs y unfolder
-	distributionIndices = new CustomIndices( binEdges );
+	distributionIndices = new FixedIndices< 2, CustomEdges >( axes );
+	FindFixedIndices();
 	XvsYUnfolder = MakeCorrector( correctionType, distributionIndices, xName + "vs" + yName + priorName, thisPlotID );
 
 	//Set up the cross-check for data loss in delinearisation
@@ -115,6 +108,7 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	idString << thisPlotID;
 	string xvsyTruthName = xName + yName + priorName + "TruthCheck" + idString.str();
 	xvsyTruthCheck = new TProfile( xvsyTruthName.c_str(), xvsyTruthName.c_str(), distributionIndices->GetBinNumber(0) - 2, distributionIndices->GetBinLowEdgesForRoot(0) );
+	xvsyTruthCheck->SetDirectory( 0 );
 
 	//Make a summary for the y data values
 	yValueSummary = new StatisticsSummary();
@@ -125,16 +119,20 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	//Error calculation
 	xvsyTruthName += "SimpleProfile";
 	simpleDataProfile = new TProfile( xvsyTruthName.c_str(), xvsyTruthName.c_str(), distributionIndices->GetBinNumber(0) - 2, distributionIndices->GetBinLowEdgesForRoot(0) );
+	simpleDataProfile->SetDirectory( 0 );
 	simpleDataProfile->Sumw2();
 }
 
 //To be used only with Clone
 XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string YVariableName, string PriorName,
-		IIndexCalculator * DistributionIndices, int CorrectionMode, unsigned int OriginalID, double ScaleFactor, vector< vector< double > > InputOffsets, vector< vector< double > > InputWidths )
+		IIndexCalculator * DistributionIndices, int CorrectionMode, unsigned int OriginalID, double ScaleFactor, vector< vector< double > > InputOffsets, vector< vector< double > > InputWidths,
+		ICorrection * SmearingMatrixSource )
 {
 	correctionType = CorrectionMode;
 	xName = XVariableName;
 	yName = YVariableName;
+	xHandle = IFileInput::BindColumn( xName );
+	yHandle = IFileInput::BindColumn( yName );
 	priorName = PriorName;
 	finalised = false;
 	scaleFactor = ScaleFactor;
@@ -155,9 +153,17 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	uniqueID++;
 	thisPlotID = uniqueID + OriginalID;
 
-	//Make the x vs y unfolder
+	//Make the x vs y unfolder, using the smearing matrix of another if given
 	distributionIndices = DistributionIndices;
-	XvsYUnfolder = MakeCorrector( correctionType, distributionIndices, xName + "vs" + yName + priorName, thisPlotID );
+	FindFixedIndices();
+	if ( SmearingMatrixSource )
+	{
+		XvsYUnfolder = SmearingMatrixSource->ClonePriorShareSmearingMatrix( xName + "vs" + yName + priorName, thisPlotID );
+	}
+	else
+	{
+		XvsYUnfolder = MakeCorrector( correctionType, distributionIndices, xName + "vs" + yName + priorName, thisPlotID );
+	}
 
 	//Make the systematics too
 	for ( unsigned int experimentIndex = 0; experimentIndex < systematicWidths.size(); experimentIndex++ )
@@ -170,6 +176,7 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	idString << thisPlotID;
 	string xvsyTruthName = xName + yName + priorName + "TruthCheck" + idString.str();
 	xvsyTruthCheck = new TProfile( xvsyTruthName.c_str(), xvsyTruthName.c_str(), distributionIndices->GetBinNumber(0) - 2, distributionIndices->GetBinLowEdgesForRoot(0) );
+	xvsyTruthCheck->SetDirectory( 0 );
 
 	//Make a summary for the y data values
 	yValueSummary = new StatisticsSummary();
@@ -180,6 +187,7 @@ XvsYNormalisedPlotMaker::XvsYNormalisedPlotMaker( string XVariableName, string Y
 	//Error calculation
 	xvsyTruthName += "SimpleProfile";
 	simpleDataProfile = new TProfile( xvsyTruthName.c_str(), xvsyTruthName.c_str(), distributionIndices->GetBinNumber(0) - 2, distributionIndices->GetBinLowEdgesForRoot(0) );
+	simpleDataProfile->SetDirectory( 0 );
 	simpleDataProfile->Sumw2();
 }
 
@@ -225,6 +233,18 @@ XvsYNormalisedPlotMaker * XvsYNormalisedPlotMaker::Clone( string NewPriorName )
 	return new XvsYNormalisedPlotMaker( xName, yName, NewPriorName, distributionIndices->Clone(), correctionType, thisPlotID, scaleFactor, systematicOffsets, systematicWidths );
 }
 
+//Copy the object, using the smearing matrix of this one
+XvsYNormalisedPlotMaker * XvsYNormalisedPlotMaker::CloneShareSmearingMatrix( string NewPriorName )
+{
+	//Only the Bayesian unfolding can share its smearing matrix
+	if ( correctionType != BAYESIAN_MODE )
+	{
+		return 0;
+	}
+
+	return new XvsYNormalisedPlotMaker( xName, yName, NewPriorName, distributionIndices->Clone(), correctionType, thisPlotID, scaleFactor, systematicOffsets, systematicWidths, XvsYUnfolder );
+}
+
 //Set up a systematic error study
 void XvsYNormalisedPlotMaker::AddSystematic( vector< double > SystematicOffset, vector< double > SystematicWidth, unsigned int NumberOfPseudoExperiments )
 {
@@ -280,27 +300,27 @@ void XvsYNormalisedPlotMaker::StoreMatch( IFileInput * TruthInput, IFileInput *
 	}
 	else
 	{
-		vector< double > truthValues, reconstructedValues;
+		double truthValues[ 2 ], reconstructedValues[ 2 ];
 
 		//Find out if this is the correct prior
 		bool useInPrior = ( priorName == *( TruthInput->Description() ) );
 
 		//Retrieve the values from the Ntuple
-		double xTruthValue = TruthInput->GetValue( xName );
-		double xReconstructedValue = ReconstructedInput->GetValue( xName );
-		double yTruthValue = TruthInput->GetValue( yName );
-		double yReconstructedValue = ReconstructedInput->GetValue( yName );
+		double xTruthValue = TruthInput->GetValue( xHandle );
+		double xReconstructedValue = ReconstructedInput->GetValue( xHandle );
+		double yTruthValue = TruthInput->GetValue( yHandle );
+		double yReconstructedValue = ReconstructedInput->GetValue( yHandle );
 		double truthWeight = TruthInput->EventWeight();
 		double reconstructedWeight = ReconstructedInput->EventWeight();
 
 		//Store the x values
-		truthValues.push_back( xTruthValue );
-		reconstructedValues.push_back( xReconstructedValue );
+		truthValues[0] = xTruthValue;
+		reconstructedValues[0] = xReconstructedValue;
 
 		//Store the y values
-		truthValues.push_back( yTruthValue );
-		reconstructedValues.push_back( yReconstructedValue );
-		XvsYUnfolder->StoreTruthRecoPair( truthValues, reconstructedValues, truthWeight, reconstructedWeight, useInPrior );
+		truthValues[1] = yTruthValue;
+		reconstructedValues[1] = yReconstructedValue;
+		XvsYUnfolder->StoreTruthRecoPairBins( BinIndex( truthValues ), BinIndex( reconstructedValues ), truthWeight, reconstructedWeight, useInPrior );
 
 		if ( useInPrior )
 		{
@@ -318,22 +338,22 @@ void XvsYNormalisedPlotMaker::StoreMiss( IFileInput * TruthInput )
 	}
 	else
 	{
-		vector< double > truthValues;
+		double truthValues[ 2 ];
 
 		//Find out if this is the correct prior
 		bool useInPrior = ( priorName == *( TruthInput->Description() ) );
 
 		//Retrieve the values from the Ntuple
-		double xTruthValue = TruthInput->GetValue( xName );
-		double yTruthValue = TruthInput->GetValue( yName );
+		double xTruthValue = TruthInput->GetValue( xHandle );
+		double yTruthValue = TruthInput->GetValue( yHandle );
 		double truthWeight = TruthInput->EventWeight();
 
 		//Store the x value
-		truthValues.push_back( xTruthValue );
+		truthValues[0] = xTruthValue;
 
 		//Store the y value
-		truthValues.push_back( yTruthValue );
-		XvsYUnfolder->StoreUnreconstructedTruth( truthValues, truthWeight, useInPrior );
+		truthValues[1] = yTruthValue;
+		XvsYUnfolder->StoreUnreconstructedTruthBin( BinIndex( truthValues ), truthWeight, useInPrior );
 
 		if ( useInPrior )
 		{
@@ -351,22 +371,22 @@ void XvsYNormalisedPlotMaker::StoreFake( IFileInput * ReconstructedInput )
 	}       
 	else
 	{
-		vector< double > reconstructedValues;
+		double reconstructedValues[ 2 ];
 
 		//Find out if this is the correct prior
 		bool useInPrior = ( priorName == *( ReconstructedInput->Description() ) );
 
 		//Retrieve the values from the Ntuple
-		double xReconstructedValue = ReconstructedInput->GetValue( xName );
-		double yReconstructedValue = ReconstructedInput->GetValue( yName );
+		double xReconstructedValue = ReconstructedInput->GetValue( xHandle );
+		double yReconstructedValue = ReconstructedInput->GetValue( yHandle );
 		double reconstructedWeight = ReconstructedInput->EventWeight();
 
 		//Store the x value
-		reconstructedValues.push_back( xReconstructedValue );
+		reconstructedValues[0] = xReconstructedValue;
 
 		//Store the y value
-		reconstructedValues.push_back( yReconstructedValue );
-		XvsYUnfolder->StoreReconstructedFake( reconstructedValues, reconstructedWeight, useInPrior );
+		reconstructedValues[1] = yReconstructedValue;
+		XvsYUnfolder->StoreReconstructedFakeBin( BinIndex( reconstructedValues ), reconstructedWeight, useInPrior );
 	}
 }
 void XvsYNormalisedPlotMaker::StoreData( IFileInput * DataInput )
@@ -379,23 +399,23 @@ void XvsYNormalisedPlotMaker::StoreData( IFileInput * DataInput )
 	else
 	{
 		double randomOne, randomTwo;
-		vector<double> dataValues;
+		double dataValues[ 2 ];
 
 		//Retrieve the values from the Ntuple
-		double xDataValue = DataInput->GetValue( xName );
-		double yDataValue = DataInput->GetValue( yName );
+		double xDataValue = DataInput->GetValue( xHandle );
+		double yDataValue = DataInput->GetValue( yHandle );
 		double dataWeight = DataInput->EventWeight();
 
 		//Store the x value
-		dataValues.push_back( xDataValue );
+		dataValues[0] = xDataValue;
 
 		//Store the y value
-		dataValues.push_back( yDataValue );
-		XvsYUnfolder->StoreDataValue( dataValues, dataWeight );
+		dataValues[1] = yDataValue;
+		XvsYUnfolder->StoreDataBin( BinIndex( dataValues ), dataWeight );
 		yValueSummary->StoreEvent( yDataValue, dataWeight );
 
 		//Store values for performing the delinearisation
-		distributionIndices->StoreDataValue( dataValues, dataWeight );
+		StoreCentralValue( dataValues, dataWeight );
 
 		//Store the values for error calculation
 		simpleDataProfile->Fill( xDataValue, yDataValue, dataWeight );
@@ -413,11 +433,58 @@ void XvsYNormalisedPlotMaker::StoreData( IFileInput * DataInput )
 				dataValues[1] += ( randomTwo * systematicWidths[ experimentIndex ][1] );
 			}
 
-			systematicUnfolders[ experimentIndex ]->StoreDataValue( dataValues, dataWeight );
+			systematicUnfolders[ experimentIndex ]->StoreDataBin( BinIndex( dataValues ), dataWeight );
 		}
 	}
 }
 
+//Add the MC events stored in a copy of this object to this one
+void XvsYNormalisedPlotMaker::MergeEvents( IPlotMaker * Other )
+{
+	XvsYNormalisedPlotMaker * other = dynamic_cast< XvsYNormalisedPlotMaker* >( Other );
+	if ( !other )
+	{
+		cerr << "XvsYNormalisedPlotMaker can only merge events from copies of itself" << endl;
+		exit(1);
+	}
+	else if ( finalised || other->finalised )
+	{
+		cerr << "Trying to merge MC events with finalised XvsYNormalisedPlotMaker" << endl;
+		exit(1);
+	}
+
+	XvsYUnfolder->MergeEvents( other->XvsYUnfolder );
+	xvsyTruthCheck->Add( other->xvsyTruthCheck );
+}
+
+//Unfold this plot and its copies from CloneShareSmearingMatrix all together
+void XvsYNormalisedPlotMaker::CorrectClones( vector< IPlotMaker* > Clones, unsigned int MostIterations, bool WithSmoothing )
+{
+	if ( finalised )
+	{
+		cerr << "XvsYNormalisedPlotMaker is already finalised" << endl;
+		exit(1);
+	}
+
+	//Collect the unfolders for this plot and all the copies, including the systematics
+	vector< ICorrection* > allUnfolders( 1, XvsYUnfolder );
+	allUnfolders.insert( allUnfolders.end(), systematicUnfolders.begin(), systematicUnfolders.end() );
+	for ( unsigned int cloneIndex = 0; cloneIndex < Clones.size(); cloneIndex++ )
+	{
+		XvsYNormalisedPlotMaker * clone = dynamic_cast< XvsYNormalisedPlotMaker* >( Clones[ cloneIndex ] );
+		if ( !clone )
+		{
+			cerr << "XvsYNormalisedPlotMaker can only correct copies of itself" << endl;
+			exit(1);
+		}
+		allUnfolders.push_back( clone->XvsYUnfolder );
+		allUnfolders.insert( allUnfolders.end(), clone->systematicUnfolders.begin(), clone->systematicUnfolders.end() );
+	}
+
+	//Unfold them all together
+	XvsYUnfolder->CorrectClones( allUnfolders, MostIterations, WithSmoothing );
+}
+
 //Do the unfolding
 void XvsYNormalisedPlotMaker::Correct( unsigned int MostIterations, bool SkipUnfolding, unsigned int ErrorMode, bool WithSmoothing )
 {
@@ -433,11 +500,8 @@ void XvsYNormalisedPlotMaker::Correct( unsigned int MostIterations, bool SkipUnf
 		{
 			XvsYUnfolder->Correct( MostIterations, ErrorMode, WithSmoothing );
 
-			//Systematics
-			for ( unsigned int experimentIndex = 0; experimentIndex < systematicUnfolders.size(); experimentIndex++ )
-			{
-				systematicUnfolders[ experimentIndex ]->Correct( MostIterations, ErrorMode, WithSmoothing );
-			}
+			//Systematics - only the corrected distributions are needed, so skip the error calculation
+			XvsYUnfolder->CorrectClones( systematicUnfolders, MostIterations, WithSmoothing );
 		}
 
 		//Make some plot titles
@@ -643,9 +707,9 @@ bool XvsYNormalisedPlotMaker::ClosureTest( unsigned int MostIterations, bool Wit
 }
 
 //Make a cross-check with MC
-unsigned int XvsYNormalisedPlotMaker::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing )
+unsigned int XvsYNormalisedPlotMaker::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing, ostream & Output )
 {
-	return XvsYUnfolder->MonteCarloCrossCheck( InputPriorDistribution, InputSmearing, WithSmoothing );
+	return XvsYUnfolder->MonteCarloCrossCheck( InputPriorDistribution, InputSmearing, WithSmoothing, Output );
 }
 
 //Return some plots
@@ -876,3 +940,43 @@ ICorrection * XvsYNormalisedPlotMaker::MakeCorrector( int CorrectionMode, IIndex
 	}
 }
 
+//Find the 2D version of the index calculator, so events can be binned without virtual calls
+void XvsYNormalisedPlotMaker::FindFixedIndices()
+{
+	uniformIndices = dynamic_cast< FixedIndices< 2, UniformEdges >* >( distributionIndices );
+	customIndices = dynamic_cast< FixedIndices< 2, CustomEdges >* >( distributionIndices );
+}
+
+//Return the bin index for an event
+unsigned int XvsYNormalisedPlotMaker::BinIndex( const double * Values )
+{
+	if ( uniformIndices )
+	{
+		return uniformIndices->Index( Values );
+	}
+	else if ( customIndices )
+	{
+		return customIndices->Index( Values );
+	}
+	else
+	{
+		return distributionIndices->GetIndex( Values, 2 );
+	}
+}
+
+//Store an event for working out the bin central values
+void XvsYNormalisedPlotMaker::StoreCentralValue( const double * Values, double Weight )
+{
+	if ( uniformIndices )
+	{
+		uniformIndices->StoreValue( Values, Weight );
+	}
+	else if ( customIndices )
+	{
+		customIndices->StoreValue( Values, Weight );
+	}
+	else
+	{
+		distributionIndices->StoreDataValue( Values, 2, Weight );
+	}
+}
@@ -11,14 +11,18 @@
 #include "CombinedFileInput.h"
 #include "TriggerChoosingInput.h"
 #include "InputUETree.h"
+#include "InputEventCache.h"
+#include "EventIndex.h"
 #include "XPlotMaker.h"
 #include "XvsYNormalisedPlotMaker.h"
 #include "MonteCarloSummaryPlotMaker.h"
 #include "MonteCarloInformation.h"
 #include "ObservableList.h"
+#include "CovarianceMatrix.h"
 #include "TFile.h"
 #include "TROOT.h"
 #include "TStyle.h"
+#include "TThread.h"
 #include <ctime>
 #include <fstream>
 #include <unistd.h>
@@ -26,11 +30,40 @@
 #include <string>
 #include <cmath>
 #include <cstdlib>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
 
 using namespace std;
 
+//Shared by the threads loading the MC
+struct MonteCarloLoadingState
+{
+	MonteCarloInformation * mcInfo;
+	ObservableList * relevanceChecker;
+
+	//The (MC source, file) pairs to load, and the next one to start and to merge
+	vector< pair< unsigned int, unsigned int > > filePairs;
+	unsigned int nextFilePair, nextToMerge;
+
+	//Copies of the plot makers for finished file pairs, waiting for their turn to merge
+	map< unsigned int, vector< MonteCarloSummaryPlotMaker* > > finishedFilePairs;
+
+	//Event counts for each MC source
+	vector< long > matchedEvents, missedEvents, fakeEvents;
+
+	mutex stateMutex;
+};
+
 //Method declarations
-void MakeSmearingMatrices( IFileInput * TruthInput, IFileInput * ReconstructedInput );
+void LoadMonteCarlo( MonteCarloInformation * MCInfo, ObservableList * RelevanceChecker );
+void MonteCarloWorker( MonteCarloLoadingState * State );
+void MakeSmearingMatrices( IFileInput * TruthInput, IFileInput * ReconstructedInput, unsigned int FileIndex, vector< MonteCarloSummaryPlotMaker* > & PlotMakers,
+		long & MatchedEvents, long & MissedEvents, long & FakeEvents );
+void MatchEventNumbers( IFileInput * TruthInput, IFileInput * ReconstructedInput, unsigned int FileIndex, vector< long > & TruthToRecoRow, vector< bool > & RecoMatched );
+void StoreFakes( IFileInput * ReconstructedInput, unsigned int FileIndex, vector< MonteCarloSummaryPlotMaker* > & PlotMakers, vector< bool > & RecoMatched,
+		unsigned long & NextRow, unsigned long EndRow, long & FakeEvents );
 void DoTheUnfolding( IFileInput * DataInput );
 void TimeAndMemory();
 TStyle * PlotStyle( string StyleName );
@@ -81,6 +114,68 @@ const unsigned int ERROR_MODE = 0;
 ////////////////////////////////////////////////////////////
 const bool WITH_SMOOTHING = false;
 
+////////////////////////////////////////////////////////////
+//                                                        //
+// Set the number of threads used to load the MC          //
+// (0 = one for each processor core)                      //
+//                                                        //
+////////////////////////////////////////////////////////////
+const unsigned int LOADING_THREADS = 0;
+
+////////////////////////////////////////////////////////////
+//                                                        //
+// Set the number of threads used for the MC cross-checks //
+// that choose the number of iterations                   //
+// (0 = one for each processor core)                      //
+//                                                        //
+////////////////////////////////////////////////////////////
+const unsigned int CROSS_CHECK_THREADS = 0;
+
+////////////////////////////////////////////////////////////
+//                                                        //
+// Set the number of threads used to calculate the full   //
+// covariance matrix                                      //
+// (0 = one for each processor core)                      //
+//                                                        //
+////////////////////////////////////////////////////////////
+const unsigned int COVARIANCE_THREADS = 0;
+
+////////////////////////////////////////////////////////////
+//                                                        //
+// Set whether to read all the relevant columns of each   //
+// input file into memory before looping over the events  //
+// (faster, but needs memory for a whole file)            //
+//                                                        //
+////////////////////////////////////////////////////////////
+const bool PRELOAD_COLUMNS = false;
+
+////////////////////////////////////////////////////////////
+//                                                        //
+// Set a directory to cache the relevant columns of each  //
+// input file, so later runs can skip reading the ROOT    //
+// files (empty = no caching)                             //
+//                                                        //
+////////////////////////////////////////////////////////////
+const string EVENT_CACHE_DIRECTORY = "";
+
+////////////////////////////////////////////////////////////
+//                                                        //
+// Set whether to save the event number index of each     //
+// input file next to it, so later runs can skip making   //
+// the index again                                        //
+//                                                        //
+////////////////////////////////////////////////////////////
+const bool USE_EVENT_INDEX_FILES = true;
+
+////////////////////////////////////////////////////////////
+//                                                        //
+// Set whether to open the next file of a combined input  //
+// in the background while the current one is read        //
+// (only used when loading the MC with one thread)        //
+//                                                        //
+////////////////////////////////////////////////////////////
+const bool PREFETCH_NEXT_FILE = true;
+
 ////////////////////////////////////////////////////////////
 //                                                        //
 // Set the output file name                               //
@@ -311,22 +406,19 @@ int main ( int argc, char * argv[] )
 
 	//Make an object to keep track of which observables we actually need
 	ObservableList * relevanceChecker = new ObservableList( allPlotMakers );
+	InputEventCache::SetCacheDirectory( EVENT_CACHE_DIRECTORY );
+	EventIndex::SetUseIndexFiles( USE_EVENT_INDEX_FILES );
+	CovarianceMatrix::SetThreadNumber( COVARIANCE_THREADS );
 
 	//Populate the smearing matrices
-	for ( unsigned int mcIndex = 0; mcIndex < mcInfo->NumberOfSources(); mcIndex++ )
-	{
-		IFileInput * truthInput = mcInfo->MakeTruthInput( mcIndex, relevanceChecker );
-		IFileInput * reconstructedInput = mcInfo->MakeReconstructedInput( mcIndex, relevanceChecker );
-		MakeSmearingMatrices( truthInput, reconstructedInput );
-		delete truthInput;
-		delete reconstructedInput;
-	}
+	LoadMonteCarlo( mcInfo, relevanceChecker );
 
 	////////////////////////////////////////////////////////////
 	//                                                        //
 	// Load the data - Again, set this up yourself            //
 	//                                                        //
 	////////////////////////////////////////////////////////////
+	CombinedFileInput::SetPrefetchNextFile( PREFETCH_NEXT_FILE );
 
 	//MC
 	IFileInput * dataInput = mcInfo->MakeReconstructedInput( 1, relevanceChecker );
@@ -364,116 +456,310 @@ int main ( int argc, char * argv[] )
 	TimeAndMemory();
 }
 
-//Match up event numbers between truth and reco inputs
-void MakeSmearingMatrices( IFileInput * TruthInput, IFileInput * ReconstructedInput )
+//Share the MC files between threads, storing the events from each file in empty copies of the plot makers
+//The copies are merged back in file order, so the result does not depend on the number of threads
+void LoadMonteCarlo( MonteCarloInformation * MCInfo, ObservableList * RelevanceChecker )
 {
-	//Initialise
-	long matchedEvents = 0;
-	long fakeEvents = 0;
-	long missedEvents = 0;
-	cout << endl << "Loading " << *( TruthInput->Description() ) << " events" << endl;
-
-	//Check that truth and reco comprise the same number of files
-	if ( TruthInput->NumberOfFiles() != ReconstructedInput->NumberOfFiles() )
+	MonteCarloLoadingState loadingState;
+	loadingState.mcInfo = MCInfo;
+	loadingState.relevanceChecker = RelevanceChecker;
+	loadingState.nextFilePair = 0;
+	loadingState.nextToMerge = 0;
+
+	//Make the list of truth-reco file pairs - the files are only counted here, not opened
+	unsigned int sourceNumber = MCInfo->NumberOfSources();
+	for ( unsigned int mcIndex = 0; mcIndex < sourceNumber; mcIndex++ )
 	{
-		cerr << "Smearing matrix construction given " << TruthInput->NumberOfFiles() << " truth files and " << ReconstructedInput->NumberOfFiles() << " reconstructed" << endl;
-		cerr << "These numbers must be the same" << endl;
-		exit(1);
+		//Check that truth and reco comprise the same number of files
+		unsigned int truthFileNumber = MCInfo->NumberOfTruthFiles( mcIndex );
+		unsigned int reconstructedFileNumber = MCInfo->NumberOfReconstructedFiles( mcIndex );
+		if ( truthFileNumber != reconstructedFileNumber )
+		{
+			cerr << "Smearing matrix construction given " << truthFileNumber << " truth files and " << reconstructedFileNumber << " reconstructed" << endl;
+			cerr << "These numbers must be the same" << endl;
+			exit(1);
+		}
+
+		for ( unsigned int fileIndex = 0; fileIndex < truthFileNumber; fileIndex++ )
+		{
+			loadingState.filePairs.push_back( make_pair( mcIndex, fileIndex ) );
+		}
 	}
+	loadingState.matchedEvents = vector< long >( sourceNumber, 0 );
+	loadingState.missedEvents = vector< long >( sourceNumber, 0 );
+	loadingState.fakeEvents = vector< long >( sourceNumber, 0 );
 
-	//Loop over each truth-reco file pair
-	for ( unsigned int fileIndex = 0; fileIndex < TruthInput->NumberOfFiles(); fileIndex++ )
+	//Find out how many threads to use
+	unsigned int threadNumber = LOADING_THREADS;
+	if ( threadNumber == 0 )
 	{
-		//Status message
-		cout << "File " << fileIndex << " - ";
-		TimeAndMemory();
+		threadNumber = thread::hardware_concurrency();
+	}
+	if ( threadNumber > loadingState.filePairs.size() )
+	{
+		threadNumber = loadingState.filePairs.size();
+	}
+	if ( threadNumber == 0 )
+	{
+		threadNumber = 1;
+	}
+	cout << endl << "Loading " << loadingState.filePairs.size() << " MC file pairs with " << threadNumber << " threads" << endl;
 
-		//Force loading the file, so that NumberOfRows is accurate
-		TruthInput->ReadRow( 0, fileIndex );
-		ReconstructedInput->ReadRow( 0, fileIndex );
+	//Opening the next file in the background is no use when the files are shared between threads
+	CombinedFileInput::SetPrefetchNextFile( PREFETCH_NEXT_FILE && threadNumber == 1 );
+
+	//ROOT must be told before files are read in more than one thread
+	if ( threadNumber > 1 || PREFETCH_NEXT_FILE )
+	{
+		TThread::Initialize();
+	}
+
+	//Start the workers
+	vector< thread > workers;
+	for ( unsigned int threadIndex = 1; threadIndex < threadNumber; threadIndex++ )
+	{
+		workers.push_back( thread( MonteCarloWorker, &loadingState ) );
+	}
+
+	//Use this thread as well
+	MonteCarloWorker( &loadingState );
+	for ( unsigned int threadIndex = 0; threadIndex < workers.size(); threadIndex++ )
+	{
+		workers[ threadIndex ].join();
+	}
+
+	//Debug
+	for ( unsigned int mcIndex = 0; mcIndex < sourceNumber; mcIndex++ )
+	{
+		cout << endl << MCInfo->Description( mcIndex ) << endl;
+		cout << "Matched: " << loadingState.matchedEvents[ mcIndex ] << endl;
+		cout << "Missed: " << loadingState.missedEvents[ mcIndex ] << endl;
+		cout << "Fake: " << loadingState.fakeEvents[ mcIndex ] << endl;
+	}
+}
 
-		//Cache to store results of event number searches
-		vector< bool > recoMatched( ReconstructedInput->NumberOfRows(), false );
+//Load MC file pairs until there are none left
+void MonteCarloWorker( MonteCarloLoadingState * State )
+{
+	//Each thread reads the files with its own inputs
+	unsigned int sourceNumber = State->mcInfo->NumberOfSources();
+	vector< IFileInput* > truthInputs( sourceNumber, NULL );
+	vector< IFileInput* > reconstructedInputs( sourceNumber, NULL );
+
+	unique_lock< mutex > stateLock( State->stateMutex );
+	while ( State->nextFilePair < State->filePairs.size() )
+	{
+		//Take the next file pair
+		unsigned int pairIndex = State->nextFilePair;
+		State->nextFilePair++;
+		unsigned int mcIndex = State->filePairs[ pairIndex ].first;
+		unsigned int fileIndex = State->filePairs[ pairIndex ].second;
+		if ( !truthInputs[ mcIndex ] )
+		{
+			//Make this thread's inputs without holding the lock - opening a file can mean applying cuts or writing a cache
+			stateLock.unlock();
+			truthInputs[ mcIndex ] = State->mcInfo->MakeTruthInput( mcIndex, State->relevanceChecker );
+			reconstructedInputs[ mcIndex ] = State->mcInfo->MakeReconstructedInput( mcIndex, State->relevanceChecker );
+			stateLock.lock();
+		}
 
-		//Attempt to pair each truth event with a reco event
-		for ( unsigned long truthIndex = 0; truthIndex < TruthInput->NumberOfRows(); truthIndex++ )
+		//Make empty copies of the plot makers to store the events from this file
+		//Their histograms are kept out of any open input file, so closing the file doesn't delete them
+		vector< MonteCarloSummaryPlotMaker* > filePlotMakers;
+		for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
 		{
-			//Read the row, find the event number;
-			if ( TruthInput->ReadRow( truthIndex, fileIndex ) )
+			filePlotMakers.push_back( allPlotMakers[ plotIndex ]->CloneForMerging() );
+		}
+
+		//Status message
+		cout << "Loading " << *( truthInputs[ mcIndex ]->Description() ) << " file " << fileIndex << " - ";
+		TimeAndMemory();
+
+		//Load the file without holding the lock
+		long matchedEvents = 0;
+		long missedEvents = 0;
+		long fakeEvents = 0;
+		stateLock.unlock();
+		MakeSmearingMatrices( truthInputs[ mcIndex ], reconstructedInputs[ mcIndex ], fileIndex, filePlotMakers, matchedEvents, missedEvents, fakeEvents );
+		stateLock.lock();
+
+		//Count the events
+		State->matchedEvents[ mcIndex ] += matchedEvents;
+		State->missedEvents[ mcIndex ] += missedEvents;
+		State->fakeEvents[ mcIndex ] += fakeEvents;
+
+		//Merge all the finished file pairs that are next in order
+		State->finishedFilePairs[ pairIndex ] = filePlotMakers;
+		while ( State->finishedFilePairs.count( State->nextToMerge ) )
+		{
+			vector< MonteCarloSummaryPlotMaker* > & mergePlotMakers = State->finishedFilePairs[ State->nextToMerge ];
+			for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
 			{
-				UInt_t truthEventNumber = TruthInput->EventNumber();
+				allPlotMakers[ plotIndex ]->MergeEvents( mergePlotMakers[ plotIndex ] );
+				delete mergePlotMakers[ plotIndex ];
+			}
 
-				//Look for that event number in the reco file
-				if ( ReconstructedInput->ReadEvent( truthEventNumber, fileIndex ) )
-				{
-					//Matched event
+			State->finishedFilePairs.erase( State->nextToMerge );
+			State->nextToMerge++;
+		}
+	}
 
-					//Add the match to all plot makers
-					for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
-					{
-						allPlotMakers[ plotIndex ]->StoreMatch( TruthInput, ReconstructedInput );
-					}
+	//Close the files
+	for ( unsigned int mcIndex = 0; mcIndex < sourceNumber; mcIndex++ )
+	{
+		delete truthInputs[ mcIndex ];
+		delete reconstructedInputs[ mcIndex ];
+	}
+}
 
-					//Count the match
-					recoMatched[ ReconstructedInput->CurrentRow() ] = true;
-					matchedEvents++;
-				}
-				else
-				{
-					//Missed event
+//Match up event numbers between truth and reco inputs for one file, and store the events in the given plot makers
+void MakeSmearingMatrices( IFileInput * TruthInput, IFileInput * ReconstructedInput, unsigned int FileIndex, vector< MonteCarloSummaryPlotMaker* > & PlotMakers,
+		long & MatchedEvents, long & MissedEvents, long & FakeEvents )
+{
+	//Force loading the file, so that NumberOfRows is accurate
+	TruthInput->ReadRow( 0, FileIndex );
+	ReconstructedInput->ReadRow( 0, FileIndex );
+	if ( PRELOAD_COLUMNS )
+	{
+		TruthInput->PreloadColumns( FileIndex );
+		ReconstructedInput->PreloadColumns( FileIndex );
+	}
 
-					//Add the miss to all plot makers
-					for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
-					{
-						allPlotMakers[ plotIndex ]->StoreMiss( TruthInput );
-					}
+	//Work out which reco row goes with each truth row before reading any events
+	vector< long > truthToRecoRow;
+	vector< bool > recoMatched;
+	MatchEventNumbers( TruthInput, ReconstructedInput, FileIndex, truthToRecoRow, recoMatched );
 
-					//Count the miss
-					missedEvents++;
-				}
-			}
-			else
+	//Read each truth event in order, with its reco event if there is one
+	unsigned long nextFakeRow = 0;
+	TruthInput->StartScan( FileIndex );
+	for ( unsigned long truthIndex = 0; TruthInput->Next(); truthIndex++ )
+	{
+		long recoIndex = truthToRecoRow[ truthIndex ];
+		if ( recoIndex >= 0 )
+		{
+			//Matched event
+
+			//Store any fakes before the reco row, so the reco events are read in order too
+			StoreFakes( ReconstructedInput, FileIndex, PlotMakers, recoMatched, nextFakeRow, recoIndex, FakeEvents );
+
+			//Read the reco row
+			if ( !ReconstructedInput->ReadRow( recoIndex, FileIndex ) )
 			{
 				cerr << "Stupidity fail" << endl;
 				exit(1);
 			}
-		}
 
-		//Any reconstructed events not paired are fake
-		for ( unsigned long recoIndex = 0; recoIndex < ReconstructedInput->NumberOfRows(); recoIndex++ )
+			//Add the match to all plot makers
+			for ( unsigned int plotIndex = 0; plotIndex < PlotMakers.size(); plotIndex++ )
+			{
+				PlotMakers[ plotIndex ]->StoreMatch( TruthInput, ReconstructedInput );
+			}
+
+			//Count the match
+			MatchedEvents++;
+		}
+		else
 		{
-			//Find the rows that weren't matched
-			if ( !recoMatched[ recoIndex ] )
+			//Missed event
+
+			//Add the miss to all plot makers
+			for ( unsigned int plotIndex = 0; plotIndex < PlotMakers.size(); plotIndex++ )
 			{
-				//Fake event
+				PlotMakers[ plotIndex ]->StoreMiss( TruthInput );
+			}
 
-				//Read the event from disk
-				if ( ReconstructedInput->ReadRow( recoIndex, fileIndex ) )
-				{
-					//Add the fake to all plotmakers
-					for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
-					{
-						allPlotMakers[plotIndex]->StoreFake( ReconstructedInput );
-					}
-
-					//Record the fake
-					fakeEvents++;
-				}
-				else
+			//Count the miss
+			MissedEvents++;
+		}
+	}
+
+	//Any reconstructed events left over are fake
+	StoreFakes( ReconstructedInput, FileIndex, PlotMakers, recoMatched, nextFakeRow, ReconstructedInput->NumberOfRows(), FakeEvents );
+}
+
+//Pair each truth row with the reco row that has the same event number (or -1 if there is none)
+//Sorting the event numbers and merging the lists avoids looking up each event in the reco input
+void MatchEventNumbers( IFileInput * TruthInput, IFileInput * ReconstructedInput, unsigned int FileIndex, vector< long > & TruthToRecoRow, vector< bool > & RecoMatched )
+{
+	//Get the event numbers
+	vector< UInt_t > truthEventNumbers, recoEventNumbers;
+	TruthInput->GetEventNumbers( FileIndex, truthEventNumbers );
+	ReconstructedInput->GetEventNumbers( FileIndex, recoEventNumbers );
+
+	//Sort (event number, row) pairs
+	vector< pair< UInt_t, unsigned long > > sortedTruth( truthEventNumbers.size() );
+	for ( unsigned long truthIndex = 0; truthIndex < truthEventNumbers.size(); truthIndex++ )
+	{
+		sortedTruth[ truthIndex ] = make_pair( truthEventNumbers[ truthIndex ], truthIndex );
+	}
+	sort( sortedTruth.begin(), sortedTruth.end() );
+	vector< pair< UInt_t, unsigned long > > sortedReco( recoEventNumbers.size() );
+	for ( unsigned long recoIndex = 0; recoIndex < recoEventNumbers.size(); recoIndex++ )
+	{
+		sortedReco[ recoIndex ] = make_pair( recoEventNumbers[ recoIndex ], recoIndex );
+	}
+	sort( sortedReco.begin(), sortedReco.end() );
+
+	//Merge the sorted lists
+	TruthToRecoRow = vector< long >( truthEventNumbers.size(), -1 );
+	RecoMatched = vector< bool >( recoEventNumbers.size(), false );
+	unsigned long recoPosition = 0;
+	for ( unsigned long truthPosition = 0; truthPosition < sortedTruth.size(); truthPosition++ )
+	{
+		UInt_t eventNumber = sortedTruth[ truthPosition ].first;
+
+		//Find the reco event number
+		while ( recoPosition < sortedReco.size() && sortedReco[ recoPosition ].first < eventNumber )
+		{
+			recoPosition++;
+		}
+
+		//If the event number is repeated, use the last row - as the event number lookup did
+		while ( recoPosition + 1 < sortedReco.size() && sortedReco[ recoPosition + 1 ].first == eventNumber )
+		{
+			recoPosition++;
+		}
+
+		//Check for a match
+		if ( recoPosition < sortedReco.size() && sortedReco[ recoPosition ].first == eventNumber )
+		{
+			TruthToRecoRow[ sortedTruth[ truthPosition ].second ] = sortedReco[ recoPosition ].second;
+			RecoMatched[ sortedReco[ recoPosition ].second ] = true;
+		}
+	}
+}
+
+//Store all reco rows that were not matched, from NextRow up to EndRow
+void StoreFakes( IFileInput * ReconstructedInput, unsigned int FileIndex, vector< MonteCarloSummaryPlotMaker* > & PlotMakers, vector< bool > & RecoMatched,
+		unsigned long & NextRow, unsigned long EndRow, long & FakeEvents )
+{
+	for ( ; NextRow < EndRow; NextRow++ )
+	{
+		//Find the rows that weren't matched
+		if ( !RecoMatched[ NextRow ] )
+		{
+			//Fake event
+
+			//Read the event from disk
+			if ( ReconstructedInput->ReadRow( NextRow, FileIndex ) )
+			{
+				//Add the fake to all plotmakers
+				for ( unsigned int plotIndex = 0; plotIndex < PlotMakers.size(); plotIndex++ )
 				{
-					cerr << "Stupidity fail" << endl;
-					exit(1);
+					PlotMakers[plotIndex]->StoreFake( ReconstructedInput );
 				}
+
+				//Record the fake
+				FakeEvents++;
+			}
+			else
+			{
+				cerr << "Stupidity fail" << endl;
+				exit(1);
 			}
 		}
-
-		recoMatched.clear();
 	}
-
-	//Debug
-	cout << "Matched: " << matchedEvents << endl;
-	cout << "Missed: " << missedEvents << endl;
-	cout << "Fake: " << fakeEvents << endl;
 }
 
 void DoTheUnfolding( IFileInput * DataInput )
@@ -481,6 +767,9 @@ void DoTheUnfolding( IFileInput * DataInput )
 	//Status message
 	cout << endl << "Loading " << *( DataInput->Description() ) << " events" << endl;
 
+	//The data is only read in order, so there's no need for an event number index
+	DataInput->SetSequentialOnly( true );
+
 	//Populate the data distribution
 	long dataTotal = 0;
 	for ( unsigned int fileIndex = 0; fileIndex < DataInput->NumberOfFiles(); fileIndex++ )
@@ -491,27 +780,23 @@ void DoTheUnfolding( IFileInput * DataInput )
 
 		//Force loading the file, so that NumberOfRows is accurate
 		DataInput->ReadRow( 0, fileIndex );
+		if ( PRELOAD_COLUMNS )
+		{
+			DataInput->PreloadColumns( fileIndex );
+		}
 
 		//Loop over each row in the file
-		for ( unsigned long dataIndex = 0; dataIndex < DataInput->NumberOfRows(); dataIndex++ )
+		DataInput->StartScan( fileIndex );
+		while ( DataInput->Next() )
 		{
-			//Read the row from disk
-			if ( DataInput->ReadRow( dataIndex, fileIndex ) )
+			//Store the row in all plot makers
+			for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
 			{
-				//Store the row in all plot makers
-				for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
-				{
-					allPlotMakers[ plotIndex ]->StoreData( DataInput );
-				}
-
-				//Count the data
-				dataTotal++;
-			}
-			else
-			{
-				cerr << "Stupidity fail" << endl;
-				exit(1);
+				allPlotMakers[ plotIndex ]->StoreData( DataInput );
 			}
+
+			//Count the data
+			dataTotal++;
 		}
 	}
 	cout << "Total: " << dataTotal << endl;
@@ -526,7 +811,7 @@ void DoTheUnfolding( IFileInput * DataInput )
 	for ( unsigned int plotIndex = 0; plotIndex < allPlotMakers.size(); plotIndex++ )
 	{
 		//Unfold the data
-		allPlotMakers[ plotIndex ]->Process( ERROR_MODE, WITH_SMOOTHING );
+		allPlotMakers[ plotIndex ]->Process( ERROR_MODE, WITH_SMOOTHING, CROSS_CHECK_THREADS );
 
 		//Write the result to file
 		allPlotMakers[ plotIndex ]->SaveResult( OutputFile );
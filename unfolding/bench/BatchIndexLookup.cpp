@@ -0,0 +1,167 @@
+/**
+  BatchIndexLookup
+
+  Checks the batch bin lookups (IIndexCalculator::GetIndices, with AVX2 or NEON where available) against the one-event lookups,
+  then times both - nothing in the event loop uses the batch lookups yet, so this is where they are exercised
+  Build and run with "make bench"
+ */
+
+#include "UniformIndices.h"
+#include "CustomIndices.h"
+#include "BatchIndices.h"
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <limits>
+
+using namespace std;
+
+const unsigned int VALUE_NUMBER = 1000003;
+const unsigned int TIMING_REPEATS = 20;
+
+double RandomValue( double Low, double High )
+{
+	return Low + ( High - Low ) * ( double )rand() / ( double )RAND_MAX;
+}
+
+double SecondsSince( clock_t Start )
+{
+	return ( double )( clock() - Start ) / ( double )CLOCKS_PER_SEC;
+}
+
+//Compare the batch and one-event lookups for every event, then time them - returns the number of differences
+unsigned int CheckIndices( IIndexCalculator * Indices, const vector< vector< double > > & Columns, string Name )
+{
+	unsigned int dimensionNumber = Columns.size();
+	unsigned int eventNumber = Columns[ 0 ].size();
+	vector< const double* > columnPointers;
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < dimensionNumber; dimensionIndex++ )
+	{
+		columnPointers.push_back( &Columns[ dimensionIndex ][ 0 ] );
+	}
+
+	vector< unsigned int > batchIndices( eventNumber );
+	Indices->GetIndices( &columnPointers[ 0 ], dimensionNumber, eventNumber, &batchIndices[ 0 ] );
+
+	unsigned int differences = 0;
+	vector< double > eventValues( dimensionNumber );
+	for ( unsigned int eventIndex = 0; eventIndex < eventNumber; eventIndex++ )
+	{
+		for ( unsigned int dimensionIndex = 0; dimensionIndex < dimensionNumber; dimensionIndex++ )
+		{
+			eventValues[ dimensionIndex ] = Columns[ dimensionIndex ][ eventIndex ];
+		}
+		unsigned int eventBin = Indices->GetIndex( &eventValues[ 0 ], dimensionNumber );
+		if ( eventBin != batchIndices[ eventIndex ] )
+		{
+			if ( differences < 5 )
+			{
+				cerr << Name << ": event " << eventIndex << " (first value " << eventValues[ 0 ] << ") is in bin " << eventBin << ", but batch bin " << batchIndices[ eventIndex ] << endl;
+			}
+			differences++;
+		}
+	}
+
+	//Time both ways
+	unsigned long binSum = 0;
+	clock_t start = clock();
+	for ( unsigned int repeat = 0; repeat < TIMING_REPEATS; repeat++ )
+	{
+		Indices->GetIndices( &columnPointers[ 0 ], dimensionNumber, eventNumber, &batchIndices[ 0 ] );
+		binSum += batchIndices[ repeat ];
+	}
+	double batchTime = SecondsSince( start ) * 1E9 / ( ( double )TIMING_REPEATS * ( double )eventNumber );
+
+	start = clock();
+	for ( unsigned int repeat = 0; repeat < TIMING_REPEATS; repeat++ )
+	{
+		for ( unsigned int eventIndex = 0; eventIndex < eventNumber; eventIndex++ )
+		{
+			for ( unsigned int dimensionIndex = 0; dimensionIndex < dimensionNumber; dimensionIndex++ )
+			{
+				eventValues[ dimensionIndex ] = Columns[ dimensionIndex ][ eventIndex ];
+			}
+			binSum += Indices->GetIndex( &eventValues[ 0 ], dimensionNumber );
+		}
+	}
+	double eventTime = SecondsSince( start ) * 1E9 / ( ( double )TIMING_REPEATS * ( double )eventNumber );
+
+	cout << Name << ": " << differences << " differences in " << eventNumber << " events, ns per event: batch " << batchTime << ", one at a time " << eventTime;
+	cout << " (bin sum " << binSum << ")" << endl;
+	return differences;
+}
+
+int main()
+{
+	srand( 3 );
+	cout << "Batch lookups use " << ( BatchIndices::UseAVX2() ? "AVX2" : "no AVX2" ) << endl;
+
+	//Every seventh value is special: not a number, infinite, huge, or on or next to an edge
+	const double specialValues[ 13 ] = { 0.0, 100.0, -0.0, numeric_limits< double >::quiet_NaN(), numeric_limits< double >::infinity(),
+		-numeric_limits< double >::infinity(), 1E300, -1E300, nextafter( 100.0, 200.0 ), nextafter( 0.0, 1.0 ), 10.0, 20.0, 5.0 * 0.1 * 100.0 };
+
+	//Otherwise random, with some whole numbers so values land on the uniform edges
+	vector< vector< double > > columns( 2, vector< double >( VALUE_NUMBER ) );
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < columns.size(); dimensionIndex++ )
+	{
+		for ( unsigned int valueIndex = 0; valueIndex < VALUE_NUMBER; valueIndex++ )
+		{
+			double value = RandomValue( -20.0, 120.0 );
+			if ( valueIndex % 7 == 0 )
+			{
+				value = specialValues[ ( valueIndex / 7 ) % 13 ];
+			}
+			else if ( valueIndex % 5 == 0 )
+			{
+				value = floor( value );
+			}
+			columns[ dimensionIndex ][ valueIndex ] = value;
+		}
+	}
+	vector< vector< double > > firstColumn( 1, columns[ 0 ] );
+
+	unsigned int differences = 0;
+
+	//Uniform bins, in two dimensions
+	vector< unsigned int > binNumbers( 1, 37 );
+	binNumbers.push_back( 11 );
+	vector< double > minima( 1, 0.0 );
+	minima.push_back( -5.0 );
+	vector< double > maxima( 1, 100.0 );
+	maxima.push_back( 95.0 );
+	UniformIndices uniformIndices( binNumbers, minima, maxima );
+	differences += CheckIndices( &uniformIndices, columns, "uniform 37x11" );
+
+	//Custom bins in two dimensions, then the smallest custom binnings
+	vector< vector< double > > customEdges( 2 );
+	for ( unsigned int edgeIndex = 0; edgeIndex <= 30; edgeIndex++ )
+	{
+		customEdges[ 0 ].push_back( pow( 1.15, ( double )edgeIndex ) - 1.0 );
+	}
+	for ( unsigned int edgeIndex = 0; edgeIndex <= 3; edgeIndex++ )
+	{
+		customEdges[ 1 ].push_back( ( double )edgeIndex * 30.0 );
+	}
+	CustomIndices customIndices( customEdges );
+	differences += CheckIndices( &customIndices, columns, "custom 30x3" );
+
+	vector< vector< double > > oneBinEdges( 1, vector< double >( 1, 0.0 ) );
+	oneBinEdges[ 0 ].push_back( 100.0 );
+	CustomIndices oneBinIndices( oneBinEdges );
+	differences += CheckIndices( &oneBinIndices, firstColumn, "custom 1 bin" );
+
+	vector< vector< double > > twoBinEdges = oneBinEdges;
+	twoBinEdges[ 0 ].insert( twoBinEdges[ 0 ].begin() + 1, 50.0 );
+	CustomIndices twoBinIndices( twoBinEdges );
+	differences += CheckIndices( &twoBinIndices, firstColumn, "custom 2 bins" );
+
+	if ( differences > 0 )
+	{
+		cerr << "Batch lookups differ from the one-event lookups for " << differences << " events" << endl;
+		return 1;
+	}
+	cout << "Batch lookups match the one-event lookups" << endl;
+	return 0;
+}
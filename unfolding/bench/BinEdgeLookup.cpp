@@ -0,0 +1,199 @@
+/**
+  BinEdgeLookup
+
+  Micro-benchmark of BinEdgeSearch, with and without its grid, against the map lookup that CustomIndices used before
+  Every search is first checked against the map at and either side of every edge, and on random values
+  Build and run with "make bench"
+ */
+
+#include "BinEdgeSearch.h"
+#include <map>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <limits>
+
+using namespace std;
+
+const unsigned int CHECK_VALUE_NUMBER = 200000;
+const unsigned int TIMING_VALUE_NUMBER = 1 << 20;
+const unsigned int TIMING_REPEATS = 20;
+
+//The old lookup, copied from CustomIndices::GetOneDimensionIndex before BinEdgeSearch
+class MapSearch
+{
+	public:
+		MapSearch( const vector< double > & LowEdges )
+		{
+			lowestEdge = LowEdges[ 0 ];
+			binNumber = LowEdges.size() - 1;
+			for ( unsigned int binIndex = 0; binIndex < binNumber; binIndex++ )
+			{
+				highEdgeMap[ LowEdges[ binIndex + 1 ] ] = binIndex;
+			}
+		}
+
+		unsigned int FindBin( double Value ) const
+		{
+			if ( Value <= lowestEdge )
+			{
+				return 0;
+			}
+			map< double, unsigned int >::const_iterator searchIterator = highEdgeMap.upper_bound( Value );
+			if ( searchIterator == highEdgeMap.end() )
+			{
+				return binNumber + 1;
+			}
+			else
+			{
+				return searchIterator->second + 1;
+			}
+		}
+
+	private:
+		map< double, unsigned int > highEdgeMap;
+		double lowestEdge;
+		unsigned int binNumber;
+};
+
+//Geometric edges from 20 GeV to 1.2 TeV, rounded to 100 MeV, like the jet pT binnings
+vector< double > JetEdges( double Ratio )
+{
+	vector< double > edges;
+	for ( double edge = 20000.0; edge < 1.2E6; edge *= Ratio )
+	{
+		double rounded = floor( edge / 100.0 + 0.5 ) * 100.0;
+		if ( edges.empty() || edges.back() != rounded )
+		{
+			edges.push_back( rounded );
+		}
+	}
+	return edges;
+}
+
+double RandomValue( double Low, double High )
+{
+	return Low + ( High - Low ) * ( double )rand() / ( double )RAND_MAX;
+}
+
+//Compare both searches with the map - returns the number of differences
+unsigned int CheckEdges( const vector< double > & Edges )
+{
+	MapSearch mapSearch( Edges );
+	BinEdgeSearch gridSearch( Edges, true );
+	BinEdgeSearch binarySearch( Edges, false );
+
+	//At and either side of every edge, plus the special values
+	vector< double > values;
+	for ( unsigned int edgeIndex = 0; edgeIndex < Edges.size(); edgeIndex++ )
+	{
+		values.push_back( Edges[ edgeIndex ] );
+		values.push_back( nextafter( Edges[ edgeIndex ], -numeric_limits< double >::infinity() ) );
+		values.push_back( nextafter( Edges[ edgeIndex ], numeric_limits< double >::infinity() ) );
+	}
+	values.push_back( numeric_limits< double >::quiet_NaN() );
+	values.push_back( numeric_limits< double >::infinity() );
+	values.push_back( -numeric_limits< double >::infinity() );
+	values.push_back( 1E300 );
+	values.push_back( -1E300 );
+
+	//Random values, including some outside the edges
+	double margin = 0.1 * ( Edges.back() - Edges.front() );
+	for ( unsigned int valueIndex = 0; valueIndex < CHECK_VALUE_NUMBER; valueIndex++ )
+	{
+		values.push_back( RandomValue( Edges.front() - margin, Edges.back() + margin ) );
+	}
+
+	unsigned int differences = 0;
+	for ( unsigned int valueIndex = 0; valueIndex < values.size(); valueIndex++ )
+	{
+		unsigned int mapBin = mapSearch.FindBin( values[ valueIndex ] );
+		if ( gridSearch.FindBin( values[ valueIndex ] ) != mapBin || binarySearch.FindBin( values[ valueIndex ] ) != mapBin )
+		{
+			if ( differences < 5 )
+			{
+				cerr << "Different bin for " << values[ valueIndex ] << " with " << Edges.size() << " edges" << endl;
+			}
+			differences++;
+		}
+	}
+	return differences;
+}
+
+//Time one search over the values, in ns per lookup
+template< class Search > double TimeLookups( const Search & Lookup, const vector< double > & Values, unsigned long & BinSum )
+{
+	clock_t start = clock();
+	for ( unsigned int repeat = 0; repeat < TIMING_REPEATS; repeat++ )
+	{
+		for ( unsigned int valueIndex = 0; valueIndex < Values.size(); valueIndex++ )
+		{
+			BinSum += Lookup.FindBin( Values[ valueIndex ] );
+		}
+	}
+	double seconds = ( double )( clock() - start ) / ( double )CLOCKS_PER_SEC;
+	return seconds * 1E9 / ( ( double )TIMING_REPEATS * ( double )Values.size() );
+}
+
+int main()
+{
+	srand( 5 );
+
+	//The timed edge sets, from coarse to fine
+	vector< vector< double > > timedEdges;
+	timedEdges.push_back( JetEdges( 1.15 ) );
+	timedEdges.push_back( JetEdges( 1.01 ) );
+	timedEdges.push_back( JetEdges( 1.002 ) );
+
+	//Also check some small and regular edge sets
+	vector< vector< double > > checkedEdges = timedEdges;
+	checkedEdges.push_back( vector< double >( 1, 0.0 ) );
+	checkedEdges.back().push_back( 1.0 );
+	checkedEdges.push_back( checkedEdges.back() );
+	checkedEdges.back().push_back( 2.0 );
+	double irregularEdges[ 6 ] = { -5.0, -1.0, 0.0, 2.5, 7.0, 100.0 };
+	checkedEdges.push_back( vector< double >( irregularEdges, irregularEdges + 6 ) );
+	checkedEdges.push_back( vector< double >() );
+	for ( unsigned int edgeIndex = 0; edgeIndex <= 200; edgeIndex++ )
+	{
+		checkedEdges.back().push_back( ( double )edgeIndex * 0.5 );
+	}
+
+	unsigned int differences = 0;
+	for ( unsigned int setIndex = 0; setIndex < checkedEdges.size(); setIndex++ )
+	{
+		differences += CheckEdges( checkedEdges[ setIndex ] );
+	}
+	if ( differences > 0 )
+	{
+		cerr << "BinEdgeSearch differs from the map lookup for " << differences << " values" << endl;
+		return 1;
+	}
+	cout << "BinEdgeSearch gives the same bins as the map lookup for all " << checkedEdges.size() << " edge sets" << endl;
+
+	//Time the lookups on random values over the whole range
+	vector< double > values( TIMING_VALUE_NUMBER );
+	for ( unsigned int valueIndex = 0; valueIndex < TIMING_VALUE_NUMBER; valueIndex++ )
+	{
+		values[ valueIndex ] = RandomValue( 0.0, 1.3E6 );
+	}
+
+	unsigned long binSum = 0;
+	cout << "ns per lookup:" << endl;
+	for ( unsigned int setIndex = 0; setIndex < timedEdges.size(); setIndex++ )
+	{
+		MapSearch mapSearch( timedEdges[ setIndex ] );
+		BinEdgeSearch binarySearch( timedEdges[ setIndex ], false );
+		BinEdgeSearch gridSearch( timedEdges[ setIndex ], true );
+
+		cout << "  " << timedEdges[ setIndex ].size() << " edges: map " << TimeLookups( mapSearch, values, binSum );
+		cout << ", binary " << TimeLookups( binarySearch, values, binSum );
+		cout << ", grid " << TimeLookups( gridSearch, values, binSum ) << endl;
+	}
+
+	//Use the sum, so the lookups can't be optimised away
+	cout << "(bin sum " << binSum << ")" << endl;
+	return 0;
+}
@@ -0,0 +1,121 @@
+/**
+  ComparisonAgainstRoot
+
+  Checks the Comparison statistics against the Root histogram tests they replace, with the Root version this is built against
+  The histograms are filled the way Distribution::MakeRootHistogram fills them, including the under and overflow bins
+  Build and run with "make bench"
+ */
+
+#include "Comparison.h"
+#include "TH1F.h"
+#include "RVersion.h"
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+const unsigned int PAIR_NUMBER = 2000;
+const double CHI_SQUARED_TOLERANCE = 1E-9;
+const double KOLMOGOROV_TOLERANCE = 1E-9;
+
+//Contents for bins 0 to N + 1, as in a Distribution without the bad bin
+vector< double > RandomContents( unsigned int BinNumber, double Mean, double Scale, double EmptyFraction )
+{
+	vector< double > contents( BinNumber + 2, 0.0 );
+	for ( unsigned int binIndex = 0; binIndex < contents.size(); binIndex++ )
+	{
+		if ( ( double )rand() / ( double )RAND_MAX < EmptyFraction )
+		{
+			continue;
+		}
+
+		//Roughly Poisson, from the sum of a few uniform numbers
+		double count = 0.0;
+		for ( unsigned int draw = 0; draw < 4; draw++ )
+		{
+			count += ( double )rand() / ( double )RAND_MAX;
+		}
+		contents[ binIndex ] = floor( Mean * count / 2.0 ) * Scale;
+	}
+	return contents;
+}
+
+//A histogram filled as Distribution::MakeRootHistogram does - bin 0 is the underflow
+TH1F * MakeHistogram( const vector< double > & Contents, unsigned int PairIndex, string Name )
+{
+	stringstream fullName;
+	fullName << Name << PairIndex;
+	unsigned int binNumber = Contents.size() - 2;
+	TH1F * histogram = new TH1F( fullName.str().c_str(), fullName.str().c_str(), binNumber, 0.0, ( double )binNumber );
+	for ( unsigned int binIndex = 0; binIndex < Contents.size(); binIndex++ )
+	{
+		histogram->SetBinContent( binIndex, Contents[ binIndex ] );
+	}
+	return histogram;
+}
+
+int main()
+{
+	cout << "Comparing with Root " << ROOT_RELEASE << endl;
+	TH1::AddDirectory( false );
+	srand( 7 );
+
+	double worstChiSquared = 0.0, worstKolmogorov = 0.0;
+	unsigned int failures = 0;
+	for ( unsigned int pairIndex = 0; pairIndex < PAIR_NUMBER; pairIndex++ )
+	{
+		//Vary the number of bins, the size of the contents, whether they're whole numbers and how many are empty
+		unsigned int binNumber = 1 + ( pairIndex % 60 );
+		double scale = ( pairIndex % 3 == 0 ) ? 1.0 : 0.37;
+		double emptyFraction = ( pairIndex % 4 == 0 ) ? 0.3 : 0.0;
+		vector< double > firstContents = RandomContents( binNumber, 5.0 + ( double )( pairIndex % 200 ), scale, emptyFraction );
+		vector< double > secondContents = RandomContents( binNumber, 5.0 + ( double )( pairIndex % 150 ), scale * 1.1, emptyFraction );
+
+		//Some special cases: identical, and one histogram empty
+		if ( pairIndex % 97 == 0 )
+		{
+			secondContents = firstContents;
+		}
+		else if ( pairIndex % 101 == 0 )
+		{
+			secondContents = vector< double >( binNumber + 2, 0.0 );
+		}
+
+		TH1F * firstHistogram = MakeHistogram( firstContents, pairIndex, "first" );
+		TH1F * secondHistogram = MakeHistogram( secondContents, pairIndex, "second" );
+		double rootChiSquared = firstHistogram->Chi2Test( secondHistogram, "UUCHI2" );
+		double rootKolmogorov = firstHistogram->KolmogorovTest( secondHistogram, "" );
+		delete firstHistogram;
+		delete secondHistogram;
+
+		//The comparison skips the underflow, as CompareDistributions does
+		double chiSquared = Comparison::UnweightedChiSquared( &firstContents[ 1 ], &secondContents[ 1 ], binNumber );
+		double kolmogorov = Comparison::KolmogorovProbability( &firstContents[ 1 ], &secondContents[ 1 ], binNumber );
+
+		double chiSquaredDifference = fabs( chiSquared - rootChiSquared ) / max( 1.0, fabs( rootChiSquared ) );
+		double kolmogorovDifference = fabs( kolmogorov - rootKolmogorov );
+		worstChiSquared = max( worstChiSquared, chiSquaredDifference );
+		worstKolmogorov = max( worstKolmogorov, kolmogorovDifference );
+		if ( chiSquaredDifference > CHI_SQUARED_TOLERANCE || kolmogorovDifference > KOLMOGOROV_TOLERANCE )
+		{
+			if ( failures < 5 )
+			{
+				cerr << "Pair " << pairIndex << " (" << binNumber << " bins): chi squared " << chiSquared << " vs Root " << rootChiSquared;
+				cerr << ", Kolmogorov " << kolmogorov << " vs Root " << rootKolmogorov << endl;
+			}
+			failures++;
+		}
+	}
+
+	cout << "Largest difference from Root over " << PAIR_NUMBER << " histogram pairs: chi squared " << worstChiSquared << " (relative), Kolmogorov " << worstKolmogorov << endl;
+	if ( failures > 0 )
+	{
+		cerr << failures << " pairs differ from Root by more than the tolerance" << endl;
+		return 1;
+	}
+	cout << "Comparison matches Root" << endl;
+	return 0;
+}
@@ -0,0 +1,154 @@
+/**
+  SparseMatrixFill
+
+  Benchmark of the SparseMatrix fill: the triplet storage compressed to rows, against the map it replaced
+  Both fill the same band matrix with the same entries, then the finalised values are checked to be identical
+  Build and run with "make bench"
+ */
+
+#include "SparseMatrix.h"
+#include <map>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+
+const unsigned int BIN_NUMBER = 2000;
+const unsigned int BAND_HALF_WIDTH = 5;
+const unsigned int FILL_NUMBER = 20000000;
+
+//The old map-based fill, copied from the SparseMatrix it replaced
+class MapMatrix
+{
+	public:
+		void AddToEntry( unsigned int FirstIndex, unsigned int SecondIndex, double Value )
+		{
+			const pair< unsigned int, unsigned int > searchPair( FirstIndex, SecondIndex );
+			const map< pair< unsigned int, unsigned int >, double >::iterator searchResult = matrix.find( searchPair );
+			if ( searchResult == matrix.end() )
+			{
+				matrix[ searchPair ] = Value;
+			}
+			else
+			{
+				matrix[ searchPair ] += Value;
+			}
+		}
+
+		void VectorsFromMap( unsigned int BinNumber )
+		{
+			matrixValues = vector< vector< double > >( BinNumber, vector< double >() );
+			secondIndices = vector< vector< unsigned int > >( BinNumber, vector< unsigned int >() );
+			map< pair< unsigned int, unsigned int >, double >::iterator matrixIterator;
+			for ( matrixIterator = matrix.begin(); matrixIterator != matrix.end(); matrixIterator++ )
+			{
+				secondIndices[ matrixIterator->first.first ].push_back( matrixIterator->first.second );
+				matrixValues[ matrixIterator->first.first ].push_back( matrixIterator->second );
+			}
+		}
+
+		map< pair< unsigned int, unsigned int >, double > matrix;
+		vector< vector< double > > matrixValues;
+		vector< vector< unsigned int > > secondIndices;
+};
+
+//Expose the protected fill methods of the current SparseMatrix
+class TripletMatrix : public SparseMatrix
+{
+	public:
+		void Fill( unsigned int FirstIndex, unsigned int SecondIndex, double Value )
+		{
+			AddToEntry( FirstIndex, SecondIndex, Value );
+		}
+
+		void Finalise( unsigned int BinNumber )
+		{
+			VectorsFromMap( BinNumber );
+		}
+};
+
+double SecondsSince( clock_t Start )
+{
+	return ( double )( clock() - Start ) / ( double )CLOCKS_PER_SEC;
+}
+
+int main()
+{
+	//Make the fills up front, so only the matrix is timed
+	cout << "Filling a " << BIN_NUMBER << "x" << BIN_NUMBER << " band matrix (half-width " << BAND_HALF_WIDTH << ") " << FILL_NUMBER << " times" << endl;
+	srand( 1 );
+	vector< unsigned int > firstIndices( FILL_NUMBER ), secondIndices( FILL_NUMBER );
+	vector< double > values( FILL_NUMBER );
+	for ( unsigned int fillIndex = 0; fillIndex < FILL_NUMBER; fillIndex++ )
+	{
+		unsigned int first = rand() % BIN_NUMBER;
+		int second = ( int )first + ( rand() % ( 2 * BAND_HALF_WIDTH + 1 ) ) - ( int )BAND_HALF_WIDTH;
+		if ( second < 0 )
+		{
+			second = 0;
+		}
+		else if ( second >= ( int )BIN_NUMBER )
+		{
+			second = BIN_NUMBER - 1;
+		}
+		firstIndices[ fillIndex ] = first;
+		secondIndices[ fillIndex ] = second;
+		values[ fillIndex ] = 0.5 + ( double )rand() / ( double )RAND_MAX;
+	}
+
+	//The old map
+	clock_t start = clock();
+	MapMatrix * mapMatrix = new MapMatrix();
+	for ( unsigned int fillIndex = 0; fillIndex < FILL_NUMBER; fillIndex++ )
+	{
+		mapMatrix->AddToEntry( firstIndices[ fillIndex ], secondIndices[ fillIndex ], values[ fillIndex ] );
+	}
+	mapMatrix->VectorsFromMap( BIN_NUMBER );
+	double mapSeconds = SecondsSince( start );
+	cout << "Map:     " << mapSeconds << " s, " << ( double )FILL_NUMBER / mapSeconds / 1E6 << " million fills per second" << endl;
+
+	//The triplets
+	start = clock();
+	TripletMatrix * tripletMatrix = new TripletMatrix();
+	for ( unsigned int fillIndex = 0; fillIndex < FILL_NUMBER; fillIndex++ )
+	{
+		tripletMatrix->Fill( firstIndices[ fillIndex ], secondIndices[ fillIndex ], values[ fillIndex ] );
+	}
+	tripletMatrix->Finalise( BIN_NUMBER );
+	double tripletSeconds = SecondsSince( start );
+	cout << "Triplet: " << tripletSeconds << " s, " << ( double )FILL_NUMBER / tripletSeconds / 1E6 << " million fills per second" << endl;
+
+	//The finalised matrices must hold the same values
+	unsigned int mismatches = 0;
+	for ( unsigned int firstIndex = 0; firstIndex < BIN_NUMBER; firstIndex++ )
+	{
+		unsigned int entryNumber = tripletMatrix->GetEntryNumberWithFirstIndex( firstIndex );
+		const double * tripletValues = tripletMatrix->GetEntriesWithFirstIndex( firstIndex );
+		const unsigned int * tripletIndices = tripletMatrix->GetIndicesWithFirstIndex( firstIndex );
+		if ( entryNumber != mapMatrix->matrixValues[ firstIndex ].size() )
+		{
+			mismatches++;
+			continue;
+		}
+		for ( unsigned int entryIndex = 0; entryIndex < entryNumber; entryIndex++ )
+		{
+			if ( tripletIndices[ entryIndex ] != mapMatrix->secondIndices[ firstIndex ][ entryIndex ] || tripletValues[ entryIndex ] != mapMatrix->matrixValues[ firstIndex ][ entryIndex ] )
+			{
+				mismatches++;
+			}
+		}
+	}
+
+	delete mapMatrix;
+	delete tripletMatrix;
+
+	if ( mismatches > 0 )
+	{
+		cerr << "Finalised matrices differ in " << mismatches << " places" << endl;
+		return 1;
+	}
+	cout << "Finalised matrices are identical" << endl;
+	return 0;
+}
@@ -0,0 +1,28 @@
+/**
+  @class BatchIndices
+
+  Bin lookups for a whole array of values at once, for filling histograms from columns of events
+  Uses AVX2 or NEON where the processor has it, chosen when the program runs, and plain loops otherwise
+ */
+
+#ifndef BATCH_INDICES_H
+#define BATCH_INDICES_H
+
+class BatchIndices
+{
+	public:
+		//Add the uniform-width bin of each value, times the multiplier, to the indices
+		//Gives the same bins as UniformIndices: 0 for underflow, N + 1 for overflow (or not a number)
+		static void AddUniformBins( const double * Values, unsigned int ValueNumber, double Minimum, double Maximum, double BinWidth,
+				unsigned int BinNumber, unsigned int Multiplier, unsigned int * Indices );
+
+		//Add the custom-width bin of each value, times the multiplier, to the indices
+		//Gives the same bins as BinEdgeSearch, but only does as many values as fit the vector instructions - returns how many were done
+		static unsigned int AddCustomBins( const double * Values, unsigned int ValueNumber, const double * Edges, unsigned int BinNumber,
+				unsigned int Multiplier, unsigned int * Indices );
+
+		//Check whether the AVX2 versions are in use
+		static bool UseAVX2();
+};
+
+#endif
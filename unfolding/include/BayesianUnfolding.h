@@ -40,17 +40,26 @@ class BayesianUnfolding : public ICorrection
 		//value
 		//NB: These values must both come from the SAME
 		//Monte Carlo event, or the whole process is meaningless
-		virtual void StoreTruthRecoPair( vector< double > Truth, vector<double> Reco, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true );
+		virtual void StoreTruthRecoPair( const double * Truth, const double * Reco, unsigned int ValueNumber, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true );
 
 		//If an MC event is not reconstructed at all, use this
 		//method to store the truth value alone
-		virtual void StoreUnreconstructedTruth( vector< double > Truth, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreUnreconstructedTruth( const double * Truth, unsigned int ValueNumber, double Weight = 1.0, bool UseInPrior = true );
 
 		//If there is a fake reconstructed event with no
-		virtual void StoreReconstructedFake( vector< double > Reco, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreReconstructedFake( const double * Reco, unsigned int ValueNumber, double Weight = 1.0, bool UseInPrior = true );
 
 		//Store a value from the uncorrected data distribution
-		virtual void StoreDataValue( vector< double > Data, double Weight = 1.0 );
+		virtual void StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight = 1.0 );
+
+		//The same, for events whose bin indices have already been found
+		virtual void StoreTruthRecoPairBins( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true );
+		virtual void StoreUnreconstructedTruthBin( unsigned int TruthIndex, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreReconstructedFakeBin( unsigned int RecoIndex, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreDataBin( unsigned int DataIndex, double Weight = 1.0 );
+
+		//Add the MC events stored in another instance to this one
+		virtual void MergeEvents( ICorrection * Other );
 
 		//Once all data is stored, run the unfolding
 		//You can specify when the iterations should end,
@@ -60,6 +69,10 @@ class BayesianUnfolding : public ICorrection
 		//fluctuations when convergence is slow
 		virtual void Correct( unsigned int MostIterations, unsigned int ErrorMode = 0, bool WithSmoothing = false );
 
+		//Unfold the data of all the clones together, without the error calculation
+		//Each iteration is one product of the smearing matrix with the dense matrix of all distributions
+		virtual void CorrectClones( vector< ICorrection* > Clones, unsigned int MostIterations, bool WithSmoothing = false );
+
 		//Perform a closure test
 		//Unfold the MC reco distribution with the corresponding truth information as a prior
 		//It should give the truth information back exactly...
@@ -70,7 +83,7 @@ class BayesianUnfolding : public ICorrection
 		//Use MC truth A as a prior to unfold MC reco B
 		//Iterations cease when result is sufficiently close to MC truth B (passed as argument)
 		//Returns the number of iterations required
-		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false );
+		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false, ostream & Output = cout );
 
 		//Retrieve a TH1F* containing the corrected data distribution
 		virtual TH1F * GetCorrectedHistogram( string Name, string Title, bool Normalise = false );
@@ -96,11 +109,17 @@ class BayesianUnfolding : public ICorrection
 		//Make another instance of the ICorrection which shares the smearing matrix
                 virtual BayesianUnfolding * CloneShareSmearingMatrix();
 
+		//Make another instance which uses the smearing matrix of this one, but has its own prior distributions
+		virtual BayesianUnfolding * ClonePriorShareSmearingMatrix( string Name, unsigned int UniqueID );
+
 	private:
 		//For use with Clone
 		BayesianUnfolding( IIndexCalculator * DistributionIndices, string Name, unsigned int UniqueID,
 				Comparison * SharedComparison, Distribution * SharedTruthDistribution, SmearingMatrix * SharedSmearingMatrix );
 
+		//For use with ClonePriorShareSmearingMatrix
+		BayesianUnfolding( IIndexCalculator * DistributionIndices, string Name, unsigned int UniqueID, SmearingMatrix * SharedSmearingMatrix );
+
 		Comparison * distributionComparison;
 		unsigned int uniqueID;
 		string name;
@@ -109,7 +128,7 @@ class BayesianUnfolding : public ICorrection
 		Distribution *dataDistribution, *unfoldedDistribution, *truthDistribution, *reconstructedDistribution;
 		CovarianceMatrix * fullErrors;
 		SmearingMatrix * inputSmearing;
-		bool isClone;
+		bool isClone, sharedSmearing;
 };
 
 #endif
@@ -0,0 +1,44 @@
+/**
+  @class BinEdgeSearch
+
+  Finds the bin containing a value, for bins with custom widths
+  The edges are kept in a flat array, and a uniform grid over the range narrows each search down to a few edges
+ */
+
+#ifndef BIN_EDGE_SEARCH_H
+#define BIN_EDGE_SEARCH_H
+
+#include <vector>
+
+using namespace std;
+
+class BinEdgeSearch
+{
+	public:
+		BinEdgeSearch();
+		BinEdgeSearch( const vector< double > & LowEdges, bool UseGrid = true );
+		~BinEdgeSearch();
+
+		//Return the bin for a value: 0 for underflow, 1 to N for the bins, N + 1 for overflow
+		//A value on an edge goes in the bin above, except for the lowest edge which is underflow
+		unsigned int FindBin( double Value ) const;
+
+		//Add the bin of each value, times the multiplier, to the indices
+		void AddBins( const double * Values, unsigned int ValueNumber, unsigned int Multiplier, unsigned int * Indices ) const;
+
+	private:
+		//Count the inner edges at or below a value, from the given range of edges
+		unsigned int CountEdges( double Value, unsigned int FirstEdge, unsigned int EdgeNumber ) const;
+
+		//All edges, including the high edge of the last bin
+		vector< double > edges;
+		unsigned int binNumber;
+
+		//For each grid cell, the range of inner edges that could be in it
+		bool useGrid;
+		double gridLow, gridScale;
+		unsigned int cellNumber;
+		vector< unsigned int > cellFirstEdges, cellEdgeNumbers;
+};
+
+#endif
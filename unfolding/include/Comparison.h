@@ -2,6 +2,7 @@
   @class Comparison
 
   An extremely simple class to return the Chi2 and Kolmogorov-Smirnoff comparison values betweeen two histograms
+  The statistics are worked out straight from the bin contents, giving the same values as the Root histogram tests
   The histogram naming scheme prevents the tedious complaints from Root about making multiple objects with the same name
 
   @author Benjamin M Wynne bwynne@cern.ch
@@ -28,6 +29,17 @@ class Comparison
 		void CompareDistributions( Distribution * FirstInput, Distribution * SecondInput, double & ChiSquared, double & Kolmogorov, bool IsClosureTest = false );
 		void DelineariseAndCompare( Distribution * FirstInput, Distribution * SecondInput, double & ChiSquared, double & Kolmogorov, IIndexCalculator * InputIndices );
 
+		//The comparison statistics for two arrays of bin contents - these don't change anything, so they're safe to use from many threads
+		//The contents are rounded to float precision first, as they would be in a TH1F
+		//Same as TH1::Chi2Test with option "UUCHI2": the chi squared for two unweighted histograms
+		static double UnweightedChiSquared( const double * FirstValues, const double * SecondValues, unsigned int BinNumber );
+
+		//Same as TH1::KolmogorovTest with no options, for histograms without Sumw2 (so each bin error is the square root of its content)
+		static double KolmogorovProbability( const double * FirstValues, const double * SecondValues, unsigned int BinNumber );
+
+		//The probability of exceeding a Kolmogorov test statistic - the same approximation as TMath::KolmogorovProb
+		static double KolmogorovDistribution( double Z );
+
 	private:
 		TH1F * MakeProfile( TH1F * LinearisedDistribution, IIndexCalculator * InputIndices );
 
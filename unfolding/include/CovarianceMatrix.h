@@ -27,14 +27,36 @@ class CovarianceMatrix : public SparseMatrix
 		CovarianceMatrix( UnfoldingMatrix * InputUnfolding, SmearingMatrix * InputSmearing, Distribution * DataDistribution, double CorrectedSum, bool JustVariance = false );
 		~CovarianceMatrix();
 
+		//Set the number of threads used for the full covariance calculation (0 = one for each processor core)
+		static void SetThreadNumber( unsigned int ThreadNumber );
+
 	private:
 		void CovarianceCalculation( unsigned int I, unsigned int J, unsigned int K, unsigned int L, double unfoldingProductTimesDataI, double dataI, double dataJ );
 
+		//The full covariance matrix written as sparse matrix products, rather than summing over every pair of unfolding matrix entries
+		void FullCovariance( Distribution * DataDistribution );
+
+		//Share the rows of a calculation between threads: each row is calculated by RowMethod, using a dense row of scratch space
+		void ParallelRows( void ( CovarianceMatrix::*RowMethod )( unsigned int, vector< double > & ) );
+		void RowWorker( void ( CovarianceMatrix::*RowMethod )( unsigned int, vector< double > & ), unsigned int FirstRow, unsigned int RowStep );
+		static unsigned int rowThreadNumber;
+
+		//The rows of the full calculation
+		void ResponseDerivativeRow( unsigned int K, vector< double > & RowValues );
+		void CovarianceRow( unsigned int K, vector< double > & RowValues );
+
 		time_t timeNow;
 		double correctedSum;
 		SmearingMatrix * inputSmearing;
 		UnfoldingMatrix * inputUnfolding;
 		SmearingCovariance * rsuMatrix;
+
+		//Intermediate products for the full calculation, stored by row
+		unsigned int binNumber;
+		vector< bool > hasData;
+		vector< double > dataValues, dataWeights, unfoldedSums, truthTotals, diagonalTerms, centralTerms;
+		vector< vector< pair< unsigned int, double > > > unfoldedData, unfoldedDataByEffect, crossTerms, crossTermsByEffect, weightedResponseByEffect;
+		vector< vector< pair< unsigned int, double > > > responseDerivatives, responseDerivativesByCause, covarianceRows;
 };
 
 #endif
@@ -0,0 +1,46 @@
+/**
+  @class CustomEdges
+
+  The bins in one dimension, with custom widths - for use with FixedIndices
+  Puts values in the same bins as CustomIndices
+ */
+
+#ifndef CUSTOM_EDGES_H
+#define CUSTOM_EDGES_H
+
+#include "BinEdgeSearch.h"
+#include <vector>
+
+using namespace std;
+
+class CustomEdges
+{
+	public:
+		CustomEdges();
+		CustomEdges( const vector< double > & LowEdges );
+		~CustomEdges();
+
+		//Return the bin for a value: 0 for underflow, 1 to N for the bins, N + 1 for overflow (or not a number)
+		inline unsigned int FindBin( double Value ) const
+		{
+			return search.FindBin( Value );
+		}
+
+		//Add the bin of each value, times the multiplier, to the indices
+		void AddBins( const double * Values, unsigned int ValueNumber, unsigned int Multiplier, unsigned int * Indices ) const;
+
+		//The number of bins, not including under and overflow
+		unsigned int BinNumber() const;
+
+		//The low edge of each bin, and the high edge of the last
+		const vector< double > & Edges() const;
+
+		//A central value for a bin with no events in it
+		double EmptyBinCentre( unsigned int BinIndex ) const;
+
+	private:
+		vector< double > edges;
+		BinEdgeSearch search;
+};
+
+#endif
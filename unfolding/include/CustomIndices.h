@@ -12,8 +12,8 @@
 #define CUSTOM_INDICES_H
 
 #include "IIndexCalculator.h"
+#include "BinEdgeSearch.h"
 #include <vector>
-#include <map>
 
 using namespace std;
 
@@ -29,6 +29,10 @@ class CustomIndices : public IIndexCalculator
 
 		//Return the bin index corresponding to a particular value (or set of values)
 		virtual unsigned int GetIndex( const vector< double > & InputValues );
+		virtual unsigned int GetIndex( const double * InputValues, unsigned int ValueNumber );
+
+		//Return the bin index for each of a set of events, given an array of values for each dimension
+		virtual void GetIndices( const double * const * InputColumns, unsigned int ValueNumber, unsigned int EventNumber, unsigned int * OutputIndices );
 
 		//Return the index in each dimension
 		virtual vector< unsigned int > GetNDimensionalIndex( const vector< double > & InputValues );
@@ -45,16 +49,16 @@ class CustomIndices : public IIndexCalculator
 
 		//Input data to calculate the central values
                 virtual void StoreDataValue( const vector< double > & Data, double Weight = 1.0 );
+		virtual void StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight = 1.0 );
 
 	private:
-		unsigned int GetOneDimensionIndex( double Value, unsigned int Dimension );
+		unsigned int GetOneDimensionIndex( double Value, unsigned int Dimension ) const;
 
 		vector< vector< double > > binLowEdges;
 		vector< vector< double >* > binLowEdgePointers;
 		vector< unsigned int > numberOfBins;
 		unsigned int numberOfDimensions;
-		vector< map< double, unsigned int > > binHighEdgeMaps;
-		map< double, unsigned int >::iterator searchIterator;
+		vector< BinEdgeSearch > binEdgeSearches;
 		vector< vector< double > > binValueSums, binValueNormalisations;
 
 };
@@ -32,22 +32,37 @@ class Distribution
 		Distribution( Distribution * DataDistribution, const vector< double > & BinWeights );
 		~Distribution();
 
-		void StoreEvent( vector< double > Value, double Weight = 1.0 );
+		void StoreEvent( const vector< double > & Value, double Weight = 1.0 );
+		void StoreEventInBin( unsigned int BinIndex, double Weight = 1.0 );
 		void StoreBadEvent( double Weight = 1.0 );
+		void AddEvents( const Distribution * Other );
 		void SetBadBin( double Ratio );
 
 		double GetBinNumber( unsigned int BinIndex );
 		double GetBinProbability( unsigned int BinIndex );
 		double Integral();
 
+		//The contents of every bin, including the under and overflow bins and the bad bin at the end
+		const vector< double > & GetBinValues() const;
+
 		TH1F * MakeRootHistogram( string Name, string Title, bool MakeNormalised = false, bool WithBadBin = false );
 
-		//Try and account for statistical fluctuations with a moving-average smearing
-		void Smooth( unsigned int SideBinNumber = 1 );
+		//Overwrite this distribution with one Bayesian unfolding iteration of the data, using the given prior
+		//Gives the same result as applying an UnfoldingMatrix made from the prior, without making the matrix
+		//EffectWorkspace is just scratch space, so that nothing is allocated when it is reused
+		void Unfold( Distribution * DataDistribution, SmearingMatrix * Smearing, Distribution * PriorDistribution, vector< double > & EffectWorkspace );
+
+		//As above, but for many distributions at once: each result is an unfolding of the corresponding data and prior
+		//The distributions are packed into the columns of dense matrices, so the smearing matrix is only read once
+		static void UnfoldBatch( const vector< Distribution* > & Results, const vector< Distribution* > & DataDistributions, SmearingMatrix * Smearing,
+				const vector< Distribution* > & PriorDistributions, vector< double > & Workspace );
+
+		//Try and account for statistical fluctuations with a moving-average smearing along one dimension
+		void Smooth( unsigned int SideBinNumber = 1, unsigned int DimensionIndex = 0 );
 
 	protected:
 		IIndexCalculator * indexCalculator;
-		vector< double > binValues;
+		vector< double > binValues, smoothedValues;
 		double integral;
 };
 
@@ -0,0 +1,276 @@
+/**
+  @class FixedIndices
+
+  A class for putting an event with a given value in the correct histogram bin, when the number of dimensions is known at compile time
+  EdgePolicy gives the bins in each dimension: UniformEdges or CustomEdges
+
+  The per-event methods (Index, SplitIndex, CentralValues, StoreValue) are not virtual and use fixed-size arrays, so they
+  can be inlined into the caller without allocating anything. The IIndexCalculator methods wrap them for everything else
+ */
+
+#ifndef FIXED_INDICES_H
+#define FIXED_INDICES_H
+
+#include "IIndexCalculator.h"
+#include "UniformEdges.h"
+#include "CustomEdges.h"
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+template< unsigned int N, class EdgePolicy >
+class FixedIndices : public IIndexCalculator
+{
+	public:
+		FixedIndices( const array< EdgePolicy, N > & Axes );
+		virtual ~FixedIndices();
+
+		//Return the bin index for the values in each dimension
+		inline unsigned int Index( const double * Values ) const
+		{
+			unsigned int totalIndex = 0;
+			for ( unsigned int dimensionIndex = 0; dimensionIndex < N; dimensionIndex++ )
+			{
+				totalIndex += axes[ dimensionIndex ].FindBin( Values[ dimensionIndex ] ) * binMultipliers[ dimensionIndex ];
+			}
+			return totalIndex;
+		}
+
+		//Return the index in each dimension
+		inline array< unsigned int, N > SplitIndex( unsigned int InputIndex ) const
+		{
+			array< unsigned int, N > splitIndex;
+			for ( unsigned int dimensionIndex = 0; dimensionIndex < N; dimensionIndex++ )
+			{
+				splitIndex[ dimensionIndex ] = InputIndex % ( axes[ dimensionIndex ].BinNumber() + 2 );
+				InputIndex /= ( axes[ dimensionIndex ].BinNumber() + 2 );
+			}
+			return splitIndex;
+		}
+
+		//Return the bin central value in each dimension - the mean of the values stored in the bin, if there are any
+		inline array< double, N > CentralValues( const array< unsigned int, N > & InputIndices ) const
+		{
+			array< double, N > centralValues;
+			for ( unsigned int dimensionIndex = 0; dimensionIndex < N; dimensionIndex++ )
+			{
+				unsigned int inputIndex = InputIndices[ dimensionIndex ];
+				if ( inputIndex > axes[ dimensionIndex ].BinNumber() + 1 )
+				{
+					cerr << "ERROR: Nonsensical index provided (" << inputIndex << ") when should be in range 0 to " << axes[ dimensionIndex ].BinNumber() + 1 << endl;
+					exit(1);
+				}
+
+				double binTotal = binValueSums[ dimensionIndex ][ inputIndex ];
+				if ( binTotal == 0.0 )
+				{
+					centralValues[ dimensionIndex ] = axes[ dimensionIndex ].EmptyBinCentre( inputIndex );
+				}
+				else
+				{
+					centralValues[ dimensionIndex ] = binTotal / binValueNormalisations[ dimensionIndex ][ inputIndex ];
+				}
+			}
+			return centralValues;
+		}
+
+		//Input data to calculate the central values
+		inline void StoreValue( const double * Data, double Weight = 1.0 )
+		{
+			for ( unsigned int dimensionIndex = 0; dimensionIndex < N; dimensionIndex++ )
+			{
+				unsigned int binIndex = axes[ dimensionIndex ].FindBin( Data[ dimensionIndex ] );
+				binValueSums[ dimensionIndex ][ binIndex ] += Data[ dimensionIndex ] * Weight;
+				binValueNormalisations[ dimensionIndex ][ binIndex ] += Weight;
+			}
+		}
+
+		//Return a copy of the object, minus any stored data
+		virtual IIndexCalculator * Clone();
+
+		//Return the bin index corresponding to a particular value (or set of values)
+		virtual unsigned int GetIndex( const vector< double > & InputValues );
+		virtual unsigned int GetIndex( const double * InputValues, unsigned int ValueNumber );
+
+		//Return the bin index for each of a set of events, given an array of values for each dimension
+		virtual void GetIndices( const double * const * InputColumns, unsigned int ValueNumber, unsigned int EventNumber, unsigned int * OutputIndices );
+
+		//Return the index in each dimension
+		virtual vector< unsigned int > GetNDimensionalIndex( const vector< double > & InputValues );
+		virtual vector< unsigned int > GetNDimensionalIndex( unsigned int InputIndex );
+
+		//Return the bin central value in each dimension
+		virtual vector< double > GetCentralValues( const vector< unsigned int > & InputIndices );
+		virtual vector< double > GetCentralValues( unsigned int InputIndex );
+
+		//Definitions for the indices
+		virtual unsigned int GetBinNumber();
+		virtual unsigned int GetBinNumber( unsigned int DimensionIndex );
+		virtual double * GetBinLowEdgesForRoot( unsigned int DimensionIndex );
+
+		//Input data to calculate the central values
+		virtual void StoreDataValue( const vector< double > & Data, double Weight = 1.0 );
+		virtual void StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight = 1.0 );
+
+	private:
+		void CheckDimensions( unsigned int ValueNumber );
+
+		array< EdgePolicy, N > axes;
+		array< unsigned int, N > binMultipliers;
+		unsigned int totalBinNumber;
+		array< vector< double >, N > binValueSums, binValueNormalisations, binLowEdges;
+};
+
+//Constructor taking the bins in each dimension
+template< unsigned int N, class EdgePolicy >
+FixedIndices< N, EdgePolicy >::FixedIndices( const array< EdgePolicy, N > & Axes )
+{
+	axes = Axes;
+
+	//The step in the overall index for one bin in each dimension
+	totalBinNumber = 1;
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < N; dimensionIndex++ )
+	{
+		binMultipliers[ dimensionIndex ] = totalBinNumber;
+		totalBinNumber *= ( axes[ dimensionIndex ].BinNumber() + 2 );
+
+		//Make the vectors to hold the bin central values (include under and overflow)
+		binValueSums[ dimensionIndex ] = vector< double >( axes[ dimensionIndex ].BinNumber() + 2, 0.0 );
+		binValueNormalisations[ dimensionIndex ] = vector< double >( axes[ dimensionIndex ].BinNumber() + 2, 0.0 );
+		binLowEdges[ dimensionIndex ] = axes[ dimensionIndex ].Edges();
+	}
+}
+
+//Destructor
+template< unsigned int N, class EdgePolicy >
+FixedIndices< N, EdgePolicy >::~FixedIndices()
+{
+}
+
+//Return a copy of the object, minus any stored data
+template< unsigned int N, class EdgePolicy >
+IIndexCalculator * FixedIndices< N, EdgePolicy >::Clone()
+{
+	return new FixedIndices< N, EdgePolicy >( axes );
+}
+
+//Return the bin number / index corresponding to a given value
+template< unsigned int N, class EdgePolicy >
+unsigned int FixedIndices< N, EdgePolicy >::GetIndex( const vector< double > & InputValues )
+{
+	CheckDimensions( InputValues.size() );
+	return Index( &InputValues[0] );
+}
+template< unsigned int N, class EdgePolicy >
+unsigned int FixedIndices< N, EdgePolicy >::GetIndex( const double * InputValues, unsigned int ValueNumber )
+{
+	CheckDimensions( ValueNumber );
+	return Index( InputValues );
+}
+
+//Return the bin index for each of a set of events, given an array of values for each dimension
+template< unsigned int N, class EdgePolicy >
+void FixedIndices< N, EdgePolicy >::GetIndices( const double * const * InputColumns, unsigned int ValueNumber, unsigned int EventNumber, unsigned int * OutputIndices )
+{
+	CheckDimensions( ValueNumber );
+	fill( OutputIndices, OutputIndices + EventNumber, 0 );
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < N; dimensionIndex++ )
+	{
+		axes[ dimensionIndex ].AddBins( InputColumns[ dimensionIndex ], EventNumber, binMultipliers[ dimensionIndex ], OutputIndices );
+	}
+}
+
+//Return the bin number in each dimension
+template< unsigned int N, class EdgePolicy >
+vector< unsigned int > FixedIndices< N, EdgePolicy >::GetNDimensionalIndex( const vector< double > & InputValues )
+{
+	CheckDimensions( InputValues.size() );
+	vector< unsigned int > overallIndex( N, 0 );
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < N; dimensionIndex++ )
+	{
+		overallIndex[ dimensionIndex ] = axes[ dimensionIndex ].FindBin( InputValues[ dimensionIndex ] );
+	}
+	return overallIndex;
+}
+template< unsigned int N, class EdgePolicy >
+vector< unsigned int > FixedIndices< N, EdgePolicy >::GetNDimensionalIndex( unsigned int InputIndex )
+{
+	array< unsigned int, N > splitIndex = SplitIndex( InputIndex );
+	return vector< unsigned int >( splitIndex.begin(), splitIndex.end() );
+}
+
+//Return the central value of a given bin
+template< unsigned int N, class EdgePolicy >
+vector< double > FixedIndices< N, EdgePolicy >::GetCentralValues( const vector< unsigned int > & InputIndices )
+{
+	CheckDimensions( InputIndices.size() );
+	array< unsigned int, N > splitIndex;
+	copy( InputIndices.begin(), InputIndices.end(), splitIndex.begin() );
+	array< double, N > centralValues = CentralValues( splitIndex );
+	return vector< double >( centralValues.begin(), centralValues.end() );
+}
+template< unsigned int N, class EdgePolicy >
+vector< double > FixedIndices< N, EdgePolicy >::GetCentralValues( unsigned int InputIndex )
+{
+	array< double, N > centralValues = CentralValues( SplitIndex( InputIndex ) );
+	return vector< double >( centralValues.begin(), centralValues.end() );
+}
+
+//Return the total bin number
+template< unsigned int N, class EdgePolicy >
+unsigned int FixedIndices< N, EdgePolicy >::GetBinNumber()
+{
+	return totalBinNumber;
+}
+
+//Return the number of bins in a given dimension
+template< unsigned int N, class EdgePolicy >
+unsigned int FixedIndices< N, EdgePolicy >::GetBinNumber( unsigned int DimensionIndex )
+{
+	if ( DimensionIndex >= N )
+	{
+		cerr << "Specified invalid dimension index (" << DimensionIndex << ") - not in range 0 to " << N - 1 << endl;
+		exit(1);
+	}
+	else
+	{
+		return axes[ DimensionIndex ].BinNumber() + 2;
+	}
+}
+
+template< unsigned int N, class EdgePolicy >
+double * FixedIndices< N, EdgePolicy >::GetBinLowEdgesForRoot( unsigned int DimensionIndex )
+{
+	return &binLowEdges[ DimensionIndex ][0];
+}
+
+//Input the data to calculate the central values
+template< unsigned int N, class EdgePolicy >
+void FixedIndices< N, EdgePolicy >::StoreDataValue( const vector< double > & Data, double Weight )
+{
+	CheckDimensions( Data.size() );
+	StoreValue( &Data[0], Weight );
+}
+template< unsigned int N, class EdgePolicy >
+void FixedIndices< N, EdgePolicy >::StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight )
+{
+	CheckDimensions( ValueNumber );
+	StoreValue( Data, Weight );
+}
+
+//Stupidity check for the virtual methods - the others can't be given the wrong number of values
+template< unsigned int N, class EdgePolicy >
+void FixedIndices< N, EdgePolicy >::CheckDimensions( unsigned int ValueNumber )
+{
+	if ( ValueNumber != N )
+	{
+		cerr << "Using a " << ValueNumber << "D index lookup for a " << N << "D unfolding" << endl;
+		exit(1);
+	}
+}
+
+#endif
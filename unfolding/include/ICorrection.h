@@ -14,6 +14,7 @@
 #include "Distribution.h"
 #include <vector>
 #include <string>
+#include <iostream>
 #include "TH1F.h"
 #include "TH2F.h"
 
@@ -27,23 +28,37 @@ class ICorrection
 		{
 		}
 
+		//Event values are passed as arrays of ValueNumber entries, one for each dimension,
+		//so that storing an event does not allocate any memory
+
 		//Use this method to supply a value from the truth
 		//distribution, and the corresponding reconstructed
 		//value
 		//NB: These values must both come from the SAME
 		//Monte Carlo event, or the whole process is meaningless
-		virtual void StoreTruthRecoPair( vector< double > Truth, vector<double> Reco, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true ) = 0;
+		virtual void StoreTruthRecoPair( const double * Truth, const double * Reco, unsigned int ValueNumber, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true ) = 0;
 
 		//If an MC event is not reconstructed at all, use this
 		//method to store the truth value alone
-		virtual void StoreUnreconstructedTruth( vector< double > Truth, double Weight = 1.0, bool UseInPrior = true ) = 0;
+		virtual void StoreUnreconstructedTruth( const double * Truth, unsigned int ValueNumber, double Weight = 1.0, bool UseInPrior = true ) = 0;
 
 		//If there is a fake reconstructed event with no
 		//corresponding truth, use this method
-		virtual void StoreReconstructedFake( vector< double > Reco, double Weight = 1.0, bool UseInPrior = true ) = 0;
+		virtual void StoreReconstructedFake( const double * Reco, unsigned int ValueNumber, double Weight = 1.0, bool UseInPrior = true ) = 0;
 
 		//Store a value from the uncorrected data distribution
-		virtual void StoreDataValue( vector< double > Data, double Weight = 1.0 ) = 0;
+		virtual void StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight = 1.0 ) = 0;
+
+		//The same, for events whose bin indices have already been found with the index calculator the correction was made with
+		//(or another with the same binning) - so callers that know the binning can skip the virtual index lookup
+		virtual void StoreTruthRecoPairBins( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true ) = 0;
+		virtual void StoreUnreconstructedTruthBin( unsigned int TruthIndex, double Weight = 1.0, bool UseInPrior = true ) = 0;
+		virtual void StoreReconstructedFakeBin( unsigned int RecoIndex, double Weight = 1.0, bool UseInPrior = true ) = 0;
+		virtual void StoreDataBin( unsigned int DataIndex, double Weight = 1.0 ) = 0;
+
+		//Add the MC events stored in another instance to this one
+		//The other instance must be the same type of correction with the same binning, and neither can be corrected yet
+		virtual void MergeEvents( ICorrection * Other ) = 0;
 
 		//Once all data is stored, run the correction
 		//You can specify when the iterations should end,
@@ -53,6 +68,16 @@ class ICorrection
 		//fluctuations when convergence is slow
 		virtual void Correct( unsigned int MostIterations, unsigned int ErrorMode = 0, bool WithSmoothing = false ) = 0;
 
+		//Run the correction for clones made with CloneShareSmearingMatrix, without the error calculation
+		//Corrections that can process the clones together should override this
+		virtual void CorrectClones( vector< ICorrection* > Clones, unsigned int MostIterations, bool WithSmoothing = false )
+		{
+			for ( unsigned int cloneIndex = 0; cloneIndex < Clones.size(); cloneIndex++ )
+			{
+				Clones[ cloneIndex ]->Correct( MostIterations, 0, WithSmoothing );
+			}
+		}
+
 		//Perform a closure test
 		//Unfold the MC reco distribution with the corresponding truth information as a prior
 		//It should give the truth information back exactly...
@@ -63,7 +88,9 @@ class ICorrection
 		//Use MC truth A as a prior to unfold MC reco B
 		//Iterations cease when result is sufficiently close to MC truth B (passed as argument)
 		//Returns the number of iterations required
-		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false ) = 0;
+		//Only reads the prior, the smearing matrix (which must be finalised) and this instance's MC distributions,
+		//so cross-checks can run in parallel - the progress is written to Output, to keep it separate for each one
+		virtual unsigned int MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false, ostream & Output = cout ) = 0;
 
 		//Retrieve a TH1F* containing the corrected data distribution
 		virtual TH1F * GetCorrectedHistogram( string Name, string Title, bool Normalise = false ) = 0;
@@ -88,6 +115,14 @@ class ICorrection
 
 		//Make another instance of the ICorrection which shares the smearing matrix
 		virtual ICorrection * CloneShareSmearingMatrix() = 0;
+
+		//Make another instance of the ICorrection which uses the smearing matrix of this one, but has its own prior distributions
+		//Only the original fills the smearing matrix, so the new instance just needs the MC events for its prior
+		//Returns NULL if the correction cannot share its smearing matrix like this
+		virtual ICorrection * ClonePriorShareSmearingMatrix( string Name, unsigned int UniqueID )
+		{
+			return NULL;
+		}
 };
 
 #endif
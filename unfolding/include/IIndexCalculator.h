@@ -27,7 +27,13 @@ class IIndexCalculator
 		virtual IIndexCalculator * Clone() = 0;
 
 		//Return the bin index corresponding to a particular value (or set of values)
+		//In each dimension a value at or below the lowest edge goes in the underflow bin, and a value above the
+		//highest edge goes in the overflow bin - as does a value that is not a number, whatever the binning
 		virtual unsigned int GetIndex( const vector< double > & InputValues ) = 0;
+		virtual unsigned int GetIndex( const double * InputValues, unsigned int ValueNumber ) = 0;
+
+		//Return the bin index for each of a set of events, given an array of values for each dimension
+		virtual void GetIndices( const double * const * InputColumns, unsigned int ValueNumber, unsigned int EventNumber, unsigned int * OutputIndices ) = 0;
 
 		//Return the index in each dimension
 		virtual vector< unsigned int > GetNDimensionalIndex( const vector< double > & InputValues ) = 0;
@@ -44,6 +50,7 @@ class IIndexCalculator
 
 		//Input data to calculate the central values
                 virtual void StoreDataValue( const vector< double > & Data, double Weight = 1.0 ) = 0;
+		virtual void StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight = 1.0 ) = 0;
 };
 
 #endif
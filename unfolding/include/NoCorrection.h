@@ -33,21 +33,30 @@ class NoCorrection : public ICorrection
 		//value
 		//NB: These values must both come from the SAME
 		//Monte Carlo event, or the whole process is meaningless
-		virtual void StoreTruthRecoPair( vector< double > Truth, vector< double > Reco, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true );
+		virtual void StoreTruthRecoPair( const double * Truth, const double * Reco, unsigned int ValueNumber, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true );
 
 
 		//If an MC event is not reconstructed at all, use this
 		//method to store the truth value alone
-		virtual void StoreUnreconstructedTruth( vector< double > Truth, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreUnreconstructedTruth( const double * Truth, unsigned int ValueNumber, double Weight = 1.0, bool UseInPrior = true );
 
 
 		//If there is a fake reconstructed event with no
 		//corresponding truth, use this method
-		virtual void StoreReconstructedFake( vector< double > Reco, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreReconstructedFake( const double * Reco, unsigned int ValueNumber, double Weight = 1.0, bool UseInPrior = true );
 
 
 		//Store a value from the distribution to be smeared
-		virtual void StoreDataValue( vector< double > ToFold, double Weight = 1.0 );
+		virtual void StoreDataValue( const double * ToFold, unsigned int ValueNumber, double Weight = 1.0 );
+
+		//The same, for events whose bin indices have already been found
+		virtual void StoreTruthRecoPairBins( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight = 1.0, double RecoWeight = 1.0, bool UseInPrior = true );
+		virtual void StoreUnreconstructedTruthBin( unsigned int TruthIndex, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreReconstructedFakeBin( unsigned int RecoIndex, double Weight = 1.0, bool UseInPrior = true );
+		virtual void StoreDataBin( unsigned int DataIndex, double Weight = 1.0 );
+
+		//Add the MC events stored in another instance to this one
+		virtual void MergeEvents( ICorrection * Other );
 
 		//Once all data is stored, run the correction
 		//The arguments are dummies in this case - folding is a simple process
@@ -61,7 +70,7 @@ class NoCorrection : public ICorrection
 
 		//Perform an unfolding cross-check
 		//Dummy - no iterations
-		virtual unsigned int MonteCarloCrossCheck( Distribution * ReferenceDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false );
+		virtual unsigned int MonteCarloCrossCheck( Distribution * ReferenceDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing = false, ostream & Output = cout );
 
 		//Retrieve a TH1F* containing the unfolded data
 		//distribution, with or without errors
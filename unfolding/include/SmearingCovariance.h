@@ -1,7 +1,6 @@
 #ifndef SMEARING_COVARIANCE_H
 #define SMEARING_COVARIANCE_H
 
-#include <map>
 #include <vector>
 #include "SmearingMatrix.h"
 #include "UnfoldingMatrix.h"
@@ -19,23 +18,28 @@ class SmearingCovariance
 		double ThisContribution( unsigned int I, unsigned int J, unsigned int K, unsigned int L );
 
 	private:
+		//Find the position of smearing matrix entry (U, R) in the smearing matrix storage
+		bool FindSmearingEntry( unsigned int U, unsigned int R, unsigned int & Position );
+
 		SmearingMatrix * smearing;
 		UnfoldingMatrix * unfolding;
+		const unsigned int * smearingRowStarts;
+		const unsigned int * smearingIndices;
+
+		//One entry for each pair (r, s) in each smearing matrix row u, ordered by u then r then s
+		//So the entries for u start at entryStarts[u], and the entries for (u, r) are a contiguous block
+		//The r and s values are stored as positions in the smearing matrix storage
 		vector< double > smearingErrors;
-                vector< unsigned int > rIndices, sIndices, uIndices;
+		vector< unsigned int > entryStarts, uIndices, rPositions, sPositions;
 
-		//For fast lookups
-		vector< vector< unsigned int > > u_to_entries;
-		vector< vector< vector< unsigned int > > > r_to_S_to_entries, r_to_U_to_entries, u_to_S_to_entries;
+		//For fast lookups of the entries with a given (r, s): the distinct s values for each r, and the entries for each (r, s)
+		vector< unsigned int > rsRowStarts, rsSecondIndices, rsEntryStarts, rsEntries;
 
-		//Simple calculation caching
-		vector< double > oneOverEfficiency;
-		map< pair< unsigned int, unsigned int >, double > oneOverSmearing, deltaUR;
+		//Simple calculation caching, stored alongside the smearing matrix entries
+		vector< double > oneOverEfficiency, oneOverSmearing, deltaUR;
 
-		//Caching for the u==k==l case
-		vector< double > sumOverAll_RNotI_SNotJ;
-		vector< vector< double > > sumOverThis_SNotJ, sumOverThis_SIsJ, sumOverThis_RNotI;
-		vector< map< pair< unsigned int, unsigned int >, double > > correctionU_RS;
+		//Caching for the u==k==l case: per-u sums stored alongside the smearing matrix entries, corrections alongside the error entries
+		vector< double > sumOverAll_RNotI_SNotJ, sumOverThis_SNotJ, sumOverThis_SIsJ, sumOverThis_RNotI, correctionU_RS;
 };
 
 #endif
@@ -25,9 +25,13 @@ class SmearingMatrix : public SparseMatrix
 		SmearingMatrix( IIndexCalculator * InputIndices );
 		~SmearingMatrix();
 
-		void StoreTruthRecoPair( vector< double > Truth, vector< double > Reco, double TruthWeight = 1.0, double RecoWeight = 1.0 );
-		void StoreUnreconstructedTruth( vector< double > Truth, double Weight = 1.0 );
-		void StoreReconstructedFake( vector< double > Reco, double Weight = 1.0 );
+		//Populate the matrix with events, using the bin indices of their values
+		void StoreTruthRecoPair( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight = 1.0, double RecoWeight = 1.0 );
+		void StoreUnreconstructedTruth( unsigned int TruthIndex, double Weight = 1.0 );
+		void StoreReconstructedFake( unsigned int RecoIndex, double Weight = 1.0 );
+
+		//Add the events stored in another smearing matrix with the same binning
+		void AddEvents( const SmearingMatrix * Other );
 
 		void Finalise();
 
@@ -0,0 +1,41 @@
+/**
+  @class SmoothingStencil
+
+  The moving average used to smooth a distribution, worked out once for each binning
+  Each bin lists the bins it is made from and their weights, so smoothing is one pass over the bin values
+ */
+
+#ifndef SMOOTHING_STENCIL_H
+#define SMOOTHING_STENCIL_H
+
+#include <vector>
+#include <map>
+#include <mutex>
+#include "IIndexCalculator.h"
+
+using namespace std;
+
+class SmoothingStencil
+{
+	public:
+		//Find the stencil for a binning, making it the first time it's asked for
+		static SmoothingStencil * GetStencil( IIndexCalculator * Indices, unsigned int SideBinNumber, unsigned int DimensionIndex );
+
+		//Smooth the bin values into the result, returning the new integral
+		//Any bins after the stencil (the bad bin) are copied unchanged
+		double Apply( const vector< double > & BinValues, vector< double > & Result );
+
+	private:
+		SmoothingStencil( const vector< unsigned int > & BinNumbers, unsigned int SideBinNumber, unsigned int DimensionIndex );
+
+		//Stencils are shared between all binnings with the same layout
+		static map< vector< unsigned int >, SmoothingStencil* > allStencils;
+		static mutex stencilMutex;
+
+		//Each bin is made from termNumber other bins
+		unsigned int binNumber, termNumber;
+		vector< unsigned int > termIndices;
+		vector< double > termWeights;
+};
+
+#endif
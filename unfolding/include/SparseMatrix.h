@@ -2,6 +2,7 @@
   @class SparseMatrix
 
   A matrix with many zero values, stored as a list of the non-zero entries
+  Entries are accumulated as unsorted (row, column, value) triplets, then sorted and compressed into row-indexed arrays
   Searchable or readable
 
   @author Benjamin M Wynne bwynne@cern.ch
@@ -11,7 +12,6 @@
 #ifndef SPARSE_MATRIX_H
 #define SPARSE_MATRIX_H
 
-#include <map>
 #include <vector>
 #include <string>
 #include "TH2F.h"
@@ -31,34 +31,48 @@ class SparseMatrix
 		double GetElement( unsigned int FirstIndex, unsigned int SecondIndex );
 
 		//Get the next non-zero entry in an iteration through them
+		//The iterators are stored in the matrix, so this is kept only for compatibility: use the row views below instead
 		double GetNextEntry( unsigned int & FirstIndex, unsigned int & SecondIndex, bool UseSecondIterator = false );
 
+		//Read-only views of the finalised matrix, which any number of readers can use at once
+		//The entries with first index i are at positions GetRowStarts()[i] to GetRowStarts()[i+1] - 1
+		const unsigned int * GetRowStarts() const;
+		const unsigned int * GetSecondIndices() const;
+		const double * GetValues() const;
+
 		//Get all non-zero entries of the matrix with the given FirstIndex
-		vector< double > * GetEntriesWithFirstIndex( unsigned int FirstIndex );
-		vector< unsigned int > * GetIndicesWithFirstIndex( unsigned int FirstIndex );
+		unsigned int GetEntryNumberWithFirstIndex( unsigned int FirstIndex ) const;
+		const double * GetEntriesWithFirstIndex( unsigned int FirstIndex ) const;
+		const unsigned int * GetIndicesWithFirstIndex( unsigned int FirstIndex ) const;
 
 		//Return a root histogram containing the matrix
 		TH2F * MakeRootHistogram( string Name, string Title );
 
 		//Get the number of bins along one side of the matrix
-		unsigned int GetBinNumber();
+		unsigned int GetBinNumber() const;
 
 	protected:
 		//Add to the existing entry at these indices, or create a new entry if one does not exist
 		void AddToEntry( unsigned int FirstIndex, unsigned int SecondIndex, double Value );
 
-		//Make the vectors from the map
+		//Add all the entries of another matrix, which must not be finalised either
+		void AddEntries( const SparseMatrix * Other );
+
+		//Sort and merge the stored entries, then compress them into the row-indexed vectors
 		void VectorsFromMap( unsigned int BinNumber );
 
-		map< pair< unsigned int, unsigned int >, double > matrix;
-		map< pair< unsigned int, unsigned int >, double >::iterator nextEntry;
-		map< pair< unsigned int, unsigned int >, double >::iterator otherNextEntry;
-		vector< vector< double > > matrixValues;
-		vector< vector< unsigned int > > secondIndices;
+		//Compressed storage: the entries with first index i are at positions rowStarts[i] to rowStarts[i+1] - 1
+		vector< unsigned int > rowStarts;
+		vector< unsigned int > secondIndices;
+		vector< double > matrixValues;
 
 	private:
+		//Sort the stored entries by index, and add together any with the same indices
+		void MergeEntries();
+
+		vector< pair< pair< unsigned int, unsigned int >, double > > unsortedEntries;
+		unsigned int nextEntry, otherNextEntry, nextEntryRow, otherNextEntryRow, mergeThreshold;
 		bool vectorsMade;
-		unsigned int entryNumber;
 };
 
 #endif
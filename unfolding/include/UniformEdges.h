@@ -0,0 +1,58 @@
+/**
+  @class UniformEdges
+
+  The bins in one dimension, all the same width - for use with FixedIndices
+  Puts values in the same bins as UniformIndices
+ */
+
+#ifndef UNIFORM_EDGES_H
+#define UNIFORM_EDGES_H
+
+#include <vector>
+#include <cmath>
+
+using namespace std;
+
+class UniformEdges
+{
+	public:
+		UniformEdges();
+		UniformEdges( unsigned int BinNumber, double Minimum, double Maximum );
+		~UniformEdges();
+
+		//Return the bin for a value: 0 for underflow, 1 to N for the bins, N + 1 for overflow (or not a number)
+		inline unsigned int FindBin( double Value ) const
+		{
+			if ( Value <= minimum )
+			{
+				return 0;
+			}
+			else if ( !( Value <= maximum ) )
+			{
+				return binNumber + 1;
+			}
+			else
+			{
+				return ceil( ( Value - minimum ) / binWidth );
+			}
+		}
+
+		//Add the bin of each value, times the multiplier, to the indices
+		void AddBins( const double * Values, unsigned int ValueNumber, unsigned int Multiplier, unsigned int * Indices ) const;
+
+		//The number of bins, not including under and overflow
+		unsigned int BinNumber() const;
+
+		//The low edge of each bin, and the high edge of the last
+		const vector< double > & Edges() const;
+
+		//A central value for a bin with no events in it
+		double EmptyBinCentre( unsigned int BinIndex ) const;
+
+	private:
+		unsigned int binNumber;
+		double minimum, maximum, binWidth;
+		vector< double > edges;
+};
+
+#endif
@@ -28,6 +28,10 @@ class UniformIndices : public IIndexCalculator
 
 		//Return the bin index corresponding to a particular value (or set of values)
 		virtual unsigned int GetIndex( const vector< double > & InputValues );
+		virtual unsigned int GetIndex( const double * InputValues, unsigned int ValueNumber );
+
+		//Return the bin index for each of a set of events, given an array of values for each dimension
+		virtual void GetIndices( const double * const * InputColumns, unsigned int ValueNumber, unsigned int EventNumber, unsigned int * OutputIndices );
 
 		//Return the index in each dimension
 		virtual vector< unsigned int > GetNDimensionalIndex( const vector< double > & InputValues );
@@ -44,6 +48,7 @@ class UniformIndices : public IIndexCalculator
 
 		//Input data to calculate the central values
                 virtual void StoreDataValue( const vector< double > & Data, double Weight = 1.0 );
+		virtual void StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight = 1.0 );
 
 	private:
 		unsigned int GetOneDimensionIndex( double Value, unsigned int Dimension );
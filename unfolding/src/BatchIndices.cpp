@@ -0,0 +1,193 @@
+/**
+  @class BatchIndices
+
+  Bin lookups for a whole array of values at once, for filling histograms from columns of events
+  Uses AVX2 or NEON where the processor has it, chosen when the program runs, and plain loops otherwise
+ */
+
+#include "BatchIndices.h"
+#include <cmath>
+
+#if defined( __x86_64__ ) && defined( __GNUC__ )
+#define BATCH_INDICES_AVX2
+#include <immintrin.h>
+#elif defined( __aarch64__ ) && defined( __ARM_NEON )
+#define BATCH_INDICES_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+//The uniform bin for one value - written as clamps rather than branches, in the same order as the vector versions
+inline unsigned int UniformBin( double Value, double Minimum, double Maximum, double BinWidth, double LastBin )
+{
+	double position = ( Value - Minimum ) / BinWidth;
+	position = ( position > 0.0 ) ? position : 0.0;
+	position = ( Value <= Maximum ) ? position : LastBin;
+	position = ( position < LastBin ) ? position : LastBin;
+	return ( unsigned int )ceil( position );
+}
+
+#ifdef BATCH_INDICES_AVX2
+//Four values at a time - returns how many values were done
+__attribute__(( target( "avx2" ) ))
+unsigned int AddUniformBinsAVX2( const double * Values, unsigned int ValueNumber, double Minimum, double Maximum, double BinWidth,
+		unsigned int BinNumber, unsigned int Multiplier, unsigned int * Indices )
+{
+	__m256d minimum = _mm256_set1_pd( Minimum );
+	__m256d maximum = _mm256_set1_pd( Maximum );
+	__m256d width = _mm256_set1_pd( BinWidth );
+	__m256d lastBin = _mm256_set1_pd( ( double )( BinNumber + 1 ) );
+	__m256d zero = _mm256_setzero_pd();
+	__m128i multiplier = _mm_set1_epi32( Multiplier );
+
+	unsigned int valueIndex = 0;
+	for ( ; valueIndex + 4 <= ValueNumber; valueIndex += 4 )
+	{
+		__m256d value = _mm256_loadu_pd( Values + valueIndex );
+
+		//The overflow test is true for a NaN (unordered), so NaN goes in the overflow bin
+		__m256d position = _mm256_div_pd( _mm256_sub_pd( value, minimum ), width );
+		position = _mm256_max_pd( position, zero );
+		position = _mm256_blendv_pd( position, lastBin, _mm256_cmp_pd( value, maximum, _CMP_NLE_UQ ) );
+		position = _mm256_min_pd( position, lastBin );
+
+		__m128i bins = _mm256_cvttpd_epi32( _mm256_ceil_pd( position ) );
+		__m128i * output = ( __m128i* )( Indices + valueIndex );
+		_mm_storeu_si128( output, _mm_add_epi32( _mm_loadu_si128( output ), _mm_mullo_epi32( bins, multiplier ) ) );
+	}
+
+	return valueIndex;
+}
+
+//Four values at a time, with a binary search over all the inner edges - returns how many values were done
+__attribute__(( target( "avx2" ) ))
+unsigned int AddCustomBinsAVX2( const double * Values, unsigned int ValueNumber, const double * Edges, unsigned int BinNumber,
+		unsigned int Multiplier, unsigned int * Indices )
+{
+	const double * innerEdges = Edges + 1;
+	unsigned int innerEdgeNumber = BinNumber - 1;
+	__m256d lowestEdge = _mm256_set1_pd( Edges[ 0 ] );
+	__m256d highestEdge = _mm256_set1_pd( Edges[ BinNumber ] );
+	__m256i one = _mm256_set1_epi64x( 1 );
+	__m256i overflowBin = _mm256_set1_epi64x( BinNumber + 1 );
+	__m256i lowLanes = _mm256_setr_epi32( 0, 2, 4, 6, 0, 2, 4, 6 );
+	__m128i multiplier = _mm_set1_epi32( Multiplier );
+
+	unsigned int valueIndex = 0;
+	for ( ; valueIndex + 4 <= ValueNumber; valueIndex += 4 )
+	{
+		__m256d value = _mm256_loadu_pd( Values + valueIndex );
+		__m256i bins = one;
+
+		if ( innerEdgeNumber > 0 )
+		{
+			//Halve the range of edges in every lane at once, as in BinEdgeSearch::CountEdges
+			__m256i base = _mm256_setzero_si256();
+			unsigned int remaining = innerEdgeNumber;
+			while ( remaining > 1 )
+			{
+				unsigned int half = remaining / 2;
+				__m256i middle = _mm256_add_epi64( base, _mm256_set1_epi64x( half ) );
+				__m256d notBelow = _mm256_cmp_pd( value, _mm256_i64gather_pd( innerEdges, middle, 8 ), _CMP_NLT_UQ );
+				base = _mm256_blendv_epi8( base, middle, _mm256_castpd_si256( notBelow ) );
+				remaining -= half;
+			}
+
+			//The mask is -1 where the value is at or above the last edge checked, so subtracting it adds one
+			__m256d notBelow = _mm256_cmp_pd( value, _mm256_i64gather_pd( innerEdges, base, 8 ), _CMP_NLT_UQ );
+			bins = _mm256_sub_epi64( _mm256_add_epi64( base, one ), _mm256_castpd_si256( notBelow ) );
+		}
+
+		//Underflow, then overflow (or not a number)
+		__m256d underflow = _mm256_cmp_pd( value, lowestEdge, _CMP_LE_OQ );
+		__m256d overflow = _mm256_cmp_pd( value, highestEdge, _CMP_NLT_UQ );
+		bins = _mm256_andnot_si256( _mm256_castpd_si256( underflow ), bins );
+		bins = _mm256_blendv_epi8( bins, overflowBin, _mm256_castpd_si256( overflow ) );
+
+		//Pack the 64-bit bins down to 32 bits
+		__m128i packedBins = _mm256_castsi256_si128( _mm256_permutevar8x32_epi32( bins, lowLanes ) );
+		__m128i * output = ( __m128i* )( Indices + valueIndex );
+		_mm_storeu_si128( output, _mm_add_epi32( _mm_loadu_si128( output ), _mm_mullo_epi32( packedBins, multiplier ) ) );
+	}
+
+	return valueIndex;
+}
+#endif
+
+#ifdef BATCH_INDICES_NEON
+//Two values at a time - returns how many values were done
+unsigned int AddUniformBinsNEON( const double * Values, unsigned int ValueNumber, double Minimum, double Maximum, double BinWidth,
+		unsigned int BinNumber, unsigned int Multiplier, unsigned int * Indices )
+{
+	float64x2_t minimum = vdupq_n_f64( Minimum );
+	float64x2_t maximum = vdupq_n_f64( Maximum );
+	float64x2_t width = vdupq_n_f64( BinWidth );
+	float64x2_t lastBin = vdupq_n_f64( ( double )( BinNumber + 1 ) );
+	float64x2_t zero = vdupq_n_f64( 0.0 );
+
+	unsigned int valueIndex = 0;
+	for ( ; valueIndex + 2 <= ValueNumber; valueIndex += 2 )
+	{
+		float64x2_t value = vld1q_f64( Values + valueIndex );
+
+		//Only values at or below the maximum keep their position, so NaN goes in the overflow bin
+		float64x2_t position = vdivq_f64( vsubq_f64( value, minimum ), width );
+		position = vmaxnmq_f64( position, zero );
+		position = vbslq_f64( vcleq_f64( value, maximum ), position, lastBin );
+		position = vminq_f64( position, lastBin );
+
+		uint32x2_t bins = vmovn_u64( vcvtq_u64_f64( vrndpq_f64( position ) ) );
+		vst1_u32( Indices + valueIndex, vmla_n_u32( vld1_u32( Indices + valueIndex ), bins, Multiplier ) );
+	}
+
+	return valueIndex;
+}
+#endif
+
+//Add the uniform-width bin of each value, times the multiplier, to the indices
+void BatchIndices::AddUniformBins( const double * Values, unsigned int ValueNumber, double Minimum, double Maximum, double BinWidth,
+		unsigned int BinNumber, unsigned int Multiplier, unsigned int * Indices )
+{
+	unsigned int valueIndex = 0;
+#if defined( BATCH_INDICES_AVX2 )
+	if ( UseAVX2() )
+	{
+		valueIndex = AddUniformBinsAVX2( Values, ValueNumber, Minimum, Maximum, BinWidth, BinNumber, Multiplier, Indices );
+	}
+#elif defined( BATCH_INDICES_NEON )
+	valueIndex = AddUniformBinsNEON( Values, ValueNumber, Minimum, Maximum, BinWidth, BinNumber, Multiplier, Indices );
+#endif
+
+	//Whatever is left over
+	double lastBin = BinNumber + 1;
+	for ( ; valueIndex < ValueNumber; valueIndex++ )
+	{
+		Indices[ valueIndex ] += UniformBin( Values[ valueIndex ], Minimum, Maximum, BinWidth, lastBin ) * Multiplier;
+	}
+}
+
+//Add the custom-width bin of each value, times the multiplier, to the indices - returns how many were done
+unsigned int BatchIndices::AddCustomBins( const double * Values, unsigned int ValueNumber, const double * Edges, unsigned int BinNumber,
+		unsigned int Multiplier, unsigned int * Indices )
+{
+#ifdef BATCH_INDICES_AVX2
+	if ( UseAVX2() )
+	{
+		return AddCustomBinsAVX2( Values, ValueNumber, Edges, BinNumber, Multiplier, Indices );
+	}
+#endif
+
+	return 0;
+}
+
+//Check whether the AVX2 versions are in use
+bool BatchIndices::UseAVX2()
+{
+#ifdef BATCH_INDICES_AVX2
+	static bool hasAVX2 = __builtin_cpu_supports( "avx2" );
+	return hasAVX2;
+#else
+	return false;
+#endif
+}
@@ -28,6 +28,7 @@ BayesianUnfolding::BayesianUnfolding( IIndexCalculator * DistributionIndices, st
 	name = Name;
 	uniqueID = UniqueID;
 	isClone = false;
+	sharedSmearing = false;
 
 	indexCalculator = DistributionIndices;
 	inputSmearing = new SmearingMatrix( indexCalculator );
@@ -46,6 +47,7 @@ BayesianUnfolding::BayesianUnfolding( IIndexCalculator * DistributionIndices, st
 	name = Name;
 	uniqueID = UniqueID;
 	isClone = true;
+	sharedSmearing = true;
 
 	indexCalculator = DistributionIndices;
 	inputSmearing = SharedSmearingMatrix;
@@ -57,6 +59,24 @@ BayesianUnfolding::BayesianUnfolding( IIndexCalculator * DistributionIndices, st
 	distributionComparison = SharedComparison;
 }
 
+//For use with ClonePriorShareSmearingMatrix
+BayesianUnfolding::BayesianUnfolding( IIndexCalculator * DistributionIndices, string Name, unsigned int UniqueID, SmearingMatrix * SharedSmearingMatrix )
+{
+	name = Name;
+	uniqueID = UniqueID;
+	isClone = false;
+	sharedSmearing = true;
+
+	indexCalculator = DistributionIndices;
+	inputSmearing = SharedSmearingMatrix;
+	dataDistribution = new Distribution( indexCalculator );
+	unfoldedDistribution = new Distribution( indexCalculator );
+	truthDistribution = new Distribution( indexCalculator );
+	reconstructedDistribution = new Distribution( indexCalculator );
+	sumOfDataWeightSquares = vector< double >( indexCalculator->GetBinNumber(), 0.0 );
+	distributionComparison = new Comparison( Name, UniqueID );
+}
+
 //Destructor
 BayesianUnfolding::~BayesianUnfolding()
 {
@@ -68,6 +88,9 @@ BayesianUnfolding::~BayesianUnfolding()
 	{
 		delete distributionComparison;
 		delete truthDistribution;
+	}
+	if ( !sharedSmearing )
+	{
 		delete inputSmearing;
 	}
 }
@@ -78,53 +101,125 @@ BayesianUnfolding * BayesianUnfolding::CloneShareSmearingMatrix()
 	return new BayesianUnfolding( indexCalculator, name, uniqueID + 1, distributionComparison, truthDistribution, inputSmearing );
 }
 
+//Make another instance which uses the smearing matrix of this one, but has its own prior distributions
+BayesianUnfolding * BayesianUnfolding::ClonePriorShareSmearingMatrix( string Name, unsigned int UniqueID )
+{
+	return new BayesianUnfolding( indexCalculator, Name, UniqueID, inputSmearing );
+}
+
 //Use this method to supply a value from the truth
 //distribution, and the corresponding reconstructed
 //value
 //NB: These values must both come from the SAME
 //Monte Carlo event, or the whole process is meaningless
-void BayesianUnfolding::StoreTruthRecoPair( vector< double > Truth, vector< double > Reco, double TruthWeight, double RecoWeight, bool UseInPrior )
+void BayesianUnfolding::StoreTruthRecoPair( const double * Truth, const double * Reco, unsigned int ValueNumber, double TruthWeight, double RecoWeight, bool UseInPrior )
+{
+	StoreTruthRecoPairBins( indexCalculator->GetIndex( Truth, ValueNumber ), indexCalculator->GetIndex( Reco, ValueNumber ), TruthWeight, RecoWeight, UseInPrior );
+}
+void BayesianUnfolding::StoreTruthRecoPairBins( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight, double RecoWeight, bool UseInPrior )
 {
+	//Nothing to store if the event is not for the prior, and another instance fills the smearing matrix
+	if ( !UseInPrior && sharedSmearing )
+	{
+		return;
+	}
+
 	if ( UseInPrior )
 	{
-		truthDistribution->StoreEvent( Truth, TruthWeight );
-		reconstructedDistribution->StoreEvent( Reco, RecoWeight );
+		truthDistribution->StoreEventInBin( TruthIndex, TruthWeight );
+		reconstructedDistribution->StoreEventInBin( RecoIndex, RecoWeight );
 	}
 
-	inputSmearing->StoreTruthRecoPair( Truth, Reco, TruthWeight, RecoWeight );
+	//Only the original instance fills a shared smearing matrix
+	if ( !sharedSmearing )
+	{
+		inputSmearing->StoreTruthRecoPair( TruthIndex, RecoIndex, TruthWeight, RecoWeight );
+	}
 }
 
 //If an MC event is not reconstructed at all, use this
 //method to store the truth value alone
-void BayesianUnfolding::StoreUnreconstructedTruth( vector< double > Truth, double Weight, bool UseInPrior )
+void BayesianUnfolding::StoreUnreconstructedTruth( const double * Truth, unsigned int ValueNumber, double Weight, bool UseInPrior )
+{
+	StoreUnreconstructedTruthBin( indexCalculator->GetIndex( Truth, ValueNumber ), Weight, UseInPrior );
+}
+void BayesianUnfolding::StoreUnreconstructedTruthBin( unsigned int TruthIndex, double Weight, bool UseInPrior )
 {
+	//Nothing to store if the event is not for the prior, and another instance fills the smearing matrix
+	if ( !UseInPrior && sharedSmearing )
+	{
+		return;
+	}
+
 	if ( UseInPrior )
 	{
-		truthDistribution->StoreEvent( Truth, Weight );
+		truthDistribution->StoreEventInBin( TruthIndex, Weight );
 		reconstructedDistribution->StoreBadEvent( Weight );
 	}
 
-	inputSmearing->StoreUnreconstructedTruth( Truth, Weight );
+	//Only the original instance fills a shared smearing matrix
+	if ( !sharedSmearing )
+	{
+		inputSmearing->StoreUnreconstructedTruth( TruthIndex, Weight );
+	}
 }
 
 //If there is a fake reconstructed event with no
 //corresponding truth, use this method
-void BayesianUnfolding::StoreReconstructedFake( vector< double > Reco, double Weight, bool UseInPrior )
+void BayesianUnfolding::StoreReconstructedFake( const double * Reco, unsigned int ValueNumber, double Weight, bool UseInPrior )
+{
+	StoreReconstructedFakeBin( indexCalculator->GetIndex( Reco, ValueNumber ), Weight, UseInPrior );
+}
+void BayesianUnfolding::StoreReconstructedFakeBin( unsigned int RecoIndex, double Weight, bool UseInPrior )
 {
+	//Nothing to store if the event is not for the prior, and another instance fills the smearing matrix
+	if ( !UseInPrior && sharedSmearing )
+	{
+		return;
+	}
+
 	if ( UseInPrior )
 	{
 		truthDistribution->StoreBadEvent( Weight );
-		reconstructedDistribution->StoreEvent( Reco, Weight );
+		reconstructedDistribution->StoreEventInBin( RecoIndex, Weight );
 	}
 
-	inputSmearing->StoreReconstructedFake( Reco, Weight );
+	//Only the original instance fills a shared smearing matrix
+	if ( !sharedSmearing )
+	{
+		inputSmearing->StoreReconstructedFake( RecoIndex, Weight );
+	}
 }
 
 //Store a value from the uncorrected data distribution
-void BayesianUnfolding::StoreDataValue( vector< double > Data, double Weight )
+void BayesianUnfolding::StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight )
+{
+	StoreDataBin( indexCalculator->GetIndex( Data, ValueNumber ), Weight );
+}
+void BayesianUnfolding::StoreDataBin( unsigned int DataIndex, double Weight )
+{
+	dataDistribution->StoreEventInBin( DataIndex, Weight );
+	sumOfDataWeightSquares[ DataIndex ] += ( Weight * Weight );
+}
+
+//Add the MC events stored in another instance to this one
+void BayesianUnfolding::MergeEvents( ICorrection * Other )
 {
-	dataDistribution->StoreEvent( Data, Weight );
-	sumOfDataWeightSquares[ indexCalculator->GetIndex( Data ) ] += ( Weight * Weight );
+	BayesianUnfolding * other = dynamic_cast< BayesianUnfolding* >( Other );
+	if ( !other || other->sharedSmearing != sharedSmearing )
+	{
+		cerr << "Can only merge events from a BayesianUnfolding made the same way" << endl;
+		exit(1);
+	}
+
+	truthDistribution->AddEvents( other->truthDistribution );
+	reconstructedDistribution->AddEvents( other->reconstructedDistribution );
+
+	//Only the original instance fills a shared smearing matrix
+	if ( !sharedSmearing )
+	{
+		inputSmearing->AddEvents( other->inputSmearing );
+	}
 }
 
 //Once all data is stored, run the unfolding
@@ -141,38 +236,36 @@ void BayesianUnfolding::Correct( unsigned int MostIterations, unsigned int Error
 	//Finalise the smearing matrix
 	inputSmearing->Finalise();
 
+	//Alternate between two buffers for the iteration results, so nothing is allocated in the loop
+	Distribution * iterationResults[ 2 ] = { unfoldedDistribution, new Distribution( indexCalculator ) };
+	vector< double > effectWorkspace;
+
 	//Iterate, making new distribution from data, old distribution and smearing matrix
-	UnfoldingMatrix * lastUnfoldingMatrix;
 	for ( unsigned int iteration = 0; iteration < MostIterations; iteration++ )
 	{
-		//Smooth the prior distribution, if asked. Don't smooth the truth
-		if ( WithSmoothing && iteration != 0 )
-		{
-			priorDistribution->Smooth();
-		}
-
-		//Make a new unfolding matrix
+		//Use the last result as the prior
 		if ( iteration != 0 )
 		{
-			delete lastUnfoldingMatrix;
+			priorDistribution = iterationResults[ ( iteration + 1 ) % 2 ];
+
+			//Smooth the prior distribution, if asked. Don't smooth the truth
+			if ( WithSmoothing )
+			{
+				priorDistribution->Smooth();
+			}
 		}
-		lastUnfoldingMatrix = new UnfoldingMatrix( inputSmearing, priorDistribution );
 
 		//Unfold
-		unfoldedDistribution = new Distribution( dataDistribution, lastUnfoldingMatrix );
-
-		//Reset for next iteration
-		if ( iteration != 0 )
-		{
-			//Don't delete the MC truth
-			delete priorDistribution;
-		}
-		priorDistribution = unfoldedDistribution;
+		unfoldedDistribution = iterationResults[ iteration % 2 ];
+		unfoldedDistribution->Unfold( dataDistribution, inputSmearing, priorDistribution, effectWorkspace );
 	}
 
 	//Do the full error calculation if requested
 	if ( ErrorMode > 0 )
 	{
+		//Only the error calculation needs the unfolding matrix, so make it for the last iteration
+		UnfoldingMatrix * lastUnfoldingMatrix = new UnfoldingMatrix( inputSmearing, priorDistribution );
+
 		//Do the full error calculation, either just for the variances (ErrorMode == 1) or for all covariances (ErrorMode == 2)
 		bool justVariance = ( ErrorMode == 1 );
 		fullErrors = new CovarianceMatrix( lastUnfoldingMatrix, inputSmearing, dataDistribution, unfoldedDistribution->Integral(), justVariance );
@@ -188,8 +281,82 @@ void BayesianUnfolding::Correct( unsigned int MostIterations, unsigned int Error
 		{
 			delete fullErrors;
 		}
+		delete lastUnfoldingMatrix;
+	}
+
+	//Release the spare buffer
+	if ( unfoldedDistribution == iterationResults[ 0 ] )
+	{
+		delete iterationResults[ 1 ];
+	}
+	else
+	{
+		delete iterationResults[ 0 ];
+	}
+}
+
+//Unfold the data of all the clones together, without the error calculation
+void BayesianUnfolding::CorrectClones( vector< ICorrection* > Clones, unsigned int MostIterations, bool WithSmoothing )
+{
+	//Finalise the smearing matrix
+	inputSmearing->Finalise();
+
+	//Set up the distributions for each clone
+	unsigned int cloneNumber = Clones.size();
+	vector< Distribution* > dataDistributions, priorDistributions;
+	vector< Distribution* > iterationResults[ 2 ];
+	for ( unsigned int cloneIndex = 0; cloneIndex < cloneNumber; cloneIndex++ )
+	{
+		BayesianUnfolding * clone = dynamic_cast< BayesianUnfolding* >( Clones[ cloneIndex ] );
+		if ( !clone || clone->inputSmearing != inputSmearing )
+		{
+			cerr << "Can only correct clones made by BayesianUnfolding::CloneShareSmearingMatrix" << endl;
+			exit(1);
+		}
+
+		//Extrapolate the number of missed events in the data
+		clone->dataDistribution->SetBadBin( inputSmearing->GetTotalMissed() / ( inputSmearing->GetTotalPaired() + inputSmearing->GetTotalFake() ) );
+		dataDistributions.push_back( clone->dataDistribution );
+
+		//Use the truth distribution as the prior
+		priorDistributions.push_back( clone->truthDistribution );
+
+		//Alternate between two buffers for the iteration results, so nothing is allocated in the loop
+		iterationResults[ 0 ].push_back( clone->unfoldedDistribution );
+		iterationResults[ 1 ].push_back( new Distribution( indexCalculator ) );
+	}
+
+	//Iterate all the clones together
+	vector< double > workspace;
+	for ( unsigned int iteration = 0; iteration < MostIterations; iteration++ )
+	{
+		//Use the last results as the priors
+		if ( iteration != 0 )
+		{
+			priorDistributions = iterationResults[ ( iteration + 1 ) % 2 ];
+
+			//Smooth the prior distributions, if asked. Don't smooth the truth
+			if ( WithSmoothing )
+			{
+				for ( unsigned int cloneIndex = 0; cloneIndex < cloneNumber; cloneIndex++ )
+				{
+					priorDistributions[ cloneIndex ]->Smooth();
+				}
+			}
+		}
+
+		//Unfold
+		Distribution::UnfoldBatch( iterationResults[ iteration % 2 ], dataDistributions, inputSmearing, priorDistributions, workspace );
+	}
+
+	//Store the results, and release the spare buffers
+	unsigned int resultIndex = ( MostIterations + 1 ) % 2;
+	for ( unsigned int cloneIndex = 0; cloneIndex < cloneNumber; cloneIndex++ )
+	{
+		BayesianUnfolding * clone = dynamic_cast< BayesianUnfolding* >( Clones[ cloneIndex ] );
+		clone->unfoldedDistribution = iterationResults[ resultIndex ][ cloneIndex ];
+		delete iterationResults[ 1 - resultIndex ][ cloneIndex ];
 	}
-	delete lastUnfoldingMatrix;
 }
 
 //Perform a closure test
@@ -203,31 +370,29 @@ bool BayesianUnfolding::ClosureTest( unsigned int MostIterations, bool WithSmoot
 	//Finalise the smearing matrix
 	inputSmearing->Finalise();
 
-	//Make a pointer for the iteration result
-	Distribution * unfoldedReconstructedDistribution;
+	//Alternate between two buffers for the iteration results, so nothing is allocated in the loop
+	Distribution * iterationResults[ 2 ] = { new Distribution( indexCalculator ), new Distribution( indexCalculator ) };
+	Distribution * unfoldedReconstructedDistribution = iterationResults[ 0 ];
+	vector< double > effectWorkspace;
 
 	//Iterate
-	UnfoldingMatrix * lastUnfoldingMatrix;
 	for ( unsigned int iteration = 0; iteration < MostIterations; iteration++ )
 	{
-		//Smooth the prior distribution, is asked. Don't smooth the truth
-		if ( WithSmoothing && iteration != 0 )
+		//Use the last result as the prior
+		if ( iteration != 0 )
 		{
-			priorDistribution->Smooth();
+			priorDistribution = iterationResults[ ( iteration + 1 ) % 2 ];
+
+			//Smooth the prior distribution, is asked. Don't smooth the truth
+			if ( WithSmoothing )
+			{
+				priorDistribution->Smooth();
+			}
 		}
 
 		//Unfold
-		lastUnfoldingMatrix = new UnfoldingMatrix( inputSmearing, priorDistribution );
-		unfoldedReconstructedDistribution = new Distribution( reconstructedDistribution, lastUnfoldingMatrix );
-		delete lastUnfoldingMatrix;
-
-		//Reset for next iteration
-		if ( iteration != 0 )
-		{
-			//Don't delete the MC truth
-			delete priorDistribution;
-		}
-		priorDistribution = unfoldedReconstructedDistribution;
+		unfoldedReconstructedDistribution = iterationResults[ iteration % 2 ];
+		unfoldedReconstructedDistribution->Unfold( reconstructedDistribution, inputSmearing, priorDistribution, effectWorkspace );
 	}
 
 	//Compare with truth distribution
@@ -236,7 +401,8 @@ bool BayesianUnfolding::ClosureTest( unsigned int MostIterations, bool WithSmoot
 
 	//Output result
 	double binNumber = (double)indexCalculator->GetBinNumber();
-	delete unfoldedReconstructedDistribution;
+	delete iterationResults[ 0 ];
+	delete iterationResults[ 1 ];
 	if ( chi2Reference == 0.0 && kolmogorovReference == 1.0 )
 	{
 		cout << "Perfect closure test: chi squared = " << chi2Reference << " and K-S probability = " << kolmogorovReference << ". Nice one!" << endl;
@@ -258,7 +424,7 @@ bool BayesianUnfolding::ClosureTest( unsigned int MostIterations, bool WithSmoot
 //Use MC truth A as a prior to unfold MC reco B
 //Iterations cease when result is sufficiently close to MC truth B (passed as argument)
 //Returns the number of iterations required. Convergence criteria as output arguments
-unsigned int BayesianUnfolding::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing )
+unsigned int BayesianUnfolding::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing, ostream & Output )
 {
 	//Extrapolate the number of missed events in the data - Not needed, using reco
 	//dataDistribution->SetBadBin( totalMissed / ( totalPaired + totalFake ) );
@@ -266,10 +432,13 @@ unsigned int BayesianUnfolding::MonteCarloCrossCheck( Distribution * InputPriorD
 	//Use the input distribution as a prior for unfolding
 	Distribution * priorDistribution = InputPriorDistribution;
 
-	//Finalise the smearing matrix
+	//Finalise the smearing matrix - does nothing if it's already finalised, as it must be when cross-checks run in parallel
 	InputSmearing->Finalise();
 
-	cout << "------------- Cross-Check -------------" << endl;
+	//The comparison is shared with any clones, so use a separate one to be safe in parallel
+	Comparison crossCheckComparison( name, uniqueID );
+
+	Output << "------------- Cross-Check -------------" << endl;
 
 	//Test
 	//double lastDelinC, lastDelinK;
@@ -278,59 +447,60 @@ unsigned int BayesianUnfolding::MonteCarloCrossCheck( Distribution * InputPriorD
 
 	//Compare the uncorrected reco to the truth
 	double lastChiSquared, lastKolmogorov;
-	distributionComparison->CompareDistributions( truthDistribution, reconstructedDistribution, lastChiSquared, lastKolmogorov );
-	cout << "0: " << lastChiSquared << ", " << lastKolmogorov;
+	crossCheckComparison.CompareDistributions( truthDistribution, reconstructedDistribution, lastChiSquared, lastKolmogorov );
+	Output << "0: " << lastChiSquared << ", " << lastKolmogorov;
+
+	//Alternate between two buffers for the iteration results, so nothing is allocated in the loop
+	Distribution * iterationResults[ 2 ] = { new Distribution( indexCalculator ), new Distribution( indexCalculator ) };
+	vector< double > effectWorkspace;
 
 	//Iterate, making new distribution from data, old distribution and smearing matrix
-	Distribution * adjustedDistribution;
-	UnfoldingMatrix * lastUnfoldingMatrix;
 	for ( unsigned int iteration = 0; iteration < MAX_ITERATIONS_FOR_CROSS_CHECK; iteration++ )
 	{
-		//Smooth the prior distribution, if asked. Don't smooth the truth
-		if ( WithSmoothing && iteration != 0 )
+		//Use the last result as the prior
+		if ( iteration != 0 )
 		{
-			priorDistribution->Smooth();
+			priorDistribution = iterationResults[ ( iteration + 1 ) % 2 ];
+
+			//Smooth the prior distribution, if asked. Don't smooth the truth
+			if ( WithSmoothing )
+			{
+				priorDistribution->Smooth();
+			}
 		}
 
 		//Iterate
-		lastUnfoldingMatrix = new UnfoldingMatrix( InputSmearing, priorDistribution );
-		adjustedDistribution = new Distribution( reconstructedDistribution, lastUnfoldingMatrix );
-		delete lastUnfoldingMatrix;
+		Distribution * adjustedDistribution = iterationResults[ iteration % 2 ];
+		adjustedDistribution->Unfold( reconstructedDistribution, InputSmearing, priorDistribution, effectWorkspace );
 
 		//Compare with reference distribution (the MC truth)
 		double referenceChi2, referenceKolmogorov;
-		distributionComparison->CompareDistributions( adjustedDistribution, truthDistribution, referenceChi2, referenceKolmogorov );
+		crossCheckComparison.CompareDistributions( adjustedDistribution, truthDistribution, referenceChi2, referenceKolmogorov );
 
 		//Test
 		//double delinC, delinK;
 		//distributionComparison->DelineariseAndCompare( adjustedDistribution, truthDistribution, delinC, delinK, indexCalculator );
 		//cout << endl << delinC << ", " << delinK << endl;
 
-		//Reset for next iteration
-		if ( iteration != 0 )
-		{
-			//Don't delete the input prior
-			delete priorDistribution;
-		}
-		priorDistribution = adjustedDistribution;
-
 		//Check to see if things have got worse
 		if ( referenceChi2 > lastChiSquared || referenceKolmogorov < lastKolmogorov || ( referenceChi2 == lastChiSquared && referenceKolmogorov == lastKolmogorov ) )
 		//if ( delinC > lastDelinC || delinK < lastDelinK || ( delinC == lastDelinC && delinK == lastDelinK ) )
 		{
 			//Return the criteria
-			cout << " <--" << endl << iteration + 1 << ": " << referenceChi2 << ", " << referenceKolmogorov << endl;
-			cout << "-------------------------------------" << endl;
-			delete adjustedDistribution;
+			Output << " <--" << endl << iteration + 1 << ": " << referenceChi2 << ", " << referenceKolmogorov << endl;
+			Output << "-------------------------------------" << endl;
+			delete iterationResults[ 0 ];
+			delete iterationResults[ 1 ];
 			return iteration;
 		}
 		else if ( iteration == MAX_ITERATIONS_FOR_CROSS_CHECK - 1 )
 		{
 			//Return the criteria
-			cout << endl << iteration + 1 << ": " << referenceChi2 << ", " << referenceKolmogorov << " <--" << endl;
-			cout << "Artificial iteration limit reached - change the code if you really want to go further" << endl;
-			cout << "-------------------------------------" << endl;
-			delete adjustedDistribution;
+			Output << endl << iteration + 1 << ": " << referenceChi2 << ", " << referenceKolmogorov << " <--" << endl;
+			Output << "Artificial iteration limit reached - change the code if you really want to go further" << endl;
+			Output << "-------------------------------------" << endl;
+			delete iterationResults[ 0 ];
+			delete iterationResults[ 1 ];
 			return MAX_ITERATIONS_FOR_CROSS_CHECK;
 		}
 		else
@@ -340,7 +510,7 @@ unsigned int BayesianUnfolding::MonteCarloCrossCheck( Distribution * InputPriorD
 			lastKolmogorov = referenceKolmogorov;
 			//lastDelinC = delinC;
 			//lastDelinK = delinK;
-			cout << endl << iteration + 1 << ": " << referenceChi2 << ", " << referenceKolmogorov;
+			Output << endl << iteration + 1 << ": " << referenceChi2 << ", " << referenceKolmogorov;
 		}
 	}
 
@@ -100,54 +100,97 @@ BinByBinUnfolding * BinByBinUnfolding::CloneShareSmearingMatrix()
 //value
 //NB: These values must both come from the SAME
 //Monte Carlo event, or the whole process is meaningless
-void BinByBinUnfolding::StoreTruthRecoPair( vector< double > Truth, vector< double > Reco, double TruthWeight, double RecoWeight, bool UseInPrior )
+void BinByBinUnfolding::StoreTruthRecoPair( const double * Truth, const double * Reco, unsigned int ValueNumber, double TruthWeight, double RecoWeight, bool UseInPrior )
+{
+	StoreTruthRecoPairBins( indexCalculator->GetIndex( Truth, ValueNumber ), indexCalculator->GetIndex( Reco, ValueNumber ), TruthWeight, RecoWeight, UseInPrior );
+}
+void BinByBinUnfolding::StoreTruthRecoPairBins( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight, double RecoWeight, bool UseInPrior )
 {
 	if ( UseInPrior )
 	{
-		truthDistribution->StoreEvent( Truth, TruthWeight );
-		reconstructedDistribution->StoreEvent( Reco, RecoWeight );
+		truthDistribution->StoreEventInBin( TruthIndex, TruthWeight );
+		reconstructedDistribution->StoreEventInBin( RecoIndex, RecoWeight );
 	}
 
 	( *totalPaired ) += TruthWeight;
-	( *truthBinSums )[ indexCalculator->GetIndex( Truth ) ] += TruthWeight;
-	( *recoBinSums )[ indexCalculator->GetIndex( Reco ) ] += RecoWeight;
+	( *truthBinSums )[ TruthIndex ] += TruthWeight;
+	( *recoBinSums )[ RecoIndex ] += RecoWeight;
 }
 
 //If an MC event is not reconstructed at all, use this
 //method to store the truth value alone
-void BinByBinUnfolding::StoreUnreconstructedTruth( vector< double > Truth, double Weight, bool UseInPrior )
+void BinByBinUnfolding::StoreUnreconstructedTruth( const double * Truth, unsigned int ValueNumber, double Weight, bool UseInPrior )
+{
+	StoreUnreconstructedTruthBin( indexCalculator->GetIndex( Truth, ValueNumber ), Weight, UseInPrior );
+}
+void BinByBinUnfolding::StoreUnreconstructedTruthBin( unsigned int TruthIndex, double Weight, bool UseInPrior )
 {
 	if ( UseInPrior )
 	{
-		truthDistribution->StoreEvent( Truth, Weight );
+		truthDistribution->StoreEventInBin( TruthIndex, Weight );
 		reconstructedDistribution->StoreBadEvent( Weight );
 	}
 
 	( *totalMissed ) += Weight;
-	( *truthBinSums )[ indexCalculator->GetIndex( Truth ) ] += Weight;
+	( *truthBinSums )[ TruthIndex ] += Weight;
 	( *recoBinSums )[ recoBinSums->size() - 1 ] += Weight;
 }
 
 //If there is a fake reconstructed event with no
 //corresponding truth, use this method
-void BinByBinUnfolding::StoreReconstructedFake( vector< double > Reco, double Weight, bool UseInPrior )
+void BinByBinUnfolding::StoreReconstructedFake( const double * Reco, unsigned int ValueNumber, double Weight, bool UseInPrior )
+{
+	StoreReconstructedFakeBin( indexCalculator->GetIndex( Reco, ValueNumber ), Weight, UseInPrior );
+}
+void BinByBinUnfolding::StoreReconstructedFakeBin( unsigned int RecoIndex, double Weight, bool UseInPrior )
 {
 	if ( UseInPrior )
 	{
 		truthDistribution->StoreBadEvent( Weight );
-		reconstructedDistribution->StoreEvent( Reco, Weight );
+		reconstructedDistribution->StoreEventInBin( RecoIndex, Weight );
 	}
 
 	( *totalFake ) += Weight;
 	( *truthBinSums )[ truthBinSums->size() - 1 ] += Weight;
-	( *recoBinSums )[ indexCalculator->GetIndex( Reco ) ] += Weight;
+	( *recoBinSums )[ RecoIndex ] += Weight;
 }
 
 //Store a value from the uncorrected data distribution
-void BinByBinUnfolding::StoreDataValue( vector< double > Data, double Weight )
+void BinByBinUnfolding::StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight )
+{
+	StoreDataBin( indexCalculator->GetIndex( Data, ValueNumber ), Weight );
+}
+void BinByBinUnfolding::StoreDataBin( unsigned int DataIndex, double Weight )
 {
-	dataDistribution->StoreEvent( Data, Weight );
-	sumOfDataWeightSquares[ indexCalculator->GetIndex( Data ) ] += ( Weight * Weight );
+	dataDistribution->StoreEventInBin( DataIndex, Weight );
+	sumOfDataWeightSquares[ DataIndex ] += ( Weight * Weight );
+}
+
+//Add the MC events stored in another instance to this one
+void BinByBinUnfolding::MergeEvents( ICorrection * Other )
+{
+	BinByBinUnfolding * other = dynamic_cast< BinByBinUnfolding* >( Other );
+	if ( !other || other->isClone != isClone )
+	{
+		cerr << "Can only merge events from a BinByBinUnfolding made the same way" << endl;
+		exit(1);
+	}
+
+	reconstructedDistribution->AddEvents( other->reconstructedDistribution );
+
+	//The truth distribution and bin sums are shared with clones, so only the original adds them
+	if ( !isClone )
+	{
+		truthDistribution->AddEvents( other->truthDistribution );
+		for ( unsigned int binIndex = 0; binIndex < truthBinSums->size(); binIndex++ )
+		{
+			( *truthBinSums )[ binIndex ] += ( *other->truthBinSums )[ binIndex ];
+			( *recoBinSums )[ binIndex ] += ( *other->recoBinSums )[ binIndex ];
+		}
+		( *totalPaired ) += ( *other->totalPaired );
+		( *totalMissed ) += ( *other->totalMissed );
+		( *totalFake ) += ( *other->totalFake );
+	}
 }
 
 //Once all data is stored, run the unfolding
@@ -231,7 +274,7 @@ bool BinByBinUnfolding::ClosureTest( unsigned int MostIterations, bool WithSmoot
 
 //Perform an unfolding cross-check
 //Just a dummy since there is no iteration
-unsigned int BinByBinUnfolding::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing )
+unsigned int BinByBinUnfolding::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing, ostream & Output )
 {
 	return 1;
 }
@@ -0,0 +1,129 @@
+/**
+  @class BinEdgeSearch
+
+  Finds the bin containing a value, for bins with custom widths
+  The edges are kept in a flat array, and a uniform grid over the range narrows each search down to a few edges
+ */
+
+#include "BinEdgeSearch.h"
+#include "BatchIndices.h"
+#include <algorithm>
+
+//Cells in the grid for each bin - enough that most cells hold at most one edge, even for logarithmic bins
+const unsigned int GRID_CELLS_PER_BIN = 16;
+const unsigned int MOST_GRID_CELLS = 65536;
+
+//Default constructor
+BinEdgeSearch::BinEdgeSearch()
+{
+	binNumber = 0;
+	useGrid = false;
+	cellNumber = 0;
+	gridLow = 0.0;
+	gridScale = 0.0;
+}
+
+//Constructor taking the bin edges, which must be in increasing order
+BinEdgeSearch::BinEdgeSearch( const vector< double > & LowEdges, bool UseGrid )
+{
+	edges = LowEdges;
+	binNumber = edges.size() - 1;
+	useGrid = UseGrid && binNumber > 1;
+	cellNumber = 0;
+	gridLow = edges[ 0 ];
+	gridScale = 0.0;
+
+	if ( useGrid )
+	{
+		//Make a uniform grid from the lowest edge to the highest
+		cellNumber = min( GRID_CELLS_PER_BIN * binNumber, MOST_GRID_CELLS );
+		gridScale = ( double )cellNumber / ( edges[ binNumber ] - gridLow );
+		cellFirstEdges = vector< unsigned int >( cellNumber, 0 );
+		cellEdgeNumbers = vector< unsigned int >( cellNumber, 0 );
+
+		//Find the inner edges that could be in each cell, with one more either side in case of rounding
+		const double * innerEdges = &edges[ 1 ];
+		unsigned int innerEdgeNumber = binNumber - 1;
+		for ( unsigned int cellIndex = 0; cellIndex < cellNumber; cellIndex++ )
+		{
+			double cellLow = gridLow + ( ( double )cellIndex / gridScale );
+			double cellHigh = gridLow + ( ( double )( cellIndex + 1 ) / gridScale );
+			unsigned int firstEdge = lower_bound( innerEdges, innerEdges + innerEdgeNumber, cellLow ) - innerEdges;
+			unsigned int lastEdge = upper_bound( innerEdges, innerEdges + innerEdgeNumber, cellHigh ) - innerEdges;
+			if ( firstEdge > 0 )
+			{
+				firstEdge--;
+			}
+			if ( lastEdge < innerEdgeNumber )
+			{
+				lastEdge++;
+			}
+
+			cellFirstEdges[ cellIndex ] = firstEdge;
+			cellEdgeNumbers[ cellIndex ] = lastEdge - firstEdge;
+		}
+	}
+}
+
+//Destructor
+BinEdgeSearch::~BinEdgeSearch()
+{
+}
+
+//Return the bin for a value: 0 for underflow, 1 to N for the bins, N + 1 for overflow
+unsigned int BinEdgeSearch::FindBin( double Value ) const
+{
+	if ( Value <= edges[ 0 ] )
+	{
+		//Underflow bin
+		return 0;
+	}
+	else if ( !( Value < edges[ binNumber ] ) )
+	{
+		//Overflow (or not a number)
+		return binNumber + 1;
+	}
+	else if ( useGrid )
+	{
+		//Only look at the edges that could be in this grid cell
+		unsigned int cellIndex = min( ( unsigned int )( ( Value - gridLow ) * gridScale ), cellNumber - 1 );
+		return 1 + CountEdges( Value, cellFirstEdges[ cellIndex ], cellEdgeNumbers[ cellIndex ] );
+	}
+	else
+	{
+		return 1 + CountEdges( Value, 0, binNumber - 1 );
+	}
+}
+
+//Add the bin of each value, times the multiplier, to the indices
+void BinEdgeSearch::AddBins( const double * Values, unsigned int ValueNumber, unsigned int Multiplier, unsigned int * Indices ) const
+{
+	//Use the vector instructions if there are any, then the grid for whatever is left
+	unsigned int valueIndex = BatchIndices::AddCustomBins( Values, ValueNumber, &edges[0], binNumber, Multiplier, Indices );
+	for ( ; valueIndex < ValueNumber; valueIndex++ )
+	{
+		Indices[ valueIndex ] += FindBin( Values[ valueIndex ] ) * Multiplier;
+	}
+}
+
+//Count the inner edges at or below a value, from the given range of edges
+//The edges before the range must all be below the value, and the edges after it above
+unsigned int BinEdgeSearch::CountEdges( double Value, unsigned int FirstEdge, unsigned int EdgeNumber ) const
+{
+	if ( EdgeNumber == 0 )
+	{
+		return FirstEdge;
+	}
+
+	//Binary search without branches: halve the range by moving the base, which compiles to a conditional move
+	const double * base = &edges[ 1 + FirstEdge ];
+	const double * innerEdges = &edges[ 1 ];
+	while ( EdgeNumber > 1 )
+	{
+		unsigned int half = EdgeNumber / 2;
+		base = ( Value < base[ half ] ) ? base : base + half;
+		EdgeNumber -= half;
+	}
+
+	return ( base - innerEdges ) + !( Value < *base );
+}
@@ -2,6 +2,7 @@
   @class Comparison
 
   An extremely simple class to return the Chi2 and Kolmogorov-Smirnoff comparison values betweeen two histograms
+  The statistics are worked out straight from the bin contents, giving the same values as the Root histogram tests
   The histogram naming scheme prevents the tedious complaints from Root about making multiple objects with the same name
 
   @author Benjamin M Wynne bwynne@cern.ch
@@ -13,7 +14,9 @@
 #include "TProfile.h"
 #include "TFile.h"
 #include <iostream>
+#include <cstdlib>
 #include <cmath>
+#include <algorithm>
 
 const bool CLOSURE_FILE_OUTPUT = false;
 
@@ -34,45 +37,32 @@ Comparison::~Comparison()
 
 void Comparison::CompareDistributions( Distribution * FirstInput, Distribution * SecondInput, double & ChiSquared, double & Kolmogorov, bool IsClosureTest )
 {
-	//Set up the name for both plots in this comparison
-	stringstream internalName;
-	internalName << name << "." << uniqueID << "." << internalID;
-
-	TFile * debugFile;
-	if ( IsClosureTest && CLOSURE_FILE_OUTPUT )
-	{
-		string fileName = internalName.str() + ".ClosureTest.root";
-		debugFile = new TFile( fileName.c_str(), "RECREATE" );
-	}
-
-	//Make a plot of the first distribution
-	string firstPlotName = "FirstPlot" + internalName.str();
-	TH1F * firstPlot = FirstInput->MakeRootHistogram( firstPlotName, firstPlotName );
-
-	//Make a plot of the second distribution
-	string secondPlotName = "SecondPlot" + internalName.str();
-	TH1F * secondPlot = SecondInput->MakeRootHistogram( secondPlotName, secondPlotName );
-
-	if ( IsClosureTest && CLOSURE_FILE_OUTPUT )
+	//The bins a TH1F would compare - everything but the underflow at the start, and the overflow and bad bin at the end
+	const vector< double > & firstValues = FirstInput->GetBinValues();
+	const vector< double > & secondValues = SecondInput->GetBinValues();
+	if ( firstValues.size() != secondValues.size() )
 	{
-		firstPlot->Write();
-		secondPlot->Write();
+		cerr << "Trying to compare distributions with different numbers of bins: " << firstValues.size() << " vs " << secondValues.size() << endl;
+		exit(1);
 	}
+	unsigned int binNumber = firstValues.size() - 3;
+	const double * firstBins = &firstValues[1];
+	const double * secondBins = &secondValues[1];
 
 	//Do the comparison
-	ChiSquared = firstPlot->Chi2Test( secondPlot, "UUCHI2" );
-	Kolmogorov = firstPlot->KolmogorovTest( secondPlot, "" );
+	ChiSquared = UnweightedChiSquared( firstBins, secondBins, binNumber );
+	Kolmogorov = KolmogorovProbability( firstBins, secondBins, binNumber );
 
 	//For closure tests, give some more detailed info
 	if ( IsClosureTest )
 	{
-		int maxDeviationIndex = 0;
+		unsigned int maxDeviationIndex = 0;
 		double sumErrors = 0;
 		double maxDeviation = 0;
 		double maxError = 0;
-		for ( int binIndex = 1; binIndex <= firstPlot->GetNbinsX(); binIndex++ )
+		for ( unsigned int binIndex = 0; binIndex < binNumber; binIndex++ )
 		{
-			double error = secondPlot->GetBinContent( binIndex ) / firstPlot->GetBinContent( binIndex );
+			double error = ( double )( float )secondBins[ binIndex ] / ( double )( float )firstBins[ binIndex ];
 			if ( isnan( error ) )
 			{
 				error = 1.0;
@@ -84,33 +74,159 @@ void Comparison::CompareDistributions( Distribution * FirstInput, Distribution *
 			sumErrors += error;
 
 			double deviation = fabs( error - 1.0 );
-			if ( deviation > maxDeviation || binIndex == 1 )
+			if ( deviation > maxDeviation || binIndex == 0 )
 			{
 				maxDeviation = deviation;
 				maxError = error;
-				maxDeviationIndex = binIndex;
+				maxDeviationIndex = binIndex + 1;
 			}
 		}
-		cout << "Average ratio ( unfolded bin ) / ( reference bin ) = " << sumErrors / (double)firstPlot->GetNbinsX() << endl;
+		cout << "Average ratio ( unfolded bin ) / ( reference bin ) = " << sumErrors / (double)binNumber << endl;
 
 		if ( maxDeviation > 1E-10 )
 		{
-			cout << "Greatest discrepancy ( " << maxError << " ) is in bin " << maxDeviationIndex << " of " << firstPlot->GetNbinsX() << endl;
+			cout << "Greatest discrepancy ( " << maxError << " ) is in bin " << maxDeviationIndex << " of " << binNumber << endl;
+		}
+
+		//Save the plots for debugging
+		if ( CLOSURE_FILE_OUTPUT )
+		{
+			stringstream internalName;
+			internalName << name << "." << uniqueID << "." << internalID;
+			string fileName = internalName.str() + ".ClosureTest.root";
+			TFile * debugFile = new TFile( fileName.c_str(), "RECREATE" );
+
+			string firstPlotName = "FirstPlot" + internalName.str();
+			string secondPlotName = "SecondPlot" + internalName.str();
+			FirstInput->MakeRootHistogram( firstPlotName, firstPlotName )->Write();
+			SecondInput->MakeRootHistogram( secondPlotName, secondPlotName )->Write();
+
+			debugFile->Close();
+			delete debugFile;
+			internalID++;
+		}
+	}
+}
+
+//Same as TH1::Chi2Test with option "UUCHI2" - see N. Gagunashvili, "Chi-square tests for comparing weighted histograms"
+//Bins that are empty in both are skipped, and the result is zero if either histogram is empty
+double Comparison::UnweightedChiSquared( const double * FirstValues, const double * SecondValues, unsigned int BinNumber )
+{
+	double firstSum = 0.0;
+	double secondSum = 0.0;
+	for ( unsigned int binIndex = 0; binIndex < BinNumber; binIndex++ )
+	{
+		firstSum += ( float )FirstValues[ binIndex ];
+		secondSum += ( float )SecondValues[ binIndex ];
+	}
+	if ( firstSum == 0.0 || secondSum == 0.0 )
+	{
+		return 0.0;
+	}
+
+	double chiSquared = 0.0;
+	for ( unsigned int binIndex = 0; binIndex < BinNumber; binIndex++ )
+	{
+		double firstValue = ( float )FirstValues[ binIndex ];
+		double secondValue = ( float )SecondValues[ binIndex ];
+		double binSum = firstValue + secondValue;
+		if ( binSum == 0.0 )
+		{
+			continue;
 		}
+
+		double difference = ( secondSum * firstValue ) - ( firstSum * secondValue );
+		chiSquared += difference * difference / binSum;
+	}
+
+	return chiSquared / ( firstSum * secondSum );
+}
+
+//Same as TH1::KolmogorovTest with no options, for histograms without Sumw2
+//The result is zero if either histogram is empty
+double Comparison::KolmogorovProbability( const double * FirstValues, const double * SecondValues, unsigned int BinNumber )
+{
+	//Sums of contents, and of squared errors
+	double firstSum = 0.0, secondSum = 0.0;
+	double firstErrorSum = 0.0, secondErrorSum = 0.0;
+	for ( unsigned int binIndex = 0; binIndex < BinNumber; binIndex++ )
+	{
+		double firstValue = ( float )FirstValues[ binIndex ];
+		double secondValue = ( float )SecondValues[ binIndex ];
+		firstSum += firstValue;
+		secondSum += secondValue;
+		firstErrorSum += fabs( firstValue );
+		secondErrorSum += fabs( secondValue );
+	}
+	if ( firstSum == 0.0 || secondSum == 0.0 )
+	{
+		return 0.0;
 	}
 
-	//Clean up
-	if ( IsClosureTest && CLOSURE_FILE_OUTPUT )
+	//Effective numbers of entries, from the bin errors as in Root 5.34 - older Root used GetEntries() instead
+	//unfolding/bench/ComparisonAgainstRoot checks this against the Root version the program is built with
+	//The error sums can't be zero if the sums aren't
+	double firstEntries = firstSum * firstSum / firstErrorSum;
+	double secondEntries = secondSum * secondSum / secondErrorSum;
+
+	//Largest difference between the cumulative distributions
+	double firstScale = 1.0 / firstSum;
+	double secondScale = 1.0 / secondSum;
+	double firstCumulative = 0.0, secondCumulative = 0.0, largestDifference = 0.0;
+	for ( unsigned int binIndex = 0; binIndex < BinNumber; binIndex++ )
 	{
-		debugFile->Close();
-		delete debugFile;
+		firstCumulative += firstScale * ( float )FirstValues[ binIndex ];
+		secondCumulative += secondScale * ( float )SecondValues[ binIndex ];
+		largestDifference = max( largestDifference, fabs( firstCumulative - secondCumulative ) );
+	}
+
+	return KolmogorovDistribution( largestDifference * sqrt( firstEntries * secondEntries / ( firstEntries + secondEntries ) ) );
+}
+
+//The probability of exceeding a Kolmogorov test statistic - the same approximation as TMath::KolmogorovProb
+double Comparison::KolmogorovDistribution( double Z )
+{
+	const double exponents[ 4 ] = { -2.0, -8.0, -18.0, -32.0 };
+	const double rootTwoPi = 2.50662827;
+
+	//-pi^2 / 8 times 1, 9 and 25
+	const double firstScale = -1.2337005501361698;
+	const double secondScale = -11.103304951225528;
+	const double thirdScale = -30.842513753404244;
+
+	double u = fabs( Z );
+	if ( u < 0.2 )
+	{
+		return 1.0;
+	}
+	else if ( u < 0.755 )
+	{
+		double v = 1.0 / ( u * u );
+		return 1.0 - rootTwoPi * ( exp( firstScale * v ) + exp( secondScale * v ) + exp( thirdScale * v ) ) / u;
+	}
+	else if ( u < 6.8116 )
+	{
+		//Number of series terms, rounded to nearest (even on a tie) as TMath::Nint does
+		double termEstimate = 3.0 / u;
+		int termNumber = ( int )( termEstimate + 0.5 );
+		if ( ( termNumber & 1 ) && termEstimate + 0.5 == ( double )termNumber )
+		{
+			termNumber--;
+		}
+		termNumber = max( 1, termNumber );
+
+		double terms[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
+		double v = u * u;
+		for ( int termIndex = 0; termIndex < termNumber; termIndex++ )
+		{
+			terms[ termIndex ] = exp( exponents[ termIndex ] * v );
+		}
+		return 2.0 * ( terms[0] - terms[1] + terms[2] - terms[3] );
 	}
 	else
 	{
-		delete firstPlot;
-		delete secondPlot;
+		return 0.0;
 	}
-	internalID++;
 }
 
 void Comparison::DelineariseAndCompare( Distribution * FirstInput, Distribution * SecondInput, double & ChiSquared, double & Kolmogorov, IIndexCalculator * InputIndices )
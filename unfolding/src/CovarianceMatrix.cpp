@@ -11,9 +11,12 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <thread>
 
 const int PERCENT_PROGRESS_INCREMENT = 10;
 
+unsigned int CovarianceMatrix::rowThreadNumber = 0;
+
 //Default constructor - useless
 CovarianceMatrix::CovarianceMatrix()
 {
@@ -26,6 +29,7 @@ CovarianceMatrix::CovarianceMatrix( UnfoldingMatrix * InputUnfolding, SmearingMa
 	inputSmearing = InputSmearing;
 	inputUnfolding = InputUnfolding;
 	correctedSum = CorrectedSum;
+	binNumber = InputUnfolding->GetBinNumber();
 
 	//Status message
 	time(&timeNow);
@@ -38,81 +42,69 @@ CovarianceMatrix::CovarianceMatrix( UnfoldingMatrix * InputUnfolding, SmearingMa
 		cout << endl << "Started calculating full covariance matrix: " << ctime( &timeNow ) << endl;
 	}
 
-	//Construct a sparse matrix for the smearing covariance
-	rsuMatrix = new SmearingCovariance( InputSmearing, InputUnfolding );
-
-	//The covariance matrix will have zero entries unless there is a product of two non-zero unfolding matrix entries
-	//Apologies for lack of better index labels, but probably best just to stick with the notation in D'Agostini's paper
-	unsigned int firstEntryNumber = InputUnfolding->GetEntryNumberAndResetIterator();
-	unsigned int percentIncrement = ceil( (double)firstEntryNumber / (double)PERCENT_PROGRESS_INCREMENT );
-	unsigned int currentPercentTarget = PERCENT_PROGRESS_INCREMENT;
-	unsigned int currentEntryTarget = percentIncrement;
-	cout << "PROGRESS:";
-	for ( unsigned int firstEntryIndex = 0; firstEntryIndex < firstEntryNumber; firstEntryIndex++ )
+	if ( JustVariance )
 	{
-		///Get a non-zero unfolding matrix entry
-		unsigned int k, i;
-		double firstEntryValue = InputUnfolding->GetNextEntry( k, i );
+		//Construct a sparse matrix for the smearing covariance, and sum over the pairs of unfolding matrix entries in each row
+		rsuMatrix = new SmearingCovariance( InputSmearing, InputUnfolding );
 
-		//Check that the corresponding data bin is non-zero
-		double dataI = DataDistribution->GetBinNumber( i );
-		if ( dataI > 0.0 )
+		//The covariance matrix will have zero entries unless there is a product of two non-zero unfolding matrix entries
+		//Apologies for lack of better index labels, but probably best just to stick with the notation in D'Agostini's paper
+		const unsigned int * rowStarts = InputUnfolding->GetRowStarts();
+		const unsigned int * effectIndices = InputUnfolding->GetSecondIndices();
+		const double * unfoldingValues = InputUnfolding->GetValues();
+		unsigned int firstEntryNumber = rowStarts[ binNumber ];
+		unsigned int percentIncrement = ceil( (double)firstEntryNumber / (double)PERCENT_PROGRESS_INCREMENT );
+		unsigned int currentPercentTarget = PERCENT_PROGRESS_INCREMENT;
+		unsigned int currentEntryTarget = percentIncrement;
+		cout << "PROGRESS:";
+		for ( unsigned int k = 0; k < binNumber; k++ )
 		{
-			//Multiply by the data value
-			firstEntryValue *= dataI;
-
-			//Check to see if we only need the diagonal elements
-			if ( JustVariance )
+			for ( unsigned int firstEntryIndex = rowStarts[ k ]; firstEntryIndex < rowStarts[ k + 1 ]; firstEntryIndex++ )
 			{
-				//Get all entries with the same cause index
-				vector< unsigned int > * jIndices = InputUnfolding->GetIndicesWithFirstIndex( k );
-				vector< double > * secondEntryValues = InputUnfolding->GetEntriesWithFirstIndex( k );
+				///Get a non-zero unfolding matrix entry
+				unsigned int i = effectIndices[ firstEntryIndex ];
+				double firstEntryValue = unfoldingValues[ firstEntryIndex ];
 
-				//Loop over these entries
-				for ( unsigned int secondEntryIndex = 0; secondEntryIndex < jIndices->size(); secondEntryIndex++ )
+				//Check that the corresponding data bin is non-zero
+				double dataI = DataDistribution->GetBinNumber( i );
+				if ( dataI > 0.0 )
 				{
-					unsigned int j = ( *jIndices )[ secondEntryIndex ];
+					//Multiply by the data value
+					firstEntryValue *= dataI;
 
-					//Check that the corresponding data bin is non-zero
-					double dataJ = DataDistribution->GetBinNumber( j );
-					if ( dataJ > 0.0 )
+					//Only the diagonal elements are needed
+					for ( unsigned int secondEntryIndex = rowStarts[ k ]; secondEntryIndex < rowStarts[ k + 1 ]; secondEntryIndex++ )
 					{
-						//Do the calculation
-						CovarianceCalculation( i, j, k, k, firstEntryValue * ( *secondEntryValues )[ secondEntryIndex ], dataI, dataJ );
+						unsigned int j = effectIndices[ secondEntryIndex ];
 
+						//Check that the corresponding data bin is non-zero
+						double dataJ = DataDistribution->GetBinNumber( j );
+						if ( dataJ > 0.0 )
+						{
+							//Do the calculation
+							CovarianceCalculation( i, j, k, k, firstEntryValue * unfoldingValues[ secondEntryIndex ], dataI, dataJ );
+						}
 					}
 				}
-			}
-			else
-			{
-				//Loop over all non-zero entries
-				unsigned int secondEntryNumber = InputUnfolding->GetEntryNumberAndResetIterator( true );
-				for ( unsigned int secondEntryIndex = 0; secondEntryIndex < secondEntryNumber; secondEntryIndex++ )
-				{
-					unsigned int l, j;
-					double secondEntryValue = InputUnfolding->GetNextEntry( l, j, true );
 
-					//Check that the corresponding data bin is non-zero
-					double dataJ = DataDistribution->GetBinNumber( j );
-					if ( dataJ > 0.0 )
-					{
-						//Do the calculation
-						CovarianceCalculation( i, j, k, l, firstEntryValue * secondEntryValue, dataI, dataJ );
-					}
+				//Progress indicator
+				if ( firstEntryIndex == currentEntryTarget )
+				{
+					cout << " " << currentPercentTarget << "%";
+					cout.flush();
+					currentPercentTarget += PERCENT_PROGRESS_INCREMENT;
+					currentEntryTarget += percentIncrement;
 				}
 			}
 		}
-
-		//Progress indicator
-		if ( firstEntryIndex == currentEntryTarget )
-		{
-			cout << " " << currentPercentTarget << "%";
-			cout.flush();
-			currentPercentTarget += PERCENT_PROGRESS_INCREMENT;
-			currentEntryTarget += percentIncrement;
-		}
 	}
-	VectorsFromMap( InputUnfolding->GetBinNumber() );
+	else
+	{
+		//The full matrix would need every pair of unfolding matrix entries, so use matrix products instead
+		rsuMatrix = 0;
+		FullCovariance( DataDistribution );
+	}
+	VectorsFromMap( binNumber );
 
 	//Status message
 	time(&timeNow);
@@ -141,6 +133,286 @@ void CovarianceMatrix::CovarianceCalculation( unsigned int I, unsigned int J, un
 	AddToEntry( K, L, covarianceContribution );
 }
 
+//The full covariance matrix written as sparse matrix products, rather than summing over every pair of unfolding matrix entries
+//The notation follows D'Agostini's paper: unfolding matrix M(k,i), smearing matrix P(r|u) from T(u) truth events with efficiency e(u), data n(i)
+//With A(k,i) = M(k,i) n(i) and x(k) = sum_i A(k,i), the data contribution is A diag(1/n) A^T - x x^T / N
+//The smearing contribution is sum_u G(u) Cov(u) G(u)^T, where Cov(u) is the multinomial covariance of smearing row u
+//and G(k,(u,r)) = sum_i A(k,i) dM(k,i)/dP(r|u) / M(k,i) = A(k,r) d(u,r) + [k==u] c(k,r), with d(u,r) = -M(u,r) e(u) / P(r|u)
+//and c(k,r) = A(k,r) / P(r|k) - x(k) / e(k). Expanding Cov(u) = ( diag(P(r|u)) - P(r|u) P(s|u) ) / T(u) gives
+//A diag(b) A^T + Q A^T + A Q^T + diag(g) - H diag(1/T) H^T, with b(r) = sum_u P(r|u) d(u,r)^2 / T(u), Q(k,r) = P(r|k) c(k,r) d(k,r) / T(k),
+//g(k) = sum_r P(r|k) c(k,r)^2 / T(k) and H(k,u) = sum_r A(k,r) P(r|u) d(u,r) + [k==u] sum_r P(r|k) c(k,r)
+void CovarianceMatrix::FullCovariance( Distribution * DataDistribution )
+{
+	const unsigned int * unfoldingRowStarts = inputUnfolding->GetRowStarts();
+	const unsigned int * unfoldingIndices = inputUnfolding->GetSecondIndices();
+	const double * unfoldingValues = inputUnfolding->GetValues();
+	const unsigned int * smearingRowStarts = inputSmearing->GetRowStarts();
+	const unsigned int * smearingIndices = inputSmearing->GetSecondIndices();
+	const double * smearingValues = inputSmearing->GetValues();
+
+	//Read the data
+	dataValues = vector< double >( binNumber, 0.0 );
+	for ( unsigned int i = 0; i < binNumber; i++ )
+	{
+		dataValues[ i ] = DataDistribution->GetBinNumber( i );
+	}
+
+	//Multiply the unfolding matrix by the data, ignoring empty data bins
+	unfoldedData = vector< vector< pair< unsigned int, double > > >( binNumber );
+	unfoldedDataByEffect = vector< vector< pair< unsigned int, double > > >( binNumber );
+	unfoldedSums = vector< double >( binNumber, 0.0 );
+	hasData = vector< bool >( binNumber, false );
+	for ( unsigned int k = 0; k < binNumber; k++ )
+	{
+		for ( unsigned int entryIndex = unfoldingRowStarts[ k ]; entryIndex < unfoldingRowStarts[ k + 1 ]; entryIndex++ )
+		{
+			unsigned int i = unfoldingIndices[ entryIndex ];
+			if ( dataValues[ i ] > 0.0 )
+			{
+				double value = unfoldingValues[ entryIndex ] * dataValues[ i ];
+				unfoldedData[ k ].push_back( make_pair( i, value ) );
+				unfoldedDataByEffect[ i ].push_back( make_pair( k, value ) );
+				unfoldedSums[ k ] += value;
+				hasData[ k ] = true;
+			}
+		}
+	}
+
+	//Work through the smearing matrix one cause at a time
+	truthTotals = vector< double >( binNumber, 0.0 );
+	dataWeights = vector< double >( binNumber, 0.0 );
+	diagonalTerms = vector< double >( binNumber, 0.0 );
+	centralTerms = vector< double >( binNumber, 0.0 );
+	crossTerms = vector< vector< pair< unsigned int, double > > >( binNumber );
+	crossTermsByEffect = vector< vector< pair< unsigned int, double > > >( binNumber );
+	weightedResponseByEffect = vector< vector< pair< unsigned int, double > > >( binNumber );
+	vector< double > unfoldedRow( binNumber, 0.0 );
+	for ( unsigned int u = 0; u < binNumber; u++ )
+	{
+		double efficiency = inputSmearing->GetEfficiency( u );
+		truthTotals[ u ] = inputSmearing->GetTruthTotal( u );
+
+		//Unpack this row of A
+		for ( unsigned int entryIndex = 0; entryIndex < unfoldedData[ u ].size(); entryIndex++ )
+		{
+			unfoldedRow[ unfoldedData[ u ][ entryIndex ].first ] = unfoldedData[ u ][ entryIndex ].second;
+		}
+
+		for ( unsigned int entryIndex = smearingRowStarts[ u ]; entryIndex < smearingRowStarts[ u + 1 ]; entryIndex++ )
+		{
+			unsigned int r = smearingIndices[ entryIndex ];
+			double smearingValue = smearingValues[ entryIndex ];
+			double oneOverSmearing = 1.0 / smearingValue;
+			double deltaUR = -inputUnfolding->GetElement( u, r ) * efficiency * oneOverSmearing;
+
+			//Terms that do not need k == u
+			dataWeights[ r ] += smearingValue * deltaUR * deltaUR / truthTotals[ u ];
+			weightedResponseByEffect[ r ].push_back( make_pair( u, smearingValue * deltaUR ) );
+
+			//Terms for k == u, which are zero without data
+			if ( hasData[ u ] )
+			{
+				double central = unfoldedRow[ r ] * oneOverSmearing - unfoldedSums[ u ] / efficiency;
+				double crossTerm = smearingValue * central * deltaUR / truthTotals[ u ];
+				crossTerms[ u ].push_back( make_pair( r, crossTerm ) );
+				crossTermsByEffect[ r ].push_back( make_pair( u, crossTerm ) );
+				diagonalTerms[ u ] += smearingValue * central * central / truthTotals[ u ];
+				centralTerms[ u ] += smearingValue * central;
+			}
+		}
+
+		//Reset the scratch space
+		for ( unsigned int entryIndex = 0; entryIndex < unfoldedData[ u ].size(); entryIndex++ )
+		{
+			unfoldedRow[ unfoldedData[ u ][ entryIndex ].first ] = 0.0;
+		}
+	}
+
+	//The data contribution shares the A diag(b) A^T product
+	for ( unsigned int i = 0; i < binNumber; i++ )
+	{
+		if ( dataValues[ i ] > 0.0 )
+		{
+			dataWeights[ i ] += 1.0 / dataValues[ i ];
+		}
+	}
+
+	//Calculate H, and its transpose for the H diag(1/T) H^T product
+	responseDerivatives = vector< vector< pair< unsigned int, double > > >( binNumber );
+	ParallelRows( &CovarianceMatrix::ResponseDerivativeRow );
+	responseDerivativesByCause = vector< vector< pair< unsigned int, double > > >( binNumber );
+	for ( unsigned int k = 0; k < binNumber; k++ )
+	{
+		for ( unsigned int entryIndex = 0; entryIndex < responseDerivatives[ k ].size(); entryIndex++ )
+		{
+			responseDerivativesByCause[ responseDerivatives[ k ][ entryIndex ].first ].push_back( make_pair( k, responseDerivatives[ k ][ entryIndex ].second ) );
+		}
+	}
+
+	//Calculate the covariance
+	covarianceRows = vector< vector< pair< unsigned int, double > > >( binNumber );
+	ParallelRows( &CovarianceMatrix::CovarianceRow );
+
+	//Store the results - the rows are already in order
+	for ( unsigned int k = 0; k < binNumber; k++ )
+	{
+		for ( unsigned int entryIndex = 0; entryIndex < covarianceRows[ k ].size(); entryIndex++ )
+		{
+			AddToEntry( k, covarianceRows[ k ][ entryIndex ].first, covarianceRows[ k ][ entryIndex ].second );
+		}
+	}
+
+	//Release the intermediate products
+	vector< vector< pair< unsigned int, double > > >().swap( unfoldedData );
+	vector< vector< pair< unsigned int, double > > >().swap( unfoldedDataByEffect );
+	vector< vector< pair< unsigned int, double > > >().swap( crossTerms );
+	vector< vector< pair< unsigned int, double > > >().swap( crossTermsByEffect );
+	vector< vector< pair< unsigned int, double > > >().swap( weightedResponseByEffect );
+	vector< vector< pair< unsigned int, double > > >().swap( responseDerivatives );
+	vector< vector< pair< unsigned int, double > > >().swap( responseDerivativesByCause );
+	vector< vector< pair< unsigned int, double > > >().swap( covarianceRows );
+}
+
+//Set the number of threads used for the full covariance calculation (0 = one for each processor core)
+void CovarianceMatrix::SetThreadNumber( unsigned int ThreadNumber )
+{
+	rowThreadNumber = ThreadNumber;
+}
+
+//Share the rows of a calculation between threads
+void CovarianceMatrix::ParallelRows( void ( CovarianceMatrix::*RowMethod )( unsigned int, vector< double > & ) )
+{
+	unsigned int threadNumber = rowThreadNumber;
+	if ( threadNumber == 0 )
+	{
+		threadNumber = thread::hardware_concurrency();
+	}
+	if ( threadNumber > binNumber )
+	{
+		threadNumber = binNumber;
+	}
+	if ( threadNumber == 0 )
+	{
+		threadNumber = 1;
+	}
+
+	//Interleave the rows, since the work per row is uneven
+	vector< thread > workers;
+	for ( unsigned int threadIndex = 1; threadIndex < threadNumber; threadIndex++ )
+	{
+		workers.push_back( thread( &CovarianceMatrix::RowWorker, this, RowMethod, threadIndex, threadNumber ) );
+	}
+
+	//Use this thread as well
+	RowWorker( RowMethod, 0, threadNumber );
+	for ( unsigned int threadIndex = 0; threadIndex < workers.size(); threadIndex++ )
+	{
+		workers[ threadIndex ].join();
+	}
+}
+void CovarianceMatrix::RowWorker( void ( CovarianceMatrix::*RowMethod )( unsigned int, vector< double > & ), unsigned int FirstRow, unsigned int RowStep )
+{
+	vector< double > rowValues( binNumber, 0.0 );
+	for ( unsigned int rowIndex = FirstRow; rowIndex < binNumber; rowIndex += RowStep )
+	{
+		( this->*RowMethod )( rowIndex, rowValues );
+	}
+}
+
+//H(k,u) = sum_r A(k,r) P(r|u) d(u,r) + [k==u] sum_r P(r|k) c(k,r)
+void CovarianceMatrix::ResponseDerivativeRow( unsigned int K, vector< double > & RowValues )
+{
+	if ( !hasData[ K ] )
+	{
+		return;
+	}
+
+	for ( unsigned int entryIndex = 0; entryIndex < unfoldedData[ K ].size(); entryIndex++ )
+	{
+		unsigned int r = unfoldedData[ K ][ entryIndex ].first;
+		double value = unfoldedData[ K ][ entryIndex ].second;
+		for ( unsigned int responseIndex = 0; responseIndex < weightedResponseByEffect[ r ].size(); responseIndex++ )
+		{
+			RowValues[ weightedResponseByEffect[ r ][ responseIndex ].first ] += value * weightedResponseByEffect[ r ][ responseIndex ].second;
+		}
+	}
+	RowValues[ K ] += centralTerms[ K ];
+
+	//Keep the non-zero entries, and reset the scratch space
+	for ( unsigned int u = 0; u < binNumber; u++ )
+	{
+		if ( RowValues[ u ] != 0.0 )
+		{
+			responseDerivatives[ K ].push_back( make_pair( u, RowValues[ u ] ) );
+			RowValues[ u ] = 0.0;
+		}
+	}
+}
+
+//One row of A diag(b + 1/n) A^T + Q A^T + A Q^T + diag(g) - H diag(1/T) H^T - x x^T / N
+void CovarianceMatrix::CovarianceRow( unsigned int K, vector< double > & RowValues )
+{
+	//Without data, the row is empty
+	if ( !hasData[ K ] )
+	{
+		return;
+	}
+
+	for ( unsigned int entryIndex = 0; entryIndex < unfoldedData[ K ].size(); entryIndex++ )
+	{
+		unsigned int r = unfoldedData[ K ][ entryIndex ].first;
+		double value = unfoldedData[ K ][ entryIndex ].second;
+
+		//A diag(b + 1/n) A^T
+		double weightedValue = value * dataWeights[ r ];
+		for ( unsigned int otherIndex = 0; otherIndex < unfoldedDataByEffect[ r ].size(); otherIndex++ )
+		{
+			RowValues[ unfoldedDataByEffect[ r ][ otherIndex ].first ] += weightedValue * unfoldedDataByEffect[ r ][ otherIndex ].second;
+		}
+
+		//A Q^T
+		for ( unsigned int otherIndex = 0; otherIndex < crossTermsByEffect[ r ].size(); otherIndex++ )
+		{
+			RowValues[ crossTermsByEffect[ r ][ otherIndex ].first ] += value * crossTermsByEffect[ r ][ otherIndex ].second;
+		}
+	}
+
+	//Q A^T
+	for ( unsigned int entryIndex = 0; entryIndex < crossTerms[ K ].size(); entryIndex++ )
+	{
+		unsigned int r = crossTerms[ K ][ entryIndex ].first;
+		double value = crossTerms[ K ][ entryIndex ].second;
+		for ( unsigned int otherIndex = 0; otherIndex < unfoldedDataByEffect[ r ].size(); otherIndex++ )
+		{
+			RowValues[ unfoldedDataByEffect[ r ][ otherIndex ].first ] += value * unfoldedDataByEffect[ r ][ otherIndex ].second;
+		}
+	}
+
+	//diag(g)
+	RowValues[ K ] += diagonalTerms[ K ];
+
+	//H diag(1/T) H^T
+	for ( unsigned int entryIndex = 0; entryIndex < responseDerivatives[ K ].size(); entryIndex++ )
+	{
+		unsigned int u = responseDerivatives[ K ][ entryIndex ].first;
+		double value = responseDerivatives[ K ][ entryIndex ].second / truthTotals[ u ];
+		for ( unsigned int otherIndex = 0; otherIndex < responseDerivativesByCause[ u ].size(); otherIndex++ )
+		{
+			RowValues[ responseDerivativesByCause[ u ][ otherIndex ].first ] -= value * responseDerivativesByCause[ u ][ otherIndex ].second;
+		}
+	}
+
+	//x x^T / N, then store the row wherever there is data, and reset the scratch space
+	for ( unsigned int l = 0; l < binNumber; l++ )
+	{
+		if ( hasData[ l ] )
+		{
+			covarianceRows[ K ].push_back( make_pair( l, RowValues[ l ] - ( unfoldedSums[ K ] * unfoldedSums[ l ] / correctedSum ) ) );
+		}
+		RowValues[ l ] = 0.0;
+	}
+}
+
 CovarianceMatrix::~CovarianceMatrix()
 {
 }
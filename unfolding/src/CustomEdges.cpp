@@ -0,0 +1,90 @@
+/**
+  @class CustomEdges
+
+  The bins in one dimension, with custom widths - for use with FixedIndices
+  Puts values in the same bins as CustomIndices
+ */
+
+#include "CustomEdges.h"
+#include <iostream>
+#include <cstdlib>
+
+//Default constructor
+CustomEdges::CustomEdges()
+{
+}
+
+//Constructor taking the bin edges, which must be in increasing order
+CustomEdges::CustomEdges( const vector< double > & LowEdges )
+{
+	//Check for adjacent bin edges being equal or not correctly ordered
+	for ( unsigned int binIndex = 0; binIndex + 1 < LowEdges.size(); binIndex++ )
+	{
+		double lowEdge = LowEdges[ binIndex ];
+		double highEdge = LowEdges[ binIndex + 1 ];
+		if ( lowEdge > highEdge )
+		{
+			cerr << "Input histogram bin edges are not ordered correctly: " << lowEdge << " > " << highEdge << endl;
+			cerr << "To avoid ambiguity, please resolve this manually" << endl;
+			exit(1);
+		}
+		else if ( lowEdge == highEdge )
+		{
+			cerr << "Two histogram bins given the same low edge: " << lowEdge << endl;
+			cerr << "Either you copy-and-pasted incautiously, or you had a really clever idea you thought you'd try" << endl;
+			cerr << "Regardless, it won't work: please fix this" << endl;
+			exit(1);
+		}
+	}
+	if ( LowEdges.size() < 2 )
+	{
+		cerr << "At least two bin edges are needed to make a bin" << endl;
+		exit(1);
+	}
+
+	edges = LowEdges;
+	search = BinEdgeSearch( edges );
+}
+
+//Destructor
+CustomEdges::~CustomEdges()
+{
+}
+
+//Add the bin of each value, times the multiplier, to the indices
+void CustomEdges::AddBins( const double * Values, unsigned int ValueNumber, unsigned int Multiplier, unsigned int * Indices ) const
+{
+	search.AddBins( Values, ValueNumber, Multiplier, Indices );
+}
+
+//The number of bins, not including under and overflow
+unsigned int CustomEdges::BinNumber() const
+{
+	return edges.size() - 1;
+}
+
+//The low edge of each bin, and the high edge of the last
+const vector< double > & CustomEdges::Edges() const
+{
+	return edges;
+}
+
+//A central value for a bin with no events in it
+double CustomEdges::EmptyBinCentre( unsigned int BinIndex ) const
+{
+	if ( BinIndex == 0 )
+	{
+		//Underflow bin, just pick lowest bin edge - 1
+		return edges[ 0 ] - 1.0;
+	}
+	else if ( BinIndex == BinNumber() + 1 )
+	{
+		//Overflow bin, just pick highest bin edge + 1
+		return edges[ BinIndex - 1 ] + 1.0;
+	}
+	else
+	{
+		//Regular bin
+		return ( edges[ BinIndex - 1 ] + edges[ BinIndex ] ) * 0.5;
+	}
+}
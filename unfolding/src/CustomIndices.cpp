@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
 using namespace std;
 
@@ -29,9 +30,6 @@ CustomIndices::CustomIndices( const vector< vector< double > > & LowEdges )
 	//Check the bins are in order
 	for ( unsigned int dimensionIndex = 0; dimensionIndex < numberOfDimensions; dimensionIndex++ )
 	{
-		//Make a map for looking up the bin edges
-		map< double, unsigned int > thisEdgeMap;
-
 		//Check for adjacent bin edges being equal or not correctly ordered
 		for ( unsigned int binIndex = 0; binIndex < LowEdges[ dimensionIndex ].size() - 1; binIndex++ )
 		{
@@ -50,14 +48,10 @@ CustomIndices::CustomIndices( const vector< vector< double > > & LowEdges )
 				cerr << "Regardless, it won't work: please fix this" << endl;
 				exit(1);
 			}
-			else
-			{
-				thisEdgeMap[ highEdge ] = binIndex;
-			}
 		}
 
-		//Store the map
-		binHighEdgeMaps.push_back( thisEdgeMap );
+		//Make the search for looking up the bin edges
+		binEdgeSearches.push_back( BinEdgeSearch( LowEdges[ dimensionIndex ] ) );
 
 		//Store the number of bins in this dimension (one fewer bin than edge)
 		numberOfBins.push_back( LowEdges[ dimensionIndex ].size() - 1 );
@@ -87,28 +81,32 @@ IIndexCalculator * CustomIndices::Clone()
 CustomIndices::~CustomIndices()
 {
 	//binLowEdges.clear();
-	binHighEdgeMaps.clear();
+	binEdgeSearches.clear();
 	numberOfBins.clear();
 }
 
 //Return the bin number / index corresponding to a given value
 unsigned int CustomIndices::GetIndex( const vector< double > & InputValues )
+{
+	return GetIndex( &InputValues[0], InputValues.size() );
+}
+unsigned int CustomIndices::GetIndex( const double * InputValues, unsigned int ValueNumber )
 {
 	//Stupidity check
-	if ( numberOfDimensions != InputValues.size() )
+	if ( numberOfDimensions != ValueNumber )
 	{
-		cerr << "Using a " << InputValues.size() << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
+		cerr << "Using a " << ValueNumber << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
 		exit(1);
 	}
 	else
 	{
 		//Loop over all dimensions
 		unsigned int totalIndex = 0;
-		int binMultiplier = 1;
+		unsigned int binMultiplier = 1;
 		for ( unsigned int dimensionIndex = 0; dimensionIndex < numberOfDimensions; dimensionIndex++ )
 		{
 			//Add to the total index
-			totalIndex += GetOneDimensionIndex( InputValues[ dimensionIndex ], dimensionIndex ) * (double)binMultiplier;
+			totalIndex += GetOneDimensionIndex( InputValues[ dimensionIndex ], dimensionIndex ) * binMultiplier;
 			binMultiplier *= ( numberOfBins[ dimensionIndex ] + 2 );
 		}
 
@@ -116,6 +114,26 @@ unsigned int CustomIndices::GetIndex( const vector< double > & InputValues )
 	}
 }
 
+//Return the bin index for each of a set of events, given an array of values for each dimension
+void CustomIndices::GetIndices( const double * const * InputColumns, unsigned int ValueNumber, unsigned int EventNumber, unsigned int * OutputIndices )
+{
+	//Stupidity check - once for all the events
+	if ( numberOfDimensions != ValueNumber )
+	{
+		cerr << "Using a " << ValueNumber << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
+		exit(1);
+	}
+
+	//Work through one dimension at a time, adding to the index of every event
+	fill( OutputIndices, OutputIndices + EventNumber, 0 );
+	unsigned int binMultiplier = 1;
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < numberOfDimensions; dimensionIndex++ )
+	{
+		binEdgeSearches[ dimensionIndex ].AddBins( InputColumns[ dimensionIndex ], EventNumber, binMultiplier, OutputIndices );
+		binMultiplier *= ( numberOfBins[ dimensionIndex ] + 2 );
+	}
+}
+
 //Return the bin number in each dimension
 vector< unsigned int > CustomIndices::GetNDimensionalIndex( const vector< double > & InputValues )
 {
@@ -247,42 +265,31 @@ unsigned int CustomIndices::GetBinNumber( unsigned int DimensionIndex )
 }
 
 //Return the index in a given dimension
-unsigned int CustomIndices::GetOneDimensionIndex( double Value, unsigned int Dimension )
+//The search includes the under and overflow bins, and doesn't change anything, so it's safe to use from many threads
+unsigned int CustomIndices::GetOneDimensionIndex( double Value, unsigned int Dimension ) const
 {
-	if ( Value <= binLowEdges[ Dimension ][ 0 ] )
-	{
-		//Underflow bin
-		return 0;
-	}
-	else
-	{
-		//Returns an iterator pointing to the first element in the container whose key compares greater than the value
-		searchIterator = binHighEdgeMaps[ Dimension ].upper_bound( Value );
-
-		if ( searchIterator == binHighEdgeMaps[ Dimension ].end() )
-		{
-			//Overflow
-			return numberOfBins[ Dimension ] + 1;
-		}
-		else
-		{
-			//Regular bin: add one beacuse of the underflow bin
-			return searchIterator->second + 1;
-		}
-	}
+	return binEdgeSearches[ Dimension ].FindBin( Value );
 }
 
 //Input the data to calculate the central values
 void CustomIndices::StoreDataValue( const vector< double > & Data, double Weight )
 {
-	//Find out the bin that the event falls into in each dimension
-	vector< unsigned int > binIndices = GetNDimensionalIndex( Data );
+	StoreDataValue( &Data[0], Data.size(), Weight );
+}
+void CustomIndices::StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight )
+{
+	//Stupidity check
+	if ( numberOfDimensions != ValueNumber )
+	{
+		cerr << "Using a " << ValueNumber << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
+		exit(1);
+	}
 
 	//Loop over dimensions
-	for ( unsigned int dimensionIndex = 0; dimensionIndex < binIndices.size(); dimensionIndex++ )
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < numberOfDimensions; dimensionIndex++ )
 	{
 		//Find out the index of the bin the event falls into in this dimension
-		unsigned int binIndex = binIndices[dimensionIndex];
+		unsigned int binIndex = GetOneDimensionIndex( Data[ dimensionIndex ], dimensionIndex );
 
 		//Add the event to the bin in this dimension
 		binValueSums[ dimensionIndex ][ binIndex ] += Data[ dimensionIndex ] * Weight;
@@ -9,6 +9,7 @@
 
 #include "Distribution.h"
 #include "UnfoldingMatrix.h"
+#include "SmoothingStencil.h"
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
@@ -74,17 +75,18 @@ Distribution::Distribution( Distribution * DataDistribution, UnfoldingMatrix * B
 	integral = 0.0;
 
 	//Populate the distribution
-	unsigned int entryNumber = BayesPosterior->GetEntryNumberAndResetIterator();
-	for ( unsigned int unfoldingIndex = 0; unfoldingIndex < entryNumber; unfoldingIndex++ )
+	const unsigned int * rowStarts = BayesPosterior->GetRowStarts();
+	const unsigned int * effectIndices = BayesPosterior->GetSecondIndices();
+	const double * unfoldingValues = BayesPosterior->GetValues();
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
 	{
-		//Retrieve the unfolding matrix entry
-		unsigned int causeIndex, effectIndex;
-		double unfoldingValue = BayesPosterior->GetNextEntry( causeIndex, effectIndex );
-
-		//Apply the unfolding
-		double newValue = unfoldingValue * DataDistribution->GetBinNumber( effectIndex );
-		binValues[ causeIndex ] += newValue;
-		integral += newValue;
+		for ( unsigned int unfoldingIndex = rowStarts[ causeIndex ]; unfoldingIndex < rowStarts[ causeIndex + 1 ]; unfoldingIndex++ )
+		{
+			//Apply the unfolding
+			double newValue = unfoldingValues[ unfoldingIndex ] * DataDistribution->binValues[ effectIndices[ unfoldingIndex ] ];
+			binValues[ causeIndex ] += newValue;
+			integral += newValue;
+		}
 	}
 }
 
@@ -102,20 +104,183 @@ Distribution::Distribution( Distribution * InputDistribution, SmearingMatrix * S
 	integral = 0.0;
 
 	//Loop over each entry in the smearing matrix
-	unsigned int entryNumber = Smearing->GetEntryNumberAndResetIterator();
-	for ( unsigned int smearingIndex = 0; smearingIndex < entryNumber; smearingIndex++ )
+	const unsigned int * rowStarts = Smearing->GetRowStarts();
+	const unsigned int * effectIndices = Smearing->GetSecondIndices();
+	const double * smearingValues = Smearing->GetValues();
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
+	{
+		double causeValue = InputDistribution->binValues[ causeIndex ];
+		for ( unsigned int smearingIndex = rowStarts[ causeIndex ]; smearingIndex < rowStarts[ causeIndex + 1 ]; smearingIndex++ )
+		{
+			//Calculate the smearing
+			double newValue = smearingValues[ smearingIndex ] * causeValue;
+			binValues[ effectIndices[ smearingIndex ] ] += newValue;
+			integral += newValue;
+		}
+	}
+}
+
+//Overwrite this distribution with one Bayesian unfolding iteration of the data, using the given prior
+void Distribution::Unfold( Distribution * DataDistribution, SmearingMatrix * Smearing, Distribution * PriorDistribution, vector< double > & EffectWorkspace )
+{
+	//Get the number of bins in the distribution (include a bad bin)
+	unsigned int binNumber = indexCalculator->GetBinNumber() + 1;
+
+	//Read the smearing matrix entries
+	const unsigned int * rowStarts = Smearing->GetRowStarts();
+	const unsigned int * effectIndices = Smearing->GetSecondIndices();
+	const double * smearingValues = Smearing->GetValues();
+	const vector< double > & priorValues = PriorDistribution->binValues;
+	double priorIntegral = PriorDistribution->integral;
+
+	//Calculate the probabilities of the effects
+	EffectWorkspace.assign( binNumber, 0.0 );
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
+	{
+		double causeProbability = priorValues[ causeIndex ] / priorIntegral;
+		for ( unsigned int smearingIndex = rowStarts[ causeIndex ]; smearingIndex < rowStarts[ causeIndex + 1 ]; smearingIndex++ )
+		{
+			EffectWorkspace[ effectIndices[ smearingIndex ] ] += smearingValues[ smearingIndex ] * causeProbability;
+		}
+	}
+
+	//Replace each effect probability with the ratio of data to expectation
+	for ( unsigned int effectIndex = 0; effectIndex < binNumber; effectIndex++ )
+	{
+		if ( EffectWorkspace[ effectIndex ] != 0.0 )
+		{
+			EffectWorkspace[ effectIndex ] = DataDistribution->binValues[ effectIndex ] / EffectWorkspace[ effectIndex ];
+		}
+	}
+
+	//Populate the distribution
+	integral = 0.0;
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
 	{
-		//Retrieve the smearing matrix entry
-		unsigned int causeIndex, effectIndex;
-		double smearingValue = Smearing->GetNextEntry( causeIndex, effectIndex );
+		//Ignore zero entries, and causes that are never reconstructed (an empty smearing row has no efficiency)
+		double newValue = 0.0;
+		double causeProbability = priorValues[ causeIndex ] / priorIntegral;
+		double efficiency = Smearing->GetEfficiency( causeIndex );
+		if ( causeProbability != 0.0 && efficiency != 0.0 )
+		{
+			for ( unsigned int smearingIndex = rowStarts[ causeIndex ]; smearingIndex < rowStarts[ causeIndex + 1 ]; smearingIndex++ )
+			{
+				newValue += smearingValues[ smearingIndex ] * EffectWorkspace[ effectIndices[ smearingIndex ] ];
+			}
+			newValue *= causeProbability / efficiency;
+		}
 
-		//Calculate the smearing
-		double newValue = smearingValue * InputDistribution->GetBinNumber( causeIndex );
-		binValues[ effectIndex ] += newValue;
+		binValues[ causeIndex ] = newValue;
 		integral += newValue;
 	}
 }
 
+//Overwrite each of the result distributions with one Bayesian unfolding iteration, reading the smearing matrix only once
+void Distribution::UnfoldBatch( const vector< Distribution* > & Results, const vector< Distribution* > & DataDistributions, SmearingMatrix * Smearing,
+		const vector< Distribution* > & PriorDistributions, vector< double > & Workspace )
+{
+	unsigned int columnNumber = Results.size();
+	if ( columnNumber == 0 )
+	{
+		return;
+	}
+	if ( DataDistributions.size() != columnNumber || PriorDistributions.size() != columnNumber )
+	{
+		cerr << "Distribution number mismatch in batch unfolding: " << columnNumber << " results, " << DataDistributions.size() << " data, " << PriorDistributions.size() << " priors" << endl;
+		exit(1);
+	}
+
+	//Get the number of bins in the distribution (include a bad bin)
+	unsigned int binNumber = Smearing->GetBinNumber();
+
+	//Read the smearing matrix entries
+	const unsigned int * rowStarts = Smearing->GetRowStarts();
+	const unsigned int * effectIndices = Smearing->GetSecondIndices();
+	const double * smearingValues = Smearing->GetValues();
+
+	//Make three dense bin-by-distribution matrices: cause probabilities, effect probabilities, and results
+	unsigned int matrixSize = binNumber * columnNumber;
+	Workspace.assign( 3 * matrixSize, 0.0 );
+	double * causeProbabilities = &Workspace[ 0 ];
+	double * effectProbabilities = &Workspace[ matrixSize ];
+	double * newValues = &Workspace[ 2 * matrixSize ];
+
+	//Pack the prior probabilities
+	for ( unsigned int columnIndex = 0; columnIndex < columnNumber; columnIndex++ )
+	{
+		const vector< double > & priorValues = PriorDistributions[ columnIndex ]->binValues;
+		double priorIntegral = PriorDistributions[ columnIndex ]->integral;
+		for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
+		{
+			causeProbabilities[ causeIndex * columnNumber + columnIndex ] = priorValues[ causeIndex ] / priorIntegral;
+		}
+	}
+
+	//Calculate the probabilities of the effects
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
+	{
+		const double * causeRow = causeProbabilities + causeIndex * columnNumber;
+		for ( unsigned int smearingIndex = rowStarts[ causeIndex ]; smearingIndex < rowStarts[ causeIndex + 1 ]; smearingIndex++ )
+		{
+			double smearingValue = smearingValues[ smearingIndex ];
+			double * effectRow = effectProbabilities + effectIndices[ smearingIndex ] * columnNumber;
+			for ( unsigned int columnIndex = 0; columnIndex < columnNumber; columnIndex++ )
+			{
+				effectRow[ columnIndex ] += smearingValue * causeRow[ columnIndex ];
+			}
+		}
+	}
+
+	//Replace each effect probability with the ratio of data to expectation
+	for ( unsigned int columnIndex = 0; columnIndex < columnNumber; columnIndex++ )
+	{
+		const vector< double > & dataValues = DataDistributions[ columnIndex ]->binValues;
+		for ( unsigned int effectIndex = 0; effectIndex < binNumber; effectIndex++ )
+		{
+			double & effectValue = effectProbabilities[ effectIndex * columnNumber + columnIndex ];
+			if ( effectValue != 0.0 )
+			{
+				effectValue = dataValues[ effectIndex ] / effectValue;
+			}
+		}
+	}
+
+	//Calculate the new cause distributions
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
+	{
+		double * newRow = newValues + causeIndex * columnNumber;
+		for ( unsigned int smearingIndex = rowStarts[ causeIndex ]; smearingIndex < rowStarts[ causeIndex + 1 ]; smearingIndex++ )
+		{
+			double smearingValue = smearingValues[ smearingIndex ];
+			const double * effectRow = effectProbabilities + effectIndices[ smearingIndex ] * columnNumber;
+			for ( unsigned int columnIndex = 0; columnIndex < columnNumber; columnIndex++ )
+			{
+				newRow[ columnIndex ] += smearingValue * effectRow[ columnIndex ];
+			}
+		}
+	}
+
+	//Unpack the results, ignoring zero entries in the prior and causes with no efficiency, as in Unfold
+	for ( unsigned int columnIndex = 0; columnIndex < columnNumber; columnIndex++ )
+	{
+		Distribution * result = Results[ columnIndex ];
+		result->integral = 0.0;
+		for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
+		{
+			double newValue = 0.0;
+			double causeProbability = causeProbabilities[ causeIndex * columnNumber + columnIndex ];
+			double efficiency = Smearing->GetEfficiency( causeIndex );
+			if ( causeProbability != 0.0 && efficiency != 0.0 )
+			{
+				newValue = newValues[ causeIndex * columnNumber + columnIndex ] * ( causeProbability / efficiency );
+			}
+
+			result->binValues[ causeIndex ] = newValue;
+			result->integral += newValue;
+		}
+	}
+}
+
 //Make this distribution by weighting each bin of another (i.e. bin-by-bin unfolding)
 Distribution::Distribution( Distribution * DataDistribution, const vector< double > & BinWeights )
 {
@@ -150,13 +315,34 @@ Distribution::~Distribution()
 }
 
 //Store an event
-void Distribution::StoreEvent( vector< double > Value, double Weight )
+void Distribution::StoreEvent( const vector< double > & Value, double Weight )
+{
+	StoreEventInBin( indexCalculator->GetIndex( Value ), Weight );
+}
+
+//Store an event with the bin index already calculated
+void Distribution::StoreEventInBin( unsigned int BinIndex, double Weight )
 {
-	unsigned int binIndex = indexCalculator->GetIndex( Value );
-	binValues[ binIndex ] += Weight;
+	binValues[ BinIndex ] += Weight;
 	integral += Weight;
 }
 
+//Add the events stored in another distribution with the same binning
+void Distribution::AddEvents( const Distribution * Other )
+{
+	if ( binValues.size() != Other->binValues.size() )
+	{
+		cerr << "Trying to add distributions with different binning: " << binValues.size() << " vs " << Other->binValues.size() << " bins" << endl;
+		exit(1);
+	}
+
+	for ( unsigned int binIndex = 0; binIndex < binValues.size(); binIndex++ )
+	{
+		binValues[ binIndex ] += Other->binValues[ binIndex ];
+	}
+	integral += Other->integral;
+}
+
 void Distribution::StoreBadEvent( double Weight )
 {
 	binValues[ binValues.size() - 1 ] += Weight;
@@ -246,77 +432,23 @@ TH1F * Distribution::MakeRootHistogram( string Name, string Title, bool MakeNorm
 }
 
 //Smooth the distribution using moving average
-void Distribution::Smooth( unsigned int SideBinNumber )
+//The stencil for the binning is only worked out once, and the old values are kept to reuse their memory
+//NB: the old per-bin loop never ran (its unsigned counter started at -SideBinNumber), so it set every bin except the
+//first-dimension under/overflow to zero. Smoothed results from before the stencil are not comparable with these
+void Distribution::Smooth( unsigned int SideBinNumber, unsigned int DimensionIndex )
 {
-	unsigned int binNumber = indexCalculator->GetBinNumber();
-	vector< double > newBinValues;
-	vector< unsigned int > separateBinIndices, separateSumIndices;
-	double newIntegral = 0.0;
-
-	//Operate on all bins
-	for ( unsigned int binIndex = 0; binIndex < binNumber; binIndex++ )
-	{
-		//Don't smooth the over/underflow bins of the first dimension
-		separateBinIndices = indexCalculator->GetNDimensionalIndex( binIndex );
-		if ( separateBinIndices[0] == 0 || separateBinIndices[0] == indexCalculator->GetBinNumber(0) - 1 )
-		{
-			//Just copy the original value
-			newBinValues.push_back( binValues[ binIndex ] );
-			newIntegral += binValues[ binIndex ];
-		}
-		else
-		{
-			double binTotal = 0.0;
-
-			//Take the average of the local bins
-			for ( unsigned int localIndex = -SideBinNumber; localIndex <= SideBinNumber; localIndex++ )
-			{
-				unsigned int sumIndex = binIndex + localIndex;
-
-				//Can this bin be used in averaging?
-				bool useInAveraging = true;
-				separateSumIndices = indexCalculator->GetNDimensionalIndex( sumIndex );
-				if ( separateSumIndices[0] == 0 || separateSumIndices[0] == indexCalculator->GetBinNumber(0) - 1 )
-				{
-					useInAveraging = false;
-				}
-				else
-				{
-					for ( unsigned int dimensionIndex = 1; dimensionIndex < separateBinIndices.size(); dimensionIndex++ )
-					{
-						if ( separateSumIndices[ dimensionIndex ] != separateBinIndices[dimensionIndex] )
-						{
-							//Bins aren't in the same part of the distribution
-							useInAveraging = false;
-							break;
-						}
-					}
-				}
-
-				if ( sumIndex >= 0 && sumIndex < binNumber && useInAveraging )
-				{
-					//Use this bin in the averaging
-					binTotal += binValues[ sumIndex ];
-				}
-				else
-				{
-					//Derive an edge-preserving value instead
-					binTotal += ( 2.0 * binValues[ binIndex ] ) - binValues[binIndex - localIndex];
-				}
-			}
-
-			//Store the average as a new distribution
-			binTotal /= ( ( 2.0 * (double)SideBinNumber ) + 1 );
-			newBinValues.push_back(binTotal);
-			newIntegral += binTotal;
-		}
-	}
-
-	binValues = newBinValues;
-	integral = newIntegral;
+	SmoothingStencil * stencil = SmoothingStencil::GetStencil( indexCalculator, SideBinNumber, DimensionIndex );
+	integral = stencil->Apply( binValues, smoothedValues );
+	binValues.swap( smoothedValues );
 }
 
 double Distribution::Integral()
 {
 	return integral;
 }
+
+//The contents of every bin, including the under and overflow bins and the bad bin at the end
+const vector< double > & Distribution::GetBinValues() const
+{
+	return binValues;
+}
@@ -76,48 +76,84 @@ NoCorrection * NoCorrection::CloneShareSmearingMatrix()
 //value
 //NB: These values must both come from the SAME
 //Monte Carlo event, or the whole process is meaningless
-void NoCorrection::StoreTruthRecoPair( vector< double > Truth, vector< double > Reco, double TruthWeight, double RecoWeight, bool UseInPrior )
+void NoCorrection::StoreTruthRecoPair( const double * Truth, const double * Reco, unsigned int ValueNumber, double TruthWeight, double RecoWeight, bool UseInPrior )
+{
+	StoreTruthRecoPairBins( indexCalculator->GetIndex( Truth, ValueNumber ), indexCalculator->GetIndex( Reco, ValueNumber ), TruthWeight, RecoWeight, UseInPrior );
+}
+void NoCorrection::StoreTruthRecoPairBins( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight, double RecoWeight, bool UseInPrior )
 {
 	if (UseInPrior)
 	{
-		truthDistribution->StoreEvent( Truth, TruthWeight );
-		reconstructedDistribution->StoreEvent( Reco, RecoWeight );
+		truthDistribution->StoreEventInBin( TruthIndex, TruthWeight );
+		reconstructedDistribution->StoreEventInBin( RecoIndex, RecoWeight );
 	}
 
-	inputSmearing->StoreTruthRecoPair( Truth, Reco, TruthWeight, RecoWeight );
+	inputSmearing->StoreTruthRecoPair( TruthIndex, RecoIndex, TruthWeight, RecoWeight );
 }
 
 //If an MC event is not reconstructed at all, use this
 //method to store the truth value alone
-void NoCorrection::StoreUnreconstructedTruth( vector< double > Truth, double Weight, bool UseInPrior )
+void NoCorrection::StoreUnreconstructedTruth( const double * Truth, unsigned int ValueNumber, double Weight, bool UseInPrior )
+{
+	StoreUnreconstructedTruthBin( indexCalculator->GetIndex( Truth, ValueNumber ), Weight, UseInPrior );
+}
+void NoCorrection::StoreUnreconstructedTruthBin( unsigned int TruthIndex, double Weight, bool UseInPrior )
 {
 	if (UseInPrior)
 	{
-		truthDistribution->StoreEvent( Truth, Weight );
+		truthDistribution->StoreEventInBin( TruthIndex, Weight );
 		reconstructedDistribution->StoreBadEvent( Weight );
 	}
 
-	inputSmearing->StoreUnreconstructedTruth( Truth, Weight );
+	inputSmearing->StoreUnreconstructedTruth( TruthIndex, Weight );
 }
 
 //If there is a fake reconstructed event with no
 //corresponding truth, use this method
-void NoCorrection::StoreReconstructedFake( vector< double > Reco, double Weight, bool UseInPrior )
+void NoCorrection::StoreReconstructedFake( const double * Reco, unsigned int ValueNumber, double Weight, bool UseInPrior )
+{
+	StoreReconstructedFakeBin( indexCalculator->GetIndex( Reco, ValueNumber ), Weight, UseInPrior );
+}
+void NoCorrection::StoreReconstructedFakeBin( unsigned int RecoIndex, double Weight, bool UseInPrior )
 {
 	if (UseInPrior)
 	{
 		truthDistribution->StoreBadEvent( Weight );
-		reconstructedDistribution->StoreEvent( Reco, Weight );
+		reconstructedDistribution->StoreEventInBin( RecoIndex, Weight );
 	}
 
-	inputSmearing->StoreReconstructedFake( Reco, Weight );
+	inputSmearing->StoreReconstructedFake( RecoIndex, Weight );
 }
 
 //Store a value from the uncorrected data distribution
-void NoCorrection::StoreDataValue( vector< double > Input, double Weight )
+void NoCorrection::StoreDataValue( const double * Input, unsigned int ValueNumber, double Weight )
+{
+	StoreDataBin( indexCalculator->GetIndex( Input, ValueNumber ), Weight );
+}
+void NoCorrection::StoreDataBin( unsigned int DataIndex, double Weight )
+{
+	inputDistribution->StoreEventInBin( DataIndex, Weight );
+	sumOfInputWeightSquares[ DataIndex ] += ( Weight * Weight );
+}
+
+//Add the MC events stored in another instance to this one
+void NoCorrection::MergeEvents( ICorrection * Other )
 {
-	inputDistribution->StoreEvent( Input, Weight );
-	sumOfInputWeightSquares[ indexCalculator->GetIndex( Input ) ] += ( Weight * Weight );
+	NoCorrection * other = dynamic_cast< NoCorrection* >( Other );
+	if ( !other || other->isClone != isClone )
+	{
+		cerr << "Can only merge events from a NoCorrection made the same way" << endl;
+		exit(1);
+	}
+
+	truthDistribution->AddEvents( other->truthDistribution );
+
+	//The reconstructed distribution and smearing matrix are shared with clones, so only the original adds them
+	if ( !isClone )
+	{
+		reconstructedDistribution->AddEvents( other->reconstructedDistribution );
+		inputSmearing->AddEvents( other->inputSmearing );
+	}
 }
 
 //Dummy, since nothing is happening
@@ -140,7 +176,7 @@ bool NoCorrection::ClosureTest( unsigned int MostIterations, bool WithSmoothing
 
 //Perform an unfolding cross-check
 //Dummy, since folding is not iterative
-unsigned int NoCorrection::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing )
+unsigned int NoCorrection::MonteCarloCrossCheck( Distribution * InputPriorDistribution, SmearingMatrix * InputSmearing, bool WithSmoothing, ostream & Output )
 {
 	return 1;
 }
@@ -1,5 +1,6 @@
 #include "SmearingCovariance.h"
 #include <iostream>
+#include <algorithm>
 
 SmearingCovariance::SmearingCovariance()
 {
@@ -10,60 +11,92 @@ SmearingCovariance::SmearingCovariance( SmearingMatrix * InputSmearing, Unfoldin
 	smearing = InputSmearing;
 	unfolding = InputUnfolding;
 
-	//Initialise lookups - apologies for horrible syntax
 	unsigned int binNumber = InputSmearing->GetBinNumber();
-	r_to_S_to_entries = vector< vector< vector< unsigned int > > >( binNumber, vector< vector< unsigned int > >( binNumber, vector< unsigned int >() ) );
-	r_to_U_to_entries = vector< vector< vector< unsigned int > > >( binNumber, vector< vector< unsigned int > >( binNumber, vector< unsigned int >() ) );
-	u_to_S_to_entries = vector< vector< vector< unsigned int > > >( binNumber, vector< vector< unsigned int > >( binNumber, vector< unsigned int >() ) );
-	u_to_entries = vector< vector< unsigned int > >( binNumber, vector< unsigned int >() );
-
-	unsigned int firstEntryNumber = InputSmearing->GetEntryNumberAndResetIterator();
-	for ( unsigned int firstEntryIndex = 0; firstEntryIndex < firstEntryNumber; firstEntryIndex++ )
+	smearingRowStarts = InputSmearing->GetRowStarts();
+	smearingIndices = InputSmearing->GetSecondIndices();
+	const double * smearingValues = InputSmearing->GetValues();
+	unsigned int smearingEntryNumber = smearingRowStarts[ binNumber ];
+
+	//Count the entries, so nothing is reallocated
+	entryStarts = vector< unsigned int >( binNumber + 1, 0 );
+	for ( unsigned int u = 0; u < binNumber; u++ )
 	{
-		//Get a non-zero smearing matrix entry
-		unsigned int r, u;
-		double firstEntryValue = InputSmearing->GetNextEntry( u, r );
-
-		//Cache the inverse of the entry
-		oneOverSmearing[ pair< unsigned int, unsigned int >( u, r ) ] = 1.0 / firstEntryValue;
-
-		//Cache part of the delta calculation
-		deltaUR[ pair< unsigned int, unsigned int >( u, r ) ] = -unfolding->GetElement( u, r ) * smearing->GetEfficiency( u ) * oneOverSmearing[ pair< unsigned int, unsigned int >( u, r ) ];
+		unsigned int rowLength = smearingRowStarts[ u + 1 ] - smearingRowStarts[ u ];
+		entryStarts[ u + 1 ] = entryStarts[ u ] + ( rowLength * rowLength );
+	}
+	unsigned int entryNumber = entryStarts[ binNumber ];
+	smearingErrors.reserve( entryNumber );
+	uIndices.reserve( entryNumber );
+	rPositions.reserve( entryNumber );
+	sPositions.reserve( entryNumber );
+
+	oneOverSmearing = vector< double >( smearingEntryNumber, 0.0 );
+	deltaUR = vector< double >( smearingEntryNumber, 0.0 );
+	for ( unsigned int u = 0; u < binNumber; u++ )
+	{
+		for ( unsigned int firstEntryIndex = smearingRowStarts[ u ]; firstEntryIndex < smearingRowStarts[ u + 1 ]; firstEntryIndex++ )
+		{
+			//Get a non-zero smearing matrix entry
+			unsigned int r = smearingIndices[ firstEntryIndex ];
+			double firstEntryValue = smearingValues[ firstEntryIndex ];
 
-		//Get all entries with the same cause index
-		vector< unsigned int > * theseSIndices = InputSmearing->GetIndicesWithFirstIndex( u );
-		vector< double > * secondEntryValues = InputSmearing->GetEntriesWithFirstIndex( u );
+			//Cache the inverse of the entry
+			oneOverSmearing[ firstEntryIndex ] = 1.0 / firstEntryValue;
 
-		//Loop over these entries
-		for ( unsigned int secondEntryIndex = 0; secondEntryIndex < theseSIndices->size(); secondEntryIndex++ )
-		{
-			unsigned int s = ( *theseSIndices )[ secondEntryIndex ];
-			double smearingError;
-			double truthNumber = InputSmearing->GetTruthTotal( u );
+			//Cache part of the delta calculation
+			deltaUR[ firstEntryIndex ] = -unfolding->GetElement( u, r ) * smearing->GetEfficiency( u ) * oneOverSmearing[ firstEntryIndex ];
 
-			if ( r == s )
+			//Loop over all entries with the same cause index
+			for ( unsigned int secondEntryIndex = smearingRowStarts[ u ]; secondEntryIndex < smearingRowStarts[ u + 1 ]; secondEntryIndex++ )
 			{
-				smearingError = firstEntryValue * ( 1.0 - firstEntryValue ) / truthNumber;
-			}
-			else
-			{
-				smearingError = -1.0 * firstEntryValue * ( *secondEntryValues )[ secondEntryIndex ] / truthNumber;
+				double smearingError;
+				double truthNumber = InputSmearing->GetTruthTotal( u );
+
+				if ( firstEntryIndex == secondEntryIndex )
+				{
+					smearingError = firstEntryValue * ( 1.0 - firstEntryValue ) / truthNumber;
+				}
+				else
+				{
+					smearingError = -1.0 * firstEntryValue * smearingValues[ secondEntryIndex ] / truthNumber;
+				}
+
+				//Store the sparse matrix entry
+				smearingErrors.push_back( smearingError );
+				uIndices.push_back( u );
+				rPositions.push_back( firstEntryIndex );
+				sPositions.push_back( secondEntryIndex );
 			}
+		}
+	}
 
-			//Store the sparse matrix entry
-			smearingErrors.push_back( smearingError );
-			rIndices.push_back( r );
-			sIndices.push_back( s );
-			uIndices.push_back( u );
-			unsigned int entryIndex = smearingErrors.size() - 1;
-
-			//Store the quick lookups
-			r_to_S_to_entries[ r ][ s ].push_back( entryIndex );
-			r_to_U_to_entries[ r ][ u ].push_back( entryIndex );
-			u_to_S_to_entries[ u ][ s ].push_back( entryIndex );
-			u_to_entries[ u ].push_back( entryIndex );
+	//Sort the entries by (r, s) for the quick lookups, keeping them in order within each (r, s)
+	vector< pair< pair< unsigned int, unsigned int >, unsigned int > > rsKeys( entryNumber );
+	for ( unsigned int entryIndex = 0; entryIndex < entryNumber; entryIndex++ )
+	{
+		rsKeys[ entryIndex ] = make_pair( make_pair( smearingIndices[ rPositions[ entryIndex ] ], smearingIndices[ sPositions[ entryIndex ] ] ), entryIndex );
+	}
+	sort( rsKeys.begin(), rsKeys.end() );
+
+	//Compress the sorted keys
+	rsRowStarts = vector< unsigned int >( binNumber + 1, 0 );
+	rsEntries = vector< unsigned int >( entryNumber );
+	for ( unsigned int keyIndex = 0; keyIndex < entryNumber; keyIndex++ )
+	{
+		rsEntries[ keyIndex ] = rsKeys[ keyIndex ].second;
+		if ( keyIndex == 0 || rsKeys[ keyIndex ].first != rsKeys[ keyIndex - 1 ].first )
+		{
+			rsRowStarts[ rsKeys[ keyIndex ].first.first + 1 ]++;
+			rsSecondIndices.push_back( rsKeys[ keyIndex ].first.second );
+			rsEntryStarts.push_back( keyIndex );
 		}
 	}
+	rsEntryStarts.push_back( entryNumber );
+	for ( unsigned int r = 0; r < binNumber; r++ )
+	{
+		rsRowStarts[ r + 1 ] += rsRowStarts[ r ];
+	}
+	vector< pair< pair< unsigned int, unsigned int >, unsigned int > >().swap( rsKeys );
 
 	//Cache the inverse of the efficiencies
 	oneOverEfficiency = vector< double >( binNumber, 0.0 );
@@ -74,20 +107,17 @@ SmearingCovariance::SmearingCovariance( SmearingMatrix * InputSmearing, Unfoldin
 
 	//Cache some results for the u==k==l case
 	sumOverAll_RNotI_SNotJ = vector< double >( binNumber, 0.0 );
-	sumOverThis_SNotJ = vector< vector< double > >( binNumber, vector< double >( binNumber, 0.0 ) );
-	sumOverThis_SIsJ = vector< vector< double > >( binNumber, vector< double >( binNumber, 0.0 ) );
-	sumOverThis_RNotI = vector< vector< double > >( binNumber, vector< double >( binNumber, 0.0 ) );
+	sumOverThis_SNotJ = vector< double >( smearingEntryNumber, 0.0 );
+	sumOverThis_SIsJ = vector< double >( smearingEntryNumber, 0.0 );
+	sumOverThis_RNotI = vector< double >( smearingEntryNumber, 0.0 );
+	correctionU_RS = vector< double >( entryNumber, 0.0 );
 	for ( unsigned int uIndex = 0; uIndex < binNumber; uIndex++ )
 	{
-		//Make the correction factor map
-		map< pair< unsigned int, unsigned int >, double > correctionsForThisU;
-
 		//Loop over all entries with this u value
-		for ( unsigned int searchIndex = 0; searchIndex < u_to_entries[ uIndex ].size(); searchIndex++ )
+		for ( unsigned int entryIndex = entryStarts[ uIndex ]; entryIndex < entryStarts[ uIndex + 1 ]; entryIndex++ )
 		{
-			unsigned int entryIndex = u_to_entries[ uIndex ][ searchIndex ];
-			unsigned int s = sIndices[ entryIndex ];
-			unsigned int r = rIndices[ entryIndex ];
+			unsigned int sPosition = sPositions[ entryIndex ];
+			unsigned int rPosition = rPositions[ entryIndex ];
 
 			//Work out the KIRU component
 			double deltaKIRU = -oneOverEfficiency[ uIndex ];
@@ -97,28 +127,25 @@ SmearingCovariance::SmearingCovariance( SmearingMatrix * InputSmearing, Unfoldin
 
 			//Store result for s != j
 			double simpleResult = deltaKIRU * deltaLJSU * smearingErrors[ entryIndex ];
-			sumOverThis_SNotJ[ uIndex ][ s ] += simpleResult;
-			sumOverThis_RNotI[ uIndex ][ r ] += simpleResult;
+			sumOverThis_SNotJ[ sPosition ] += simpleResult;
+			sumOverThis_RNotI[ rPosition ] += simpleResult;
 
 			//Work out the LJSU component for s == j
-			deltaLJSU += oneOverSmearing[ pair< unsigned int, unsigned int >( uIndex, s ) ];
-			deltaLJSU += deltaUR[ pair< unsigned int, unsigned int >( uIndex, s ) ];
+			deltaLJSU += oneOverSmearing[ sPosition ];
+			deltaLJSU += deltaUR[ sPosition ];
 
 			//Store result for s == j
 			double complexResult = deltaKIRU * deltaLJSU * smearingErrors[ entryIndex ];
-			sumOverThis_SIsJ[ uIndex ][ s ] += complexResult;
+			sumOverThis_SIsJ[ sPosition ] += complexResult;
 
 			//Store the corection factor for r == i and s == j
-			correctionsForThisU[ pair< unsigned int, unsigned int >( r, s ) ] = simpleResult - complexResult;
+			correctionU_RS[ entryIndex ] = simpleResult - complexResult;
 		}
 
-		//Store the correction map
-		correctionU_RS.push_back( correctionsForThisU );
-
 		//Now sum the sums
-		for ( unsigned int sIndex = 0; sIndex < binNumber; sIndex++ )
+		for ( unsigned int sPosition = smearingRowStarts[ uIndex ]; sPosition < smearingRowStarts[ uIndex + 1 ]; sPosition++ )
 		{
-			sumOverAll_RNotI_SNotJ[ uIndex ] += sumOverThis_SNotJ[ uIndex ][ sIndex ];
+			sumOverAll_RNotI_SNotJ[ uIndex ] += sumOverThis_SNotJ[ sPosition ];
 		}
 	}
 }
@@ -126,108 +153,138 @@ SmearingCovariance::SmearingCovariance( SmearingMatrix * InputSmearing, Unfoldin
 SmearingCovariance::~SmearingCovariance()
 {
 	smearingErrors.clear();
-	rIndices.clear();
-	sIndices.clear();
 	uIndices.clear();
-	r_to_S_to_entries.clear();
-	r_to_U_to_entries.clear();
-	u_to_S_to_entries.clear();
-	u_to_entries.clear();
+	rPositions.clear();
+	sPositions.clear();
+	rsEntries.clear();
+}
+
+//Find the position of smearing matrix entry (U, R) in the smearing matrix storage
+bool SmearingCovariance::FindSmearingEntry( unsigned int U, unsigned int R, unsigned int & Position )
+{
+	const unsigned int * rowBegin = smearingIndices + smearingRowStarts[ U ];
+	const unsigned int * rowEnd = smearingIndices + smearingRowStarts[ U + 1 ];
+	const unsigned int * searchResult = lower_bound( rowBegin, rowEnd, R );
+
+	if ( searchResult == rowEnd || *searchResult != R )
+	{
+		return false;
+	}
+	else
+	{
+		Position = searchResult - smearingIndices;
+		return true;
+	}
 }
 
 double SmearingCovariance::ThisContribution( unsigned int I, unsigned int J, unsigned int K, unsigned int L )
 {
 	double returnValue = 0.0;
 
-	//Keep track of entries added already
-	vector< bool > usedAlready( smearingErrors.size(), false );
-
 	//Look for entries with r == i and s == j
-	for ( unsigned int searchIndex = 0; searchIndex < r_to_S_to_entries[ I ][ J ].size(); searchIndex++ )
+	const unsigned int * keyBegin = rsSecondIndices.data() + rsRowStarts[ I ];
+	const unsigned int * keyEnd = rsSecondIndices.data() + rsRowStarts[ I + 1 ];
+	const unsigned int * keyResult = lower_bound( keyBegin, keyEnd, J );
+	if ( keyResult != keyEnd && *keyResult == J )
 	{
-		unsigned int entryIndex = r_to_S_to_entries[ I ][ J ][ searchIndex ];
-		usedAlready[ entryIndex ] = true;
-
-		//U information
-		unsigned int u = uIndices[ entryIndex ];
-
-		//Work out the KIRU component
-		double deltaKIRU = deltaUR[ pair< unsigned int, unsigned int >( u, I ) ];
-		if ( K == u )
-		{
-			deltaKIRU -= oneOverEfficiency[ u ];
-			deltaKIRU += oneOverSmearing[ pair< unsigned int, unsigned int >( u, I ) ];
-		}
-
-		//Work out the LJSU component
-		double deltaLJSU = deltaUR[ pair< unsigned int, unsigned int >( u, J ) ];
-		if ( L == u )
+		unsigned int keyIndex = keyResult - rsSecondIndices.data();
+		for ( unsigned int searchIndex = rsEntryStarts[ keyIndex ]; searchIndex < rsEntryStarts[ keyIndex + 1 ]; searchIndex++ )
 		{
-			deltaLJSU -= oneOverEfficiency[ u ];
-			deltaLJSU += oneOverSmearing[ pair< unsigned int, unsigned int >( u, J ) ];
-		}
+			unsigned int entryIndex = rsEntries[ searchIndex ];
 
-		//Store result
-		returnValue += deltaKIRU * deltaLJSU * smearingErrors[ entryIndex ];
-	}
-
-	//Look for entries with r == i and u == l
-	for ( unsigned int searchIndex = 0; searchIndex < r_to_U_to_entries[ I ][ L ].size(); searchIndex++ )
-	{
-		unsigned int entryIndex = r_to_U_to_entries[ I ][ L ][ searchIndex ];
-		if ( !usedAlready[ entryIndex ] )
-		{
-			//Not used already, therefore s != j
-			usedAlready[ entryIndex ] = true;
+			//U information
+			unsigned int u = uIndices[ entryIndex ];
 
 			//Work out the KIRU component
-			double deltaKIRU = deltaUR[ pair< unsigned int, unsigned int >( L, I ) ];
-			if ( K == L )
+			double deltaKIRU = deltaUR[ rPositions[ entryIndex ] ];
+			if ( K == u )
 			{
-				deltaKIRU -= oneOverEfficiency[ L ];
-				deltaKIRU += oneOverSmearing[ pair< unsigned int, unsigned int >( L, I ) ];
+				deltaKIRU -= oneOverEfficiency[ u ];
+				deltaKIRU += oneOverSmearing[ rPositions[ entryIndex ] ];
 			}
 
 			//Work out the LJSU component
-			double deltaLJSU = -oneOverEfficiency[ L ];
+			double deltaLJSU = deltaUR[ sPositions[ entryIndex ] ];
+			if ( L == u )
+			{
+				deltaLJSU -= oneOverEfficiency[ u ];
+				deltaLJSU += oneOverSmearing[ sPositions[ entryIndex ] ];
+			}
 
 			//Store result
 			returnValue += deltaKIRU * deltaLJSU * smearingErrors[ entryIndex ];
 		}
 	}
 
+	//Look for entries with r == i and u == l: a contiguous block, one entry for each s
+	unsigned int rowLengthL = smearingRowStarts[ L + 1 ] - smearingRowStarts[ L ];
+	unsigned int iPositionL;
+	if ( FindSmearingEntry( L, I, iPositionL ) )
+	{
+		unsigned int blockStart = entryStarts[ L ] + ( ( iPositionL - smearingRowStarts[ L ] ) * rowLengthL );
+		for ( unsigned int entryIndex = blockStart; entryIndex < blockStart + rowLengthL; entryIndex++ )
+		{
+			//Entries with s == j were used already
+			if ( smearingIndices[ sPositions[ entryIndex ] ] != J )
+			{
+				//Work out the KIRU component
+				double deltaKIRU = deltaUR[ iPositionL ];
+				if ( K == L )
+				{
+					deltaKIRU -= oneOverEfficiency[ L ];
+					deltaKIRU += oneOverSmearing[ iPositionL ];
+				}
+
+				//Work out the LJSU component
+				double deltaLJSU = -oneOverEfficiency[ L ];
+
+				//Store result
+				returnValue += deltaKIRU * deltaLJSU * smearingErrors[ entryIndex ];
+			}
+		}
+	}
+
 	//Look for entries with u == k == l
+	unsigned int rowLengthK = smearingRowStarts[ K + 1 ] - smearingRowStarts[ K ];
+	unsigned int jPositionK;
+	bool foundJ = FindSmearingEntry( K, J, jPositionK );
 	if ( K == L )
 	{
 		//Use cached sums over all entries with u == k
-		double centralCorrection;
-		map< pair< unsigned int, unsigned int >, double >::iterator searchResult = correctionU_RS[ K ].find( pair< unsigned int, unsigned int >( I, J ) );
-		if ( searchResult == correctionU_RS[ K ].end() )
+		unsigned int iPositionK;
+		bool foundI = FindSmearingEntry( K, I, iPositionK );
+		double centralCorrection = 0.0;
+		double sumSNotJ = 0.0;
+		double sumSIsJ = 0.0;
+		double sumRNotI = 0.0;
+		if ( foundJ )
 		{
-			centralCorrection = 0.0;
+			sumSNotJ = sumOverThis_SNotJ[ jPositionK ];
+			sumSIsJ = sumOverThis_SIsJ[ jPositionK ];
 		}
-		else
+		if ( foundI )
 		{
-			centralCorrection = searchResult->second;
+			sumRNotI = sumOverThis_RNotI[ iPositionK ];
 		}
-		returnValue += sumOverAll_RNotI_SNotJ[ K ] - sumOverThis_SNotJ[ K ][ J ] + sumOverThis_SIsJ[ K ][ J ] - sumOverThis_RNotI[ K ][ I ] + centralCorrection;
+		if ( foundI && foundJ )
+		{
+			centralCorrection = correctionU_RS[ entryStarts[ K ] + ( ( iPositionK - smearingRowStarts[ K ] ) * rowLengthK ) + ( jPositionK - smearingRowStarts[ K ] ) ];
+		}
+		returnValue += sumOverAll_RNotI_SNotJ[ K ] - sumSNotJ + sumSIsJ - sumRNotI + centralCorrection;
 	}
-	else
+	else if ( foundJ )
 	{
-		//Look for entries with u == k and s == j
-		for ( unsigned int searchIndex = 0; searchIndex < u_to_S_to_entries[ K ][ J ].size(); searchIndex++ )
+		//Look for entries with u == k and s == j: one entry for each r, spaced by the row length
+		for ( unsigned int entryIndex = entryStarts[ K ] + ( jPositionK - smearingRowStarts[ K ] ); entryIndex < entryStarts[ K + 1 ]; entryIndex += rowLengthK )
 		{
-			unsigned int entryIndex = u_to_S_to_entries[ K ][ J ][ searchIndex ];
-			if ( !usedAlready[ entryIndex ] )
+			//Entries with r == i were used already
+			if ( smearingIndices[ rPositions[ entryIndex ] ] != I )
 			{
-				//Not used already, therefore r != i
-				usedAlready[ entryIndex ] = true;
-
 				//Work out the KIRU component
 				double deltaKIRU = -oneOverEfficiency[ K ];
 
 				//Work out the LJSU component
-				double deltaLJSU = deltaUR[ pair< unsigned int, unsigned int >( K, J ) ];
+				double deltaLJSU = deltaUR[ jPositionK ];
 
 				//Store result
 				returnValue += deltaKIRU * deltaLJSU * smearingErrors[ entryIndex ];
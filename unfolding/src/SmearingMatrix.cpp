@@ -31,40 +31,53 @@ SmearingMatrix::SmearingMatrix( IIndexCalculator * InputIndices )
 }
 
 //Populate the matrix with values from events
-void SmearingMatrix::StoreTruthRecoPair( vector< double > Truth, vector< double > Reco, double TruthWeight, double RecoWeight )
+void SmearingMatrix::StoreTruthRecoPair( unsigned int TruthIndex, unsigned int RecoIndex, double TruthWeight, double RecoWeight )
 {
-	//Look up the indices of the truth and reco
-	unsigned int truthIndex = indexCalculator->GetIndex( Truth );
-	unsigned int recoIndex = indexCalculator->GetIndex( Reco );
-
 	//Increment values
-	AddToEntry( truthIndex, recoIndex, RecoWeight );
-	normalisation[ truthIndex ] += TruthWeight;
+	AddToEntry( TruthIndex, RecoIndex, RecoWeight );
+	normalisation[ TruthIndex ] += TruthWeight;
 	totalPaired += TruthWeight;
 }
-void SmearingMatrix::StoreUnreconstructedTruth( vector< double > Truth, double Weight )
+void SmearingMatrix::StoreUnreconstructedTruth( unsigned int TruthIndex, double Weight )
 {
-	//Look up the index of the truth value
-	unsigned int truthIndex = indexCalculator->GetIndex( Truth );
+	//The reco index is the bad bin
 	unsigned int recoIndex = indexCalculator->GetBinNumber();
 
 	//Increment values
-	AddToEntry( truthIndex, recoIndex, Weight );
-	normalisation[ truthIndex ] += Weight;
+	AddToEntry( TruthIndex, recoIndex, Weight );
+	normalisation[ TruthIndex ] += Weight;
 	totalMissed += Weight;
 }
-void SmearingMatrix::StoreReconstructedFake( vector< double > Reco, double Weight )
+void SmearingMatrix::StoreReconstructedFake( unsigned int RecoIndex, double Weight )
 {
-	//Look up the index of the reco value
+	//The truth index is the bad bin
 	unsigned int truthIndex = indexCalculator->GetBinNumber();
-	unsigned int recoIndex = indexCalculator->GetIndex( Reco );
 
 	//Increment values
-	AddToEntry( truthIndex, recoIndex, Weight );
+	AddToEntry( truthIndex, RecoIndex, Weight );
 	normalisation[ truthIndex ] += Weight;
 	totalFake += Weight;
 }
 
+//Add the events stored in another smearing matrix with the same binning
+void SmearingMatrix::AddEvents( const SmearingMatrix * Other )
+{
+	if ( isFinalised || Other->isFinalised || normalisation.size() != Other->normalisation.size() )
+	{
+		cerr << "Can only add events from an unfinalised smearing matrix with the same binning" << endl;
+		exit(1);
+	}
+
+	AddEntries( Other );
+	for ( unsigned int binIndex = 0; binIndex < normalisation.size(); binIndex++ )
+	{
+		normalisation[ binIndex ] += Other->normalisation[ binIndex ];
+	}
+	totalPaired += Other->totalPaired;
+	totalMissed += Other->totalMissed;
+	totalFake += Other->totalFake;
+}
+
 //Do a bunch of extra calculations that aren't necessary if you just want the raw smearing matrix
 void SmearingMatrix::Finalise()
 {
@@ -72,25 +85,25 @@ void SmearingMatrix::Finalise()
 	{
 		unsigned int binNumber = indexCalculator->GetBinNumber() + 1;
 
+		//Compress the accumulated entries
+		VectorsFromMap( binNumber );
+
 		//Prepare storage for the efficiencies and effect probabilities
 		efficiencies = vector< double >( binNumber, 0.0 );
 
 		//Finalise each filled element
-		map< pair< unsigned int, unsigned int >, double >::iterator matrixIterator;
-		for ( matrixIterator = matrix.begin(); matrixIterator != matrix.end(); matrixIterator++ )
+		for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
 		{
-			//Read the cause index for this entry
-			unsigned int causeIndex = matrixIterator->first.first;
-
-			//Normalise the entry
-			double value = matrixIterator->second / normalisation[ causeIndex ];
-			matrix[ matrixIterator->first ] = value;
-
-			//Add to the efficiency of this cause
-			efficiencies[ causeIndex ] += value;
+			for ( unsigned int entryIndex = rowStarts[ causeIndex ]; entryIndex < rowStarts[ causeIndex + 1 ]; entryIndex++ )
+			{
+				//Normalise the entry
+				matrixValues[ entryIndex ] /= normalisation[ causeIndex ];
+
+				//Add to the efficiency of this cause
+				efficiencies[ causeIndex ] += matrixValues[ entryIndex ];
+			}
 		}
 
-		VectorsFromMap( binNumber );
 		isFinalised = true;
 	}
 }
@@ -0,0 +1,150 @@
+/**
+  @class SmoothingStencil
+
+  The moving average used to smooth a distribution, worked out once for each binning
+  Each bin lists the bins it is made from and their weights, so smoothing is one pass over the bin values
+ */
+
+#include "SmoothingStencil.h"
+#include <iostream>
+#include <cstdlib>
+
+map< vector< unsigned int >, SmoothingStencil* > SmoothingStencil::allStencils;
+mutex SmoothingStencil::stencilMutex;
+
+//Find the stencil for a binning, making it the first time it's asked for
+SmoothingStencil * SmoothingStencil::GetStencil( IIndexCalculator * Indices, unsigned int SideBinNumber, unsigned int DimensionIndex )
+{
+	//The stencil only depends on the number of bins in each dimension (including over/underflow)
+	vector< unsigned int > binNumbers;
+	unsigned int binNumber = 1;
+	while ( binNumber < Indices->GetBinNumber() )
+	{
+		binNumbers.push_back( Indices->GetBinNumber( binNumbers.size() ) );
+		binNumber *= binNumbers.back();
+	}
+	if ( DimensionIndex >= binNumbers.size() )
+	{
+		cerr << "Cannot smooth in dimension " << DimensionIndex << " of a " << binNumbers.size() << "D distribution" << endl;
+		exit(1);
+	}
+
+	//Look for an existing stencil
+	vector< unsigned int > stencilKey = binNumbers;
+	stencilKey.push_back( SideBinNumber );
+	stencilKey.push_back( DimensionIndex );
+	lock_guard< mutex > stencilLock( stencilMutex );
+	map< vector< unsigned int >, SmoothingStencil* >::iterator stencilIterator = allStencils.find( stencilKey );
+	if ( stencilIterator == allStencils.end() )
+	{
+		SmoothingStencil * newStencil = new SmoothingStencil( binNumbers, SideBinNumber, DimensionIndex );
+		allStencils[ stencilKey ] = newStencil;
+		return newStencil;
+	}
+	else
+	{
+		return stencilIterator->second;
+	}
+}
+
+//Work out the moving average for every bin
+SmoothingStencil::SmoothingStencil( const vector< unsigned int > & BinNumbers, unsigned int SideBinNumber, unsigned int DimensionIndex )
+{
+	//Find the distance between neighbouring bins in the smoothing dimension
+	unsigned int stride = 1;
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < DimensionIndex; dimensionIndex++ )
+	{
+		stride *= BinNumbers[ dimensionIndex ];
+	}
+	int dimensionBinNumber = BinNumbers[ DimensionIndex ];
+	int sideBinNumber = SideBinNumber;
+
+	//Each offset from the bin gives two terms, so that edge-preserving values fit the same layout
+	binNumber = stride;
+	for ( unsigned int dimensionIndex = DimensionIndex; dimensionIndex < BinNumbers.size(); dimensionIndex++ )
+	{
+		binNumber *= BinNumbers[ dimensionIndex ];
+	}
+	termNumber = 2 * ( ( 2 * SideBinNumber ) + 1 );
+	termIndices = vector< unsigned int >( binNumber * termNumber, 0 );
+	termWeights = vector< double >( binNumber * termNumber, 0.0 );
+	double averageWeight = 1.0 / ( ( 2.0 * ( double )SideBinNumber ) + 1.0 );
+
+	for ( unsigned int binIndex = 0; binIndex < binNumber; binIndex++ )
+	{
+		unsigned int firstTerm = binIndex * termNumber;
+		int dimensionBinIndex = ( binIndex / stride ) % dimensionBinNumber;
+
+		//Unused terms just point at the bin itself, with no weight
+		for ( unsigned int termIndex = 0; termIndex < termNumber; termIndex++ )
+		{
+			termIndices[ firstTerm + termIndex ] = binIndex;
+		}
+
+		//Don't smooth the over/underflow bins of the smoothing dimension
+		if ( dimensionBinIndex == 0 || dimensionBinIndex == dimensionBinNumber - 1 )
+		{
+			termWeights[ firstTerm ] = 1.0;
+			continue;
+		}
+
+		//Take the average of the local bins
+		for ( int localIndex = -sideBinNumber; localIndex <= sideBinNumber; localIndex++ )
+		{
+			unsigned int term = firstTerm + ( 2 * ( localIndex + sideBinNumber ) );
+			int sumIndex = dimensionBinIndex + localIndex;
+			int mirrorIndex = dimensionBinIndex - localIndex;
+			if ( sumIndex > 0 && sumIndex < dimensionBinNumber - 1 )
+			{
+				//Use this bin in the averaging
+				termIndices[ term ] = binIndex + ( localIndex * ( int )stride );
+				termWeights[ term ] = averageWeight;
+			}
+			else if ( mirrorIndex >= 0 && mirrorIndex < dimensionBinNumber )
+			{
+				//Derive an edge-preserving value instead
+				termWeights[ term ] = 2.0 * averageWeight;
+				termIndices[ term + 1 ] = binIndex - ( localIndex * ( int )stride );
+				termWeights[ term + 1 ] = -averageWeight;
+			}
+			else
+			{
+				//No mirror bin either, so just use this bin again
+				termWeights[ term ] = averageWeight;
+			}
+		}
+	}
+}
+
+//Smooth the bin values into the result, returning the new integral
+double SmoothingStencil::Apply( const vector< double > & BinValues, vector< double > & Result )
+{
+	Result.resize( BinValues.size() );
+	const unsigned int * indices = &termIndices[ 0 ];
+	const double * weights = &termWeights[ 0 ];
+	const double * values = &BinValues[ 0 ];
+	double newIntegral = 0.0;
+
+	for ( unsigned int binIndex = 0; binIndex < binNumber; binIndex++ )
+	{
+		double binTotal = 0.0;
+		for ( unsigned int termIndex = 0; termIndex < termNumber; termIndex++ )
+		{
+			binTotal += weights[ termIndex ] * values[ indices[ termIndex ] ];
+		}
+		indices += termNumber;
+		weights += termNumber;
+
+		Result[ binIndex ] = binTotal;
+		newIntegral += binTotal;
+	}
+
+	//Copy the bad bin
+	for ( unsigned int binIndex = binNumber; binIndex < BinValues.size(); binIndex++ )
+	{
+		Result[ binIndex ] = BinValues[ binIndex ];
+		newIntegral += BinValues[ binIndex ];
+	}
+
+	return newIntegral;
+}
@@ -2,6 +2,7 @@
   @class SparseMatrix
 
   A matrix with many zero values, stored as a list of the non-zero entries
+  Entries are accumulated as unsorted (row, column, value) triplets, then sorted and compressed into row-indexed arrays
   Searchable or readable
 
   @author Benjamin M Wynne bwynne@cern.ch
@@ -12,18 +13,31 @@
 #include <iostream>
 #include <cstdlib>
 #include <cassert>
+#include <algorithm>
+
+//The smallest number of unsorted entries to accumulate before merging them
+const unsigned int MINIMUM_MERGE_THRESHOLD = 65536;
+
+//Order entries by their indices only, so that a stable sort keeps duplicates in the order they were added
+static bool CompareEntryIndices( const pair< pair< unsigned int, unsigned int >, double > & First, const pair< pair< unsigned int, unsigned int >, double > & Second )
+{
+	return First.first < Second.first;
+}
 
 SparseMatrix::SparseMatrix()
 {
-	nextEntry = matrix.begin();
-	otherNextEntry = matrix.begin();
-	entryNumber = 0;
+	nextEntry = 0;
+	otherNextEntry = 0;
+	nextEntryRow = 0;
+	otherNextEntryRow = 0;
+	mergeThreshold = MINIMUM_MERGE_THRESHOLD;
 	vectorsMade = false;
 }
 
 SparseMatrix::~SparseMatrix()
 {
-	matrix.clear();
+	unsortedEntries.clear();
+	rowStarts.clear();
 	matrixValues.clear();
 	secondIndices.clear();
 }
@@ -37,140 +51,237 @@ void SparseMatrix::AddToEntry( unsigned int FirstIndex, unsigned int SecondIndex
 		exit(1);
 	}
 
-	//Find if this matrix element already exists
-	const pair< unsigned int, unsigned int > searchPair( FirstIndex, SecondIndex );
-	const map< pair< unsigned int, unsigned int >, double >::iterator searchResult = matrix.find( searchPair );
+	//Just store the entry - duplicates are summed when the entries are merged
+	unsortedEntries.push_back( make_pair( make_pair( FirstIndex, SecondIndex ), Value ) );
 
-	//Either create a new element or add to the existing one
-	if ( searchResult == matrix.end() )
+	//Merge periodically to stop duplicate entries using too much memory
+	if ( unsortedEntries.size() >= mergeThreshold )
 	{
-		matrix[ searchPair ] = Value;
-		entryNumber++;
+		MergeEntries();
+		mergeThreshold = max( MINIMUM_MERGE_THRESHOLD, 2 * (unsigned int)unsortedEntries.size() );
 	}
-	else
+}
+
+//Add all the entries of another matrix, which must not be finalised either
+void SparseMatrix::AddEntries( const SparseMatrix * Other )
+{
+	if ( vectorsMade || Other->vectorsMade )
+	{
+		cerr << "Trying to add elements to or from finalised sparse matrix" << endl;
+		exit(1);
+	}
+
+	//The other entries go after these, so duplicates are still summed in a fixed order
+	unsortedEntries.insert( unsortedEntries.end(), Other->unsortedEntries.begin(), Other->unsortedEntries.end() );
+	if ( unsortedEntries.size() >= mergeThreshold )
 	{
-		matrix[ searchPair ] += Value;
+		MergeEntries();
+		mergeThreshold = max( MINIMUM_MERGE_THRESHOLD, 2 * (unsigned int)unsortedEntries.size() );
 	}
 }
 
-//Get the next non-zero entry in an iteration through them
-double SparseMatrix::GetNextEntry( unsigned int & FirstIndex, unsigned int & SecondIndex, bool UseSecondIterator )
+//Sort the stored entries by index, and add together any with the same indices
+void SparseMatrix::MergeEntries()
 {
-	if ( UseSecondIterator )
+	if ( unsortedEntries.empty() )
 	{
-		if ( otherNextEntry == matrix.end() )
-		{
-			cerr << "Acessing beyond end of sparse matrix: reset iterator" << endl;
-			exit(1);
-		}
+		return;
+	}
 
-		FirstIndex = otherNextEntry->first.first;
-		SecondIndex = otherNextEntry->first.second;
-		double value = otherNextEntry->second;
+	//Stable sort, so duplicates are summed in the order they were added
+	stable_sort( unsortedEntries.begin(), unsortedEntries.end(), CompareEntryIndices );
 
-		otherNextEntry++;
-		return value;
-	}
-	else
+	//Merge neighbouring entries with the same indices
+	unsigned int outputIndex = 0;
+	for ( unsigned int inputIndex = 1; inputIndex < unsortedEntries.size(); inputIndex++ )
 	{
-		if ( nextEntry == matrix.end() )
+		if ( unsortedEntries[ inputIndex ].first == unsortedEntries[ outputIndex ].first )
 		{
-			cerr << "Acessing beyond end of sparse matrix: reset iterator" << endl;
-			exit(1);
+			unsortedEntries[ outputIndex ].second += unsortedEntries[ inputIndex ].second;
 		}
+		else
+		{
+			outputIndex++;
+			unsortedEntries[ outputIndex ] = unsortedEntries[ inputIndex ];
+		}
+	}
+	unsortedEntries.resize( outputIndex + 1 );
+}
 
-		FirstIndex = nextEntry->first.first;
-		SecondIndex = nextEntry->first.second;
-		double value = nextEntry->second;
+//Get the next non-zero entry in an iteration through them
+double SparseMatrix::GetNextEntry( unsigned int & FirstIndex, unsigned int & SecondIndex, bool UseSecondIterator )
+{
+	unsigned int & entryIndex = UseSecondIterator ? otherNextEntry : nextEntry;
+	unsigned int & entryRow = UseSecondIterator ? otherNextEntryRow : nextEntryRow;
 
-		nextEntry++;
-		return value;
+	if ( entryIndex >= matrixValues.size() )
+	{
+		cerr << "Acessing beyond end of sparse matrix: reset iterator" << endl;
+		exit(1);
+	}
+
+	//Find the row containing this entry
+	while ( rowStarts[ entryRow + 1 ] <= entryIndex )
+	{
+		entryRow++;
 	}
+
+	FirstIndex = entryRow;
+	SecondIndex = secondIndices[ entryIndex ];
+	double value = matrixValues[ entryIndex ];
+
+	entryIndex++;
+	return value;
 }
 
 //Get any element of the matrix
 double SparseMatrix::GetElement( unsigned int FirstIndex, unsigned int SecondIndex )
 {
-	//Find if this matrix element already exists
-	pair< unsigned int, unsigned int > searchPair( FirstIndex, SecondIndex );
-	map< pair< unsigned int, unsigned int >, double >::iterator searchResult;
-	searchResult = matrix.find( searchPair );
-
-	if ( searchResult == matrix.end() )
+	if ( vectorsMade )
 	{
-		return 0.0;
+		//Binary search within the row
+		if ( FirstIndex + 1 >= rowStarts.size() )
+		{
+			return 0.0;
+		}
+		const unsigned int * rowBegin = secondIndices.data() + rowStarts[ FirstIndex ];
+		const unsigned int * rowEnd = secondIndices.data() + rowStarts[ FirstIndex + 1 ];
+		const unsigned int * searchResult = lower_bound( rowBegin, rowEnd, SecondIndex );
+
+		if ( searchResult == rowEnd || *searchResult != SecondIndex )
+		{
+			return 0.0;
+		}
+		else
+		{
+			return matrixValues[ searchResult - secondIndices.data() ];
+		}
 	}
 	else
 	{
-		return searchResult->second;
+		//Merge the stored entries so they can be searched
+		MergeEntries();
+		const pair< pair< unsigned int, unsigned int >, double > searchEntry( make_pair( FirstIndex, SecondIndex ), 0.0 );
+		vector< pair< pair< unsigned int, unsigned int >, double > >::iterator searchResult;
+		searchResult = lower_bound( unsortedEntries.begin(), unsortedEntries.end(), searchEntry, CompareEntryIndices );
+
+		if ( searchResult == unsortedEntries.end() || searchResult->first != searchEntry.first )
+		{
+			return 0.0;
+		}
+		else
+		{
+			return searchResult->second;
+		}
 	}
 }
 
+//Sort and merge the stored entries, then compress them into the row-indexed vectors
 void SparseMatrix::VectorsFromMap( unsigned int BinNumber )
 {
-	//Set up the data structures
-	matrixValues = vector< vector< double > >( BinNumber, vector< double >() );
-	secondIndices = vector< vector< unsigned int > >( BinNumber, vector< unsigned int >() );
+	MergeEntries();
 
-	//Read out the map
-	map< pair< unsigned int, unsigned int >, double >::iterator matrixIterator;
-	for ( matrixIterator = matrix.begin(); matrixIterator != matrix.end(); matrixIterator++ )
+	//Count the entries in each row
+	rowStarts = vector< unsigned int >( BinNumber + 1, 0 );
+	for ( unsigned int entryIndex = 0; entryIndex < unsortedEntries.size(); entryIndex++ )
 	{
-		secondIndices[ matrixIterator->first.first ].push_back( matrixIterator->first.second );
+		rowStarts[ unsortedEntries[ entryIndex ].first.first + 1 ]++;
+	}
+	for ( unsigned int rowIndex = 0; rowIndex < BinNumber; rowIndex++ )
+	{
+		rowStarts[ rowIndex + 1 ] += rowStarts[ rowIndex ];
+	}
 
-		matrixValues[ matrixIterator->first.first ].push_back( matrixIterator->second );
+	//The entries are already sorted, so just copy them out
+	secondIndices = vector< unsigned int >( unsortedEntries.size() );
+	matrixValues = vector< double >( unsortedEntries.size() );
+	for ( unsigned int entryIndex = 0; entryIndex < unsortedEntries.size(); entryIndex++ )
+	{
+		secondIndices[ entryIndex ] = unsortedEntries[ entryIndex ].first.second;
+		matrixValues[ entryIndex ] = unsortedEntries[ entryIndex ].second;
 	}
 
-	nextEntry = matrix.begin();
+	//Release the unsorted storage
+	vector< pair< pair< unsigned int, unsigned int >, double > >().swap( unsortedEntries );
+
+	nextEntry = 0;
+	nextEntryRow = 0;
 	vectorsMade = true;
 }
 
 //Return a root 2D histogram containing the smearing matrix
 TH2F * SparseMatrix::MakeRootHistogram( string Name, string Title )
 {
-	unsigned int binNumber = matrixValues.size();
+	unsigned int binNumber = GetBinNumber();
 
 	//Create the histogram object
 	TH2F * outputHistogram = new TH2F( Name.c_str(), Title.c_str(), binNumber, 0.0, (double)binNumber, binNumber, 0.0, (double)binNumber );
 
 	//Loop over all filled entries
-	for ( unsigned int firstIndex = 0; firstIndex < matrixValues.size(); firstIndex++ )
+	for ( unsigned int firstIndex = 0; firstIndex < binNumber; firstIndex++ )
 	{
-		for ( unsigned int entryIndex = 0; entryIndex < matrixValues[ firstIndex ].size(); entryIndex++ )
+		for ( unsigned int entryIndex = rowStarts[ firstIndex ]; entryIndex < rowStarts[ firstIndex + 1 ]; entryIndex++ )
 		{
-			unsigned int outputBin = outputHistogram->GetBin( firstIndex + 1, secondIndices[ firstIndex ][ entryIndex ] + 1, 0 );
+			unsigned int outputBin = outputHistogram->GetBin( firstIndex + 1, secondIndices[ entryIndex ] + 1, 0 );
 
-			outputHistogram->SetBinContent( outputBin, matrixValues[ firstIndex ][ entryIndex ] );
+			outputHistogram->SetBinContent( outputBin, matrixValues[ entryIndex ] );
 		}
 	}
 
 	return outputHistogram;
 }
 
-unsigned int SparseMatrix::GetBinNumber()
+unsigned int SparseMatrix::GetBinNumber() const
 {
-	return matrixValues.size();
+	if ( rowStarts.empty() )
+	{
+		return 0;
+	}
+	else
+	{
+		return rowStarts.size() - 1;
+	}
 }
 
 unsigned int SparseMatrix::GetEntryNumberAndResetIterator( bool UseSecondIterator )
 {
 	if ( UseSecondIterator )
 	{
-		otherNextEntry = matrix.begin();
+		otherNextEntry = 0;
+		otherNextEntryRow = 0;
 	}
 	else
 	{
-		nextEntry = matrix.begin();
+		nextEntry = 0;
+		nextEntryRow = 0;
 	}
-	return entryNumber;
+	return matrixValues.size();
+}
+
+//Read-only views of the finalised matrix
+const unsigned int * SparseMatrix::GetRowStarts() const
+{
+	return rowStarts.data();
+}
+const unsigned int * SparseMatrix::GetSecondIndices() const
+{
+	return secondIndices.data();
+}
+const double * SparseMatrix::GetValues() const
+{
+	return matrixValues.data();
 }
 
 //Get all non-zero entries of the matrix with the given FirstIndex
-vector< double > * SparseMatrix::GetEntriesWithFirstIndex( unsigned int FirstIndex )
+unsigned int SparseMatrix::GetEntryNumberWithFirstIndex( unsigned int FirstIndex ) const
+{
+	return rowStarts[ FirstIndex + 1 ] - rowStarts[ FirstIndex ];
+}
+const double * SparseMatrix::GetEntriesWithFirstIndex( unsigned int FirstIndex ) const
 {
-	return &( matrixValues[ FirstIndex ] );
+	return matrixValues.data() + rowStarts[ FirstIndex ];
 }
-vector< unsigned int > * SparseMatrix::GetIndicesWithFirstIndex( unsigned int FirstIndex )
+const unsigned int * SparseMatrix::GetIndicesWithFirstIndex( unsigned int FirstIndex ) const
 {
-	return &( secondIndices[ FirstIndex ] );
+	return secondIndices.data() + rowStarts[ FirstIndex ];
 }
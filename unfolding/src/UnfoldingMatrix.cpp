@@ -24,37 +24,41 @@ UnfoldingMatrix::UnfoldingMatrix( SmearingMatrix * InputSmearing, Distribution *
 	//Get the dimension of the matrix
 	unsigned int binNumber = InputSmearing->GetBinNumber();
 
+	//Read the smearing matrix entries
+	const unsigned int * rowStarts = InputSmearing->GetRowStarts();
+	const unsigned int * effectIndices = InputSmearing->GetSecondIndices();
+	const double * smearingValues = InputSmearing->GetValues();
+
 	//Calculate the probabilities of the effects
 	vector< double > effectProbabilities( binNumber, 0.0 );
-	unsigned int entryNumber = InputSmearing->GetEntryNumberAndResetIterator();
-	for ( unsigned int smearingIndex = 0; smearingIndex < entryNumber; smearingIndex++ )
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
 	{
-		//Retrieve the smearing matrix entry
-		unsigned int causeIndex, effectIndex;
-		double smearingValue = InputSmearing->GetNextEntry( causeIndex, effectIndex );
-
-		//Add to the effect probability
-		effectProbabilities[ effectIndex ] += smearingValue * InputDistribution->GetBinProbability( causeIndex );
+		double causeProbability = InputDistribution->GetBinProbability( causeIndex );
+		for ( unsigned int smearingIndex = rowStarts[ causeIndex ]; smearingIndex < rowStarts[ causeIndex + 1 ]; smearingIndex++ )
+		{
+			//Add to the effect probability
+			effectProbabilities[ effectIndices[ smearingIndex ] ] += smearingValues[ smearingIndex ] * causeProbability;
+		}
 	}
 
 	//Calculate the matrix elements
-	entryNumber = InputSmearing->GetEntryNumberAndResetIterator();
-	for ( unsigned int smearingIndex = 0; smearingIndex < entryNumber; smearingIndex++ )
+	for ( unsigned int causeIndex = 0; causeIndex < binNumber; causeIndex++ )
 	{
-		//Retrieve the smearing matrix entry    
-		unsigned int causeIndex, effectIndex;            
-		double smearingValue = InputSmearing->GetNextEntry( causeIndex, effectIndex );
-
 		//Ignore zero entries
 		double causeProbability = InputDistribution->GetBinProbability( causeIndex );
 		if ( causeProbability != 0.0 )
 		{
-			//Work out the unfolding matrix entry
-			double numerator = smearingValue * causeProbability;
-			numerator /= ( effectProbabilities[ effectIndex ] * InputSmearing->GetEfficiency( causeIndex ) );
+			double efficiency = InputSmearing->GetEfficiency( causeIndex );
+			for ( unsigned int smearingIndex = rowStarts[ causeIndex ]; smearingIndex < rowStarts[ causeIndex + 1 ]; smearingIndex++ )
+			{
+				//Work out the unfolding matrix entry
+				unsigned int effectIndex = effectIndices[ smearingIndex ];
+				double numerator = smearingValues[ smearingIndex ] * causeProbability;
+				numerator /= ( effectProbabilities[ effectIndex ] * efficiency );
 
-			//Store the entry
-			AddToEntry( causeIndex, effectIndex, numerator );
+				//Store the entry
+				AddToEntry( causeIndex, effectIndex, numerator );
+			}
 		}
 	}
 
@@ -0,0 +1,76 @@
+/**
+  @class UniformEdges
+
+  The bins in one dimension, all the same width - for use with FixedIndices
+  Puts values in the same bins as UniformIndices
+ */
+
+#include "UniformEdges.h"
+#include "BatchIndices.h"
+
+//Default constructor
+UniformEdges::UniformEdges()
+{
+	binNumber = 0;
+	minimum = 0.0;
+	maximum = 0.0;
+	binWidth = 0.0;
+}
+
+//Constructor for fixed bin widths - the range can be either way round, as for UniformIndices
+UniformEdges::UniformEdges( unsigned int BinNumber, double Minimum, double Maximum )
+{
+	binNumber = BinNumber;
+	minimum = ( Maximum > Minimum ) ? Minimum : Maximum;
+	maximum = ( Maximum > Minimum ) ? Maximum : Minimum;
+	binWidth = ( maximum - minimum ) / (double)binNumber;
+
+	//Work the edges out the same way as UniformIndices, so the histograms match
+	for ( unsigned int binIndex = 0; binIndex <= binNumber; binIndex++ )
+	{
+		edges.push_back( minimum + ( binIndex * binWidth ) );
+	}
+}
+
+//Destructor
+UniformEdges::~UniformEdges()
+{
+}
+
+//Add the bin of each value, times the multiplier, to the indices
+void UniformEdges::AddBins( const double * Values, unsigned int ValueNumber, unsigned int Multiplier, unsigned int * Indices ) const
+{
+	BatchIndices::AddUniformBins( Values, ValueNumber, minimum, maximum, binWidth, binNumber, Multiplier, Indices );
+}
+
+//The number of bins, not including under and overflow
+unsigned int UniformEdges::BinNumber() const
+{
+	return binNumber;
+}
+
+//The low edge of each bin, and the high edge of the last
+const vector< double > & UniformEdges::Edges() const
+{
+	return edges;
+}
+
+//A central value for a bin with no events in it
+double UniformEdges::EmptyBinCentre( unsigned int BinIndex ) const
+{
+	if ( BinIndex == 0 )
+	{
+		//Underflow bin
+		return minimum - 1.0;
+	}
+	else if ( BinIndex == binNumber + 1 )
+	{
+		//Overflow bin
+		return maximum + 1.0;
+	}
+	else
+	{
+		//Regular bin
+		return ( ( (double)BinIndex - 0.5 ) * binWidth ) + minimum;
+	}
+}
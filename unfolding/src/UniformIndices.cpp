@@ -8,10 +8,12 @@
  */
 
 #include "UniformIndices.h"
+#include "BatchIndices.h"
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
 //Default constructor
 UniformIndices::UniformIndices()
@@ -94,22 +96,26 @@ UniformIndices::~UniformIndices()
 
 //Return the bin number / index corresponding to a given value
 unsigned int UniformIndices::GetIndex( const vector< double > & InputValues )
+{
+	return GetIndex( &InputValues[0], InputValues.size() );
+}
+unsigned int UniformIndices::GetIndex( const double * InputValues, unsigned int ValueNumber )
 {
 	//Stupidity check
-	if ( numberOfDimensions != InputValues.size() )
+	if ( numberOfDimensions != ValueNumber )
 	{
-		cerr << "Using a " << InputValues.size() << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
+		cerr << "Using a " << ValueNumber << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
 		exit(1);
 	}
 	else
 	{
 		//Loop over all dimensions
 		unsigned int totalIndex = 0;
-		int binMultiplier = 1;
+		unsigned int binMultiplier = 1;
 		for ( unsigned int dimensionIndex = 0; dimensionIndex < numberOfDimensions; dimensionIndex++ )
 		{
 			//Add to the total index
-			totalIndex += GetOneDimensionIndex( InputValues[ dimensionIndex ], dimensionIndex ) * (double)binMultiplier;
+			totalIndex += GetOneDimensionIndex( InputValues[ dimensionIndex ], dimensionIndex ) * binMultiplier;
 			binMultiplier *= ( numberOfBins[ dimensionIndex ] + 2 );
 		}
 
@@ -117,6 +123,27 @@ unsigned int UniformIndices::GetIndex( const vector< double > & InputValues )
 	}
 }
 
+//Return the bin index for each of a set of events, given an array of values for each dimension
+void UniformIndices::GetIndices( const double * const * InputColumns, unsigned int ValueNumber, unsigned int EventNumber, unsigned int * OutputIndices )
+{
+	//Stupidity check - once for all the events
+	if ( numberOfDimensions != ValueNumber )
+	{
+		cerr << "Using a " << ValueNumber << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
+		exit(1);
+	}
+
+	//Work through one dimension at a time, adding to the index of every event
+	fill( OutputIndices, OutputIndices + EventNumber, 0 );
+	unsigned int binMultiplier = 1;
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < numberOfDimensions; dimensionIndex++ )
+	{
+		BatchIndices::AddUniformBins( InputColumns[ dimensionIndex ], EventNumber, minima[ dimensionIndex ], maxima[ dimensionIndex ], binWidths[ dimensionIndex ],
+				numberOfBins[ dimensionIndex ], binMultiplier, OutputIndices );
+		binMultiplier *= ( numberOfBins[ dimensionIndex ] + 2 );
+	}
+}
+
 //Return the bin number in each dimension
 vector< unsigned int > UniformIndices::GetNDimensionalIndex( const vector< double > & InputValues )
 {
@@ -255,9 +282,9 @@ unsigned int UniformIndices::GetOneDimensionIndex( double Value, unsigned int Di
 		//Underflow bin
 		return 0;
 	}
-	else if ( Value > maxima[ Dimension ] )
+	else if ( !( Value <= maxima[ Dimension ] ) )
 	{
-		//Overflow bin
+		//Overflow bin (or not a number)
 		return numberOfBins[ Dimension ] + 1;
 	}
 	else
@@ -270,14 +297,22 @@ unsigned int UniformIndices::GetOneDimensionIndex( double Value, unsigned int Di
 //Input the data to calculate the central values
 void UniformIndices::StoreDataValue( const vector< double > & Data, double Weight )
 {
-	//Find out the bin that the event falls into in each dimension
-	vector< unsigned int > binIndices = GetNDimensionalIndex( Data );
+	StoreDataValue( &Data[0], Data.size(), Weight );
+}
+void UniformIndices::StoreDataValue( const double * Data, unsigned int ValueNumber, double Weight )
+{
+	//Stupidity check
+	if ( numberOfDimensions != ValueNumber )
+	{
+		cerr << "Using a " << ValueNumber << "D index lookup for a " << numberOfDimensions << "D unfolding" << endl;
+		exit(1);
+	}
 
 	//Loop over dimensions
-	for ( unsigned int dimensionIndex = 0; dimensionIndex < binIndices.size(); dimensionIndex++ )
+	for ( unsigned int dimensionIndex = 0; dimensionIndex < numberOfDimensions; dimensionIndex++ )
 	{
 		//Find out the index of the bin the event falls into in this dimension
-		unsigned int binIndex = binIndices[dimensionIndex];
+		unsigned int binIndex = GetOneDimensionIndex( Data[ dimensionIndex ], dimensionIndex );
 
 		//Add the event to the bin in this dimension
 		binValueSums[ dimensionIndex ][ binIndex ] += Data[ dimensionIndex ] * Weight;